@@ -0,0 +1,352 @@
+#include "asset_bundle.h"
+
+#include <stdio.h>
+#include <string.h>
+
+AssetBundle Bundle;
+
+/* FUNCTION: Rewrites an asset path into the form stored in bundles: '/' separators and no leading "./".
+    Author: Niko
+    Arguments:
+        path - Asset path as written by the game, e.g. "emissions_images\\4.png".
+        out, outSize - Buffer for the normalized path (truncated if too small).
+    Returns:
+        NONE                                                                                                */
+void normalizeAssetPath(const char* path, char* out, size_t outSize) {
+    if (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) {
+        path += 2;
+    }
+    size_t i = 0;
+    for (; path[i] != '\0' && i < outSize - 1; i++) {
+        out[i] = (path[i] == '\\') ? '/' : path[i];
+    }
+    out[i] = '\0';
+}
+
+/* FUNCTION: Hashes an asset path (64-bit FNV-1a of its normalized form) for the bundle index.
+    Author: Niko
+    Arguments:
+        path - Asset path with either kind of separator.
+    Returns:
+        The hash.                                                                                  */
+uint64_t hashAssetPath(const char* path) {
+    char normalized[512];
+    normalizeAssetPath(path, normalized, sizeof(normalized));
+
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = normalized; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+AssetBundle::AssetBundle() : header(NULL), entries(NULL), paths(NULL) {
+}
+
+/* FUNCTION: Maps a bundle file and checks that its header and index are consistent.
+    Author: Niko
+    Arguments:
+        path - Path of the bundle file.
+    Returns:
+        true if the bundle is ready to use; false (with the bundle closed) otherwise.   */
+bool AssetBundle::open(const char* path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    const unsigned char* base = file.data();
+    size_t size = file.size();
+    const BundleHeader* h = (const BundleHeader*)base;
+
+    const char* problem = NULL;
+    if (size < sizeof(BundleHeader) || memcmp(h->magic, BUNDLE_MAGIC, 4) != 0) {
+        problem = "is not an asset bundle";
+    } else if (h->version < 1 || h->version == 2 || h->version > BUNDLE_VERSION) {
+        problem = "has a bundle version this game can't read";
+    } else if (h->indexOffset > size || (size - h->indexOffset) / sizeof(BundleEntry) < h->entryCount) {
+        problem = "has an index that runs past the end of the file";
+    } else if (h->pathsOffset > size) {
+        problem = "has its path strings past the end of the file";
+    }
+    if (problem) {
+        printf("Error: %s %s\n", path, problem);
+        file.close();
+        return false;
+    }
+
+    // Every path has to end inside the mapping, so find() can compare it without reading past the end
+    const BundleEntry* index = (const BundleEntry*)(base + h->indexOffset);
+    const unsigned char* pathsBase = base + h->pathsOffset;
+    size_t pathsSize = size - h->pathsOffset;
+    for (uint32_t i = 0; i < h->entryCount; i++) {
+        if (index[i].offset > size || index[i].size > size - index[i].offset || index[i].pathOffset >= pathsSize ||
+            !memchr(pathsBase + index[i].pathOffset, '\0', pathsSize - index[i].pathOffset)) {
+            printf("Error: %s has a corrupt index entry (%u)\n", path, i);
+            file.close();
+            return false;
+        }
+    }
+
+    header = h;
+    entries = index;
+    paths = (const char*)(base + h->pathsOffset);
+    return true;
+}
+
+/* FUNCTION: Unmaps the bundle. Any AssetView handed out before becomes invalid.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                        */
+void AssetBundle::close() {
+    file.close();
+    header = NULL;
+    entries = NULL;
+    paths = NULL;
+}
+
+/* FUNCTION: Finds an asset in the bundle.
+    Author: Niko
+    Arguments:
+        path - Asset path as the game writes it.
+        view - Receives a zero-copy view of the payload.
+    Returns:
+        true if the asset is in the bundle.                 */
+bool AssetBundle::find(const char* path, AssetView* view) const {
+    if (!entries) {
+        return false;
+    }
+
+    char normalized[512];
+    normalizeAssetPath(path, normalized, sizeof(normalized));
+    uint64_t hash = hashAssetPath(normalized);
+
+    // Lower bound on the sorted hashes, then confirm the path in case two paths share a hash
+    uint32_t low = 0, high = header->entryCount;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (entries[mid].pathHash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for (uint32_t i = low; i < header->entryCount && entries[i].pathHash == hash; i++) {
+        if (strcmp(paths + entries[i].pathOffset, normalized) == 0) {
+            view->data = file.data() + entries[i].offset;
+            view->size = entries[i].size;
+            view->width = entries[i].width;
+            view->height = entries[i].height;
+            view->encoding = entries[i].encoding;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* FUNCTION: Gets an entry by its position in the index (for tools that walk the whole bundle).
+    Author: Niko
+    Arguments:
+        i - Position, 0 to entryCount() - 1.
+        view - Receives a zero-copy view of the payload.
+    Returns:
+        The entry's normalized path, or NULL if there is no such entry.  */
+const char* AssetBundle::entry(int i, AssetView* view) const {
+    if (i < 0 || i >= entryCount()) {
+        return NULL;
+    }
+    view->data = file.data() + entries[i].offset;
+    view->size = entries[i].size;
+    view->width = entries[i].width;
+    view->height = entries[i].height;
+    view->encoding = entries[i].encoding;
+    return paths + entries[i].pathOffset;
+}
+
+/* FUNCTION: Expands the transparent-run encoding: the image is cleared, then each run's visible pixels are copied in.
+    Author: Niko
+    Arguments:
+        asset - An ASSET_RLE payload.
+        image - Image to fill in (its pixel storage is reused).
+    Returns:
+        true on success, false if the payload is truncated or overruns the image.                                   */
+static bool decodeRLE(const AssetView& asset, Image* image) {
+    size_t total = (size_t)asset.width * asset.height;
+    image->view = NULL;
+    image->pixels.assign(total, 0);
+    uint32_t* pixels = image->pixels.data();
+
+    const unsigned char* data = asset.data;
+    const unsigned char* end = asset.data + asset.size;
+    size_t position = 0;
+    while (data + sizeof(RleRun) <= end) {
+        RleRun run;
+        memcpy(&run, data, sizeof(run));
+        data += sizeof(run);
+        position += run.skip;
+        if (position + run.count > total || (size_t)(end - data) < run.count * sizeof(uint32_t)) {
+            return false;
+        }
+        memcpy(pixels + position, data, run.count * sizeof(uint32_t));
+        data += run.count * sizeof(uint32_t);
+        position += run.count;
+    }
+    return data == end;
+}
+
+/* FUNCTION: Reads the rest of a sequence length that filled its token nibble: bytes are added up until one isn't 255.
+    Author: Niko
+    Arguments:
+        data, end - Where the length bytes start, and the end of the payload.
+        length - The nibble's value (15), added to in place.
+    Returns:
+        false if the payload ends first.                                                                              */
+static bool readLength(const unsigned char** data, const unsigned char* end, size_t* length) {
+    unsigned int byte;
+    do {
+        if (*data >= end) {
+            return false;
+        }
+        byte = *(*data)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/* FUNCTION: Expands LZ-packed palette indices straight through the palette (the lookup table) into pixels. Each
+             sequence is a token (literal count in the high nibble, match length - INDEXED_MIN_MATCH in the low one,
+             15 meaning more length bytes follow), its literal indices, then a 2-byte offset back to the pixels the
+             match copies; the last sequence stops after its literals. A pixel only depends on its index, so matches
+             copy pixels already written rather than indices.
+    Author: Niko
+    Arguments:
+        data, end - The packed indices.
+        palette, colors - The palette and its size.
+        pixels, total - Destination pixels and how many there are.
+    Returns:
+        true if exactly total valid indices were unpacked.                                                         */
+static bool unpackIndices(const unsigned char* data, const unsigned char* end, const uint32_t* palette, uint32_t colors,
+                          uint32_t* pixels, size_t total) {
+    size_t position = 0;
+    while (data < end) {
+        unsigned int token = *data++;
+        size_t count = token >> 4;
+        if (count == 15 && !readLength(&data, end, &count)) {
+            return false;
+        }
+        if ((size_t)(end - data) < count || count > total - position) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (data[i] >= colors) {
+                return false;
+            }
+            pixels[position + i] = palette[data[i]];
+        }
+        data += count;
+        position += count;
+        if (data == end) {
+            break;
+        }
+
+        if (end - data < 2) {
+            return false;
+        }
+        size_t offset = data[0] | (data[1] << 8);
+        data += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(&data, end, &length)) {
+            return false;
+        }
+        length += INDEXED_MIN_MATCH;
+        if (offset == 0 || offset > position || length > total - position) {
+            return false;
+        }
+        // Overlapping copies repeat the pixels they have just written, the way runs come out
+        const uint32_t* from = pixels + position - offset;
+        for (size_t i = 0; i < length; i++) {
+            pixels[position + i] = from[i];
+        }
+        position += length;
+    }
+    return position == total;
+}
+
+/* FUNCTION: Expands the palettized encoding.
+    Author: Niko
+    Arguments:
+        asset - An ASSET_INDEXED payload.
+        image - Image to fill in (its pixel storage is reused).
+    Returns:
+        true on success, false if the payload is malformed. */
+static bool decodeIndexed(const AssetView& asset, Image* image) {
+    uint32_t colors;
+    if (asset.size < sizeof(colors)) {
+        return false;
+    }
+    memcpy(&colors, asset.data, sizeof(colors));
+    if (colors == 0 || colors > 256 || asset.size < sizeof(colors) + colors * sizeof(uint32_t)) {
+        return false;
+    }
+    uint32_t palette[256];
+    memcpy(palette, asset.data + sizeof(colors), colors * sizeof(uint32_t));
+
+    size_t total = (size_t)asset.width * asset.height;
+    image->view = NULL;
+    image->pixels.resize(total);
+    const unsigned char* packed = asset.data + sizeof(colors) + colors * sizeof(uint32_t);
+    return unpackIndices(packed, asset.data + asset.size, palette, colors, image->pixels.data(), total);
+}
+
+/* FUNCTION: Turns a bundle payload into an image. Raw entries become views into the mapping (no copy and no
+             decode); transparent-run and palettized entries are expanded without any inflate or color conversion.
+    Author: Niko
+    Arguments:
+        asset - The payload.
+        image - Image to fill in.
+    Returns:
+        true on success.                                                                                         */
+bool decodeAsset(const AssetView& asset, Image* image) {
+    bool decoded = false;
+    switch (asset.encoding) {
+    case ASSET_RGBA:
+        if (asset.size == (size_t)asset.width * asset.height * sizeof(uint32_t)) {
+            image->pixels = std::vector<uint32_t>();
+            image->view = (const uint32_t*)asset.data;
+            decoded = true;
+        }
+        break;
+    case ASSET_PNG:
+        return decodePNGMemory(asset.data, asset.size, image);
+    case ASSET_RLE:
+        decoded = decodeRLE(asset, image);
+        break;
+    case ASSET_INDEXED:
+        decoded = decodeIndexed(asset, image);
+        break;
+    }
+    if (decoded) {
+        image->width = asset.width;
+        image->height = asset.height;
+    }
+    return decoded;
+}
+
+/* FUNCTION: Loads an image from the asset bundle if it has one, or from the loose PNG otherwise.
+    Author: Niko
+    Arguments:
+        path - Asset path of the image.
+        image - Image to fill in.
+    Returns:
+        true on success.                                                 */
+bool loadImage(const char* path, Image* image) {
+    AssetView asset;
+    if (Bundle.find(path, &asset) && decodeAsset(asset, image)) {
+        return true;
+    }
+    return decodePNG(path, image);
+}
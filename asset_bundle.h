@@ -0,0 +1,110 @@
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include "image.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+
+/* Bundle file layout (all integers little-endian):
+       BundleHeader
+       payloads, each starting on a BUNDLE_ALIGNMENT boundary
+       BundleEntry[entryCount], sorted by pathHash
+       path strings, '\0'-terminated, '/' separators                    */
+
+#define BUNDLE_FILE "assets.bundle"
+#define BUNDLE_MAGIC "MGAB"
+#define BUNDLE_VERSION 3         // Version 1 bundles (RGBA and PNG payloads only) are still read; version 2 ones
+                                 // (PackBits-packed indices) have to be rebuilt with make assets
+#define BUNDLE_ALIGNMENT 16
+
+/* Payload encodings */
+#define ASSET_RGBA 0    // width * height 0xAARRGGBB pixels, drawn straight out of the mapping
+#define ASSET_PNG 1     // The original PNG less its metadata chunks, decoded from memory (the fallback for images the
+                        // other encodings would store at many times the PNG's size)
+#define ASSET_RLE 2     // Mostly transparent images: RleRun headers, each followed by its visible 0xAARRGGBB pixels
+#define ASSET_INDEXED 3 // Images with up to 256 colors: uint32_t color count, that many 0xAARRGGBB palette entries,
+                        // then the palette indices packed as LZ sequences (see unpackIndices)
+
+#define INDEXED_MIN_MATCH 4         // Shortest match an ASSET_INDEXED sequence copies
+#define INDEXED_MAX_OFFSET 65535    // Furthest back, in pixels, a match can start
+
+/* A run of an ASSET_RLE payload, in pixels counted row by row through the whole image */
+struct RleRun {
+    uint16_t skip;      // Fully transparent pixels before the visible ones
+    uint16_t count;     // Visible pixels that follow this header
+};
+
+struct BundleHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t pathsOffset;
+};
+
+struct BundleEntry {
+    uint64_t pathHash;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t pathOffset;
+    uint16_t width;
+    uint16_t height;
+    uint8_t encoding;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(BundleHeader) == 32, "BundleHeader must match the on-disk layout");
+static_assert(sizeof(BundleEntry) == 32, "BundleEntry must match the on-disk layout");
+
+/* CLASS: A bundle entry's payload, pointing straight into the mapped file.
+    Author: Niko
+    Members:
+        data, size - The payload bytes.
+        width, height - Image dimensions.
+        encoding - One of the ASSET_* payload encodings.                        */
+struct AssetView {
+    const unsigned char* data;
+    size_t size;
+    int width;
+    int height;
+    int encoding;
+};
+
+uint64_t hashAssetPath(const char* path);
+void normalizeAssetPath(const char* path, char* out, size_t outSize);
+
+/* CLASS: Read-only, memory-mapped asset bundle written by tools/pack_assets.
+    Author: Niko
+    Members:
+        open(path) - Maps the bundle and validates its header and index.
+        find(path, view) - Looks up an asset by its game path ('\\' or '/' separators) with a binary search of the hashed index.
+        entryCount() - Number of assets in the bundle.
+        entry(i, view) - The i-th asset's path (in index order) and payload, for tools.
+    Notes:
+        Views stay valid until the bundle is closed, so it is opened once at startup and kept for the whole session. */
+class AssetBundle {
+public:
+    AssetBundle();
+
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return entries != NULL; }
+    bool find(const char* path, AssetView* view) const;
+    int entryCount() const { return entries ? (int)header->entryCount : 0; }
+    const char* entry(int i, AssetView* view) const;
+
+private:
+    MappedFile file;
+    const BundleHeader* header;
+    const BundleEntry* entries;
+    const char* paths;
+};
+
+extern AssetBundle Bundle;
+
+bool decodeAsset(const AssetView& asset, Image* image);
+bool loadImage(const char* path, Image* image);
+
+#endif
@@ -0,0 +1,61 @@
+#include "backend.h"
+#include "headless.h"
+#include "trace.h"
+
+#include <string.h>
+
+#ifndef HEADLESS_ONLY
+#include "FEHRandom.h"
+#include "FEHUtility.h"
+
+/* CLASS: The Proteus LCD and touchscreen, through the FEH libraries (on the robot or in the simulator window).
+    Author: Niko
+    Notes:
+        drawRun sends single pixels as pixels and longer runs as horizontal lines, the cheapest LCD calls for each. */
+class FehBackend : public Backend {
+public:
+    const char* name() const { return "feh"; }
+
+    void drawRun(int y, int x1, int x2, uint32_t color) {
+        LCD.SetFontColor(color);
+        if (x2 - x1 == 1) {
+            LCD.DrawPixel(x1, y);
+        } else {
+            LCD.DrawHorizontalLine(y, x1, x2 - 1);
+        }
+    }
+
+    void present() { LCD.Update(); }
+    bool touch(float* x, float* y) { return LCD.Touch(x, y); }
+    double now() { return TimeNow(); }
+    void sleep(double seconds) {
+        TRACE_SCOPE(TRACE_SLEEP_PHASE);
+        Sleep(seconds);
+    }
+    int randInt() { return Random.RandInt(); }
+};
+
+static FehBackend fehBackend;
+Backend* Device = &fehBackend;
+#else
+Backend* Device = NULL;
+#endif
+
+/* FUNCTION: Picks the backend to run on.
+    Author: Niko
+    Arguments:
+        name - "feh" for the Proteus LCD (not available in headless-only builds) or "headless" for an in-memory
+               framebuffer with scripted touches (see headless.h).
+    Returns:
+        The backend, or NULL if the name isn't one.                                                            */
+Backend* createBackend(const char* name) {
+#ifndef HEADLESS_ONLY
+    if (strcmp(name, "feh") == 0) {
+        return &fehBackend;
+    }
+#endif
+    if (strcmp(name, "headless") == 0) {
+        return &Headless;
+    }
+    return NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdint.h>
+
+// Headless-only builds (make headless) don't have the simulator libraries, so they supply the colors the game uses
+#ifndef HEADLESS_ONLY
+#include "FEHLCD.h"
+#else
+#define BLACK 0x000000u
+#define WHITE 0xFFFFFFu
+#endif
+
+/* CLASS: Everything the game needs from the platform: somewhere to put pixels, a touchscreen, a clock and random
+          numbers. The game only talks to the platform through Device, so the same code runs on the Proteus simulator
+          or headless.
+    Author: Niko
+    Members:
+        name() - Short name, as given to createBackend.
+        drawRun(y, x1, x2, color) - Sets pixels x1 to x2 - 1 of row y to one 0xRRGGBB color.
+        present() - Shows everything drawn since the last call (the end of a frame).
+        touch(x, y) - Samples the touchscreen; returns whether it is pressed, and where.
+        now() - Seconds on a monotonic clock.
+        sleep(seconds) - Waits.
+        randInt() - A random non-negative integer.
+        finished() - Whether the backend has nothing more to give (e.g. a replay ran out), so the game should quit.
+        realTime() - Whether the clock keeps up with the wall clock. When it doesn't (a fast replay), work on other
+            threads takes no time on it, so the game waits for that work instead of carrying on without it.         */
+class Backend {
+public:
+    virtual ~Backend() {}
+
+    virtual const char* name() const = 0;
+    virtual void drawRun(int y, int x1, int x2, uint32_t color) = 0;
+    virtual void present() = 0;
+    virtual bool touch(float* x, float* y) = 0;
+    virtual double now() = 0;
+    virtual void sleep(double seconds) = 0;
+    virtual int randInt() = 0;
+    virtual bool finished() { return false; }
+    virtual bool realTime() const { return true; }
+};
+
+extern Backend* Device;
+
+Backend* createBackend(const char* name);
+
+#endif
@@ -0,0 +1,252 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+FrameBench Bench;
+
+FrameBench::FrameBench()
+    : inner(NULL), random(BENCH_SEED), virtualClock(false), virtualTime(0.0), limit(-1.0), running(false),
+      scenarioStart(0.0), lastFrameReal(0.0), sleptSinceFrame(0.0) {
+}
+
+double FrameBench::realNow() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+}
+
+/* FUNCTION: Wraps a backend and starts timing the cold start.
+    Author: Niko
+    Arguments:
+        inner - The backend to draw on.
+    Returns:
+        NONE                                                      */
+void FrameBench::start(Backend* inner) {
+    this->inner = inner;
+    realStart = std::chrono::steady_clock::now();
+    virtualClock = false;
+    limit = -1.0;
+    results.clear();
+
+    running = true;
+    scenario = "cold_start";
+    frameTimes.clear();
+    scenarioStart = lastFrameReal = 0.0;
+    sleptSinceFrame = 0.0;
+}
+
+/* FUNCTION: Ends the running scenario and starts the next one on the virtual clock.
+    Author: Niko
+    Arguments:
+        name - Scenario name.
+        seconds - Virtual seconds until finished() turns true, or 0 for never.
+    Returns:
+        NONE                                                                   */
+void FrameBench::begin(const char* name, double seconds) {
+    end();
+    if (!virtualClock) {
+        virtualTime = inner->now();
+        virtualClock = true;
+    }
+    limit = seconds > 0 ? virtualTime + seconds : -1.0;
+
+    running = true;
+    scenario = name;
+    frameTimes.clear();
+    scenarioStart = lastFrameReal = realNow();
+    sleptSinceFrame = 0.0;
+}
+
+/* FUNCTION: Ends the running scenario and works out its percentiles.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                            */
+void FrameBench::end() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    limit = -1.0;
+
+    BenchResult result;
+    result.name = scenario;
+    result.frames = frameTimes.size();
+    result.wall = (realNow() - scenarioStart) * 1000.0;
+    result.p50 = result.p95 = result.p99 = result.max = 0.0;
+
+    std::vector<double> times = frameTimes;
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    if (n > 0) {
+        result.p50 = times[n / 2] * 1000.0;
+        result.p95 = times[n * 95 / 100] * 1000.0;
+        result.p99 = times[n * 99 / 100] * 1000.0;
+        result.max = times[n - 1] * 1000.0;
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        BenchResult& best = results[i];
+        if (best.name == result.name) {
+            best.p50 = std::min(best.p50, result.p50);
+            best.p95 = std::min(best.p95, result.p95);
+            best.p99 = std::min(best.p99, result.p99);
+            best.max = std::min(best.max, result.max);
+            best.wall = std::min(best.wall, result.wall);
+            return;
+        }
+    }
+    results.push_back(result);
+}
+
+/* FUNCTION: Shows the frame on the inner backend and adds its time to the running scenario.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                  */
+void FrameBench::present() {
+    inner->present();
+    double real = realNow();
+    if (running) {
+        frameTimes.push_back(real - lastFrameReal - sleptSinceFrame);
+    }
+    lastFrameReal = real;
+    sleptSinceFrame = 0.0;
+}
+
+double FrameBench::now() {
+    return virtualClock ? virtualTime : inner->now();
+}
+
+/* FUNCTION: Waits: for real during the cold start, afterwards by moving the virtual clock on.
+    Author: Niko
+    Arguments:
+        seconds - How long.
+    Returns:
+        NONE                                                                                    */
+void FrameBench::sleep(double seconds) {
+    if (virtualClock) {
+        virtualTime += seconds > 0 ? seconds : 0.0;
+        return;
+    }
+    double before = realNow();
+    inner->sleep(seconds);
+    sleptSinceFrame += realNow() - before;
+}
+
+int FrameBench::randInt() {
+    return (int)(random() & 0x7FFFFFFF);
+}
+
+bool FrameBench::finished() {
+    return limit >= 0 && virtualTime >= limit;
+}
+
+/* FUNCTION: Prints every scenario's results and the total wall time.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                           */
+void FrameBench::printResults() const {
+    double total = 0.0;
+    printf("%-22s %7s %9s %9s %9s %9s %10s\n", "Scenario", "frames", "p50 ms", "p95 ms", "p99 ms", "max ms",
+           "wall ms");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        printf("%-22s %7lu %9.3f %9.3f %9.3f %9.3f %10.1f\n", r.name.c_str(), r.frames, r.p50, r.p95, r.p99, r.max,
+               r.wall);
+        total += r.wall;
+    }
+    printf("Total wall time: %.1f ms\n", total);
+}
+
+/* FUNCTION: Says whether a measurement got slower than its baseline by more than the threshold, printing it if so.
+    Author: Niko
+    Arguments:
+        scenario, what - Names for the message.
+        baseline, current - The measurements in ms.
+        threshold - Allowed slowdown as a fraction.
+    Returns:
+        true for a regression.                                                                                      */
+static bool regressed(const char* scenario, const char* what, double baseline, double current, double threshold) {
+    if (current <= baseline * (1.0 + threshold) || current - baseline < BENCH_MIN_REGRESSION_MS) {
+        return false;
+    }
+    printf("Regression: %s %s %.3f ms -> %.3f ms (%+.0f%%)\n", scenario, what, baseline, current,
+           baseline > 0 ? (current / baseline - 1.0) * 100.0 : 100.0);
+    return true;
+}
+
+/* FUNCTION: Compares the results against a baseline file. Scenarios missing from either side are only noted.
+    Author: Niko
+    Arguments:
+        path - Native path of the baseline.
+        threshold - Allowed slowdown as a fraction (e.g. 0.25 for 25%).
+    Returns:
+        Results that regressed, or -1 if the baseline can't be read.                                            */
+int FrameBench::compare(const char* path, double threshold) const {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    std::vector<BenchResult> baseline;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[64];
+        BenchResult r;
+        if (line[0] != '#' && sscanf(line, "%63s %lu %lf %lf %lf %lf %lf", name, &r.frames, &r.p50, &r.p95, &r.p99,
+                                     &r.max, &r.wall) == 7) {
+            r.name = name;
+            baseline.push_back(r);
+        }
+    }
+    fclose(file);
+
+    int regressions = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& current = results[i];
+        const BenchResult* old = NULL;
+        for (size_t j = 0; j < baseline.size(); j++) {
+            if (baseline[j].name == current.name) {
+                old = &baseline[j];
+            }
+        }
+        if (!old) {
+            printf("Note: %s is not in the baseline\n", current.name.c_str());
+            continue;
+        }
+
+        const char* name = current.name.c_str();
+        regressions += regressed(name, "p50", old->p50, current.p50, threshold);
+        regressions += regressed(name, "p95", old->p95, current.p95, threshold);
+        regressions += regressed(name, "p99", old->p99, current.p99, threshold);
+        regressions += regressed(name, "wall", old->wall, current.wall, threshold);
+    }
+    return regressions;
+}
+
+/* FUNCTION: Saves the results as the baseline.
+    Author: Niko
+    Arguments:
+        path - Native path of the baseline.
+    Returns:
+        false if the file can't be written.    */
+bool FrameBench::writeBaseline(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "# Frame-time baseline (make bench); scenario frames p50 p95 p99 max wall, times in ms\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(file, "%s %lu %.3f %.3f %.3f %.3f %.1f\n", r.name.c_str(), r.frames, r.p50, r.p95, r.p99, r.max,
+                r.wall);
+    }
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,96 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "backend.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#define BENCH_BASELINE_FILE "bench_baseline.txt"
+#define BENCH_THRESHOLD 0.25            // Default slowdown allowed before a result counts as a regression (25%)
+#define BENCH_MIN_REGRESSION_MS 1.0     // Slowdowns smaller than this are noise, whatever the ratio
+#define BENCH_SEED 1                    // Seed of the benchmark's random numbers, so every run draws the same prompts
+#define BENCH_RUNS 5                    // Times each scenario is run (the best of each measure is kept)
+
+/* Baseline file format (text):
+       # comments
+       <scenario> <frames> <p50> <p95> <p99> <max> <wall>      Frame times and wall time in ms */
+
+/* CLASS: One scenario's results.
+    Author: Niko
+    Members:
+        name - Scenario name.
+        frames - Frames presented.
+        p50, p95, p99, max - Frame times in ms.
+        wall - Wall-clock time the scenario took in ms (waiting included).  */
+struct BenchResult {
+    std::string name;
+    unsigned long frames;
+    double p50, p95, p99, max;
+    double wall;
+};
+
+/* CLASS: Backend wrapper that times scripted scenarios frame by frame, then reports and checks them against a baseline.
+    Author: Niko
+    Members:
+        start(inner) - Wraps inner and starts the cold start scenario (on the real clock, so startup waits as usual).
+        begin(name, seconds) - Ends the running scenario and starts another on a virtual clock: sleeps return at once
+            and only move the clock on, so a scenario takes as long as its drawing does. With seconds > 0 finished()
+            turns true after that much virtual time, which ends a scene loop started for the scenario.
+        end() - Ends the running scenario. A scenario run again keeps the best of each measure over its runs, which
+            filters out most of the noise from other processes.
+        printResults() - Prints a table of every scenario and the total wall time.
+        compare(path, threshold) - Compares against a baseline file; returns how many results got slower by more than
+            threshold (a fraction) and BENCH_MIN_REGRESSION_MS, or -1 if there is no baseline.
+        writeBaseline(path) - Saves the results as the baseline.
+    Notes:
+        A frame's time is the wall-clock time the game spent on it (from the previous frame, or the scenario's start,
+        minus time spent sleeping), the same measure the replay report uses (see replay.h). The touchscreen is never
+        pressed and random numbers come from BENCH_SEED. p50, p95 and p99 are compared, as is the wall time; max is
+        only reported, as one slow frame is too noisy to fail a build on.                                           */
+class FrameBench : public Backend {
+public:
+    FrameBench();
+
+    void start(Backend* inner);
+    void begin(const char* name, double seconds = 0.0);
+    void end();
+
+    void printResults() const;
+    int compare(const char* path, double threshold) const;
+    bool writeBaseline(const char* path) const;
+
+    const char* name() const { return inner->name(); }
+    void drawRun(int y, int x1, int x2, uint32_t color) { inner->drawRun(y, x1, x2, color); }
+    void present();
+    bool touch(float* x, float* y) { return false; }
+    double now();
+    void sleep(double seconds);
+    int randInt();
+    bool finished();
+    bool realTime() const { return !virtualClock; }
+
+private:
+    double realNow() const;
+
+    Backend* inner;
+    std::mt19937 random;
+    bool virtualClock;
+    double virtualTime;                 // The clock's reading while it is virtual
+    double limit;                       // Virtual time at which the scenario is finished, or < 0 for none
+
+    bool running;
+    std::string scenario;
+    std::vector<double> frameTimes;
+    std::chrono::steady_clock::time_point realStart;
+    double scenarioStart;               // Real seconds since start() when the scenario began
+    double lastFrameReal;               // Real seconds since start() at the end of the last frame
+    double sleptSinceFrame;             // Real seconds slept since then
+    std::vector<BenchResult> results;
+};
+
+extern FrameBench Bench;
+
+#endif
@@ -0,0 +1,172 @@
+#include "card_cache.h"
+#include "emissions.h"
+#include "image_cache.h"
+#include "memory_ledger.h"
+#include "text.h"
+#include "trace.h"
+
+#include "backend.h"
+
+#include <chrono>
+#include <stdio.h>
+
+CardCache Cards;
+
+CardCache::CardCache() : hitCount(0), missCount(0), evictionCount(0), prefetchCount(0), renderSeconds(0.0) {
+}
+
+/* FUNCTION: Looks a card up, rendering and inserting it on a miss.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+        layout - CARD_LEFT or CARD_RIGHT, plus CARD_VALUE to show the value.
+    Returns:
+        The card, or NULL if the activity's image can't be loaded.          */
+std::shared_ptr<const Image> CardCache::get(int index, int layout) {
+    return lookup(index, layout, false);
+}
+
+/* FUNCTION: Makes sure a card is cached, rendering it now so that drawing it later is only a blit.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+        layout - CARD_* flags.
+    Returns:
+        false if the activity's image can't be loaded.                                              */
+bool CardCache::prefetch(int index, int layout) {
+    return (bool)lookup(index, layout, true);
+}
+
+/* FUNCTION: Shared body of get and prefetch: finds the card, or renders it outside the lock and inserts it.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+        layout - CARD_* flags.
+        ahead - Whether this is a prefetch (counted separately, and doesn't count as a hit or refresh the LRU order).
+    Returns:
+        The card, or NULL if the activity's image can't be loaded.                                                    */
+std::shared_ptr<const Image> CardCache::lookup(int index, int layout, bool ahead) {
+    MEMORY_TAG(MEM_CARDS);
+    uint32_t key = (uint32_t)index * 4 + (uint32_t)layout;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unordered_map<uint32_t, std::list<Entry>::iterator>::iterator found = this->index.find(key);
+        if (found != this->index.end()) {
+            if (!ahead) {
+                hitCount++;
+                lru.splice(lru.begin(), lru, found->second);
+            }
+            return found->second->card;
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::shared_ptr<Image> card = std::make_shared<Image>();
+    if (!render(index, layout, card.get())) {
+        return std::shared_ptr<const Image>();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (ahead) {
+        prefetchCount++;
+    } else {
+        missCount++;
+    }
+    renderSeconds += seconds;
+
+    std::unordered_map<uint32_t, std::list<Entry>::iterator>::iterator found = this->index.find(key);
+    if (found != this->index.end()) {
+        lru.splice(lru.begin(), lru, found->second);
+        return found->second->card;
+    }
+
+    lru.push_front(Entry());
+    lru.front().key = key;
+    lru.front().card = card;
+    this->index[key] = lru.begin();
+
+    while (lru.size() > MAX_CARDS) {
+        this->index.erase(lru.back().key);
+        lru.pop_back();
+        evictionCount++;
+    }
+    return card;
+}
+
+/* FUNCTION: Composes a card: the activity's image (over black, so the card is opaque), its description and,
+             for CARD_VALUE, the formatted value and "kg CO2eq". Boxes match the ones the game used to draw straight
+             to the screen, shifted into the card's own coordinates.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+        layout - CARD_* flags.
+        card - Receives the rendered card.
+    Returns:
+        true on success, false if the activity's image can't be loaded.                                             */
+bool CardCache::render(int index, int layout, Image* card) {
+    TRACE_SCOPE("card_render");
+    char filename[30];
+    sprintf(filename, "emissions_images\\%d.png", index);
+    std::shared_ptr<const Image> image = Images.get(filename);
+    if (!image) {
+        return false;
+    }
+
+    card->width = CARD_WIDTH;
+    card->height = CARD_HEIGHT;
+    card->pixels.assign(CARD_WIDTH * CARD_HEIGHT, 0xFF000000u);
+    for (int y = 0; y < CARD_HEIGHT && y < image->height; y++) {
+        const uint32_t* src = image->data() + y * image->width;
+        uint32_t* dst = card->pixels.data() + y * CARD_WIDTH;
+        for (int x = 0; x < CARD_WIDTH && x < image->width; x++) {
+            uint32_t alpha = src[x] >> 24;
+            uint32_t r = ((src[x] >> 16) & 0xFF) * alpha / 255;
+            uint32_t g = ((src[x] >> 8) & 0xFF) * alpha / 255;
+            uint32_t b = (src[x] & 0xFF) * alpha / 255;
+            dst[x] = 0xFF000000u | (r << 16) | (g << 8) | b;
+        }
+    }
+
+    if (layout & CARD_RIGHT) {
+        printTextWithinBox(Emissions.description(index), WHITE, 15, 24, 152, 200, card);
+    } else {
+        printTextWithinBox(Emissions.description(index), WHITE, 8, 24, 145, 200, card);
+    }
+
+    if (layout & CARD_VALUE) {
+        char valueText[20];
+        formatEmissionsValue(Emissions.value(index), valueText, sizeof(valueText));
+        printTextWithinBox(valueText, WHITE, 4, 200, 156, 216, card);
+        printTextWithinBox("kg CO2eq", WHITE, 4, 220, 156, 236, card);
+    }
+
+    return true;
+}
+
+/* FUNCTION: Drops every card (counters are kept).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                         */
+void CardCache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    lru.clear();
+    index.clear();
+}
+
+/* FUNCTION: Prints hit, miss and render counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                         */
+void CardCache::printStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    unsigned long lookups = hitCount + missCount;
+    unsigned long renders = missCount + prefetchCount;
+    printf("Cards: %lu hits, %lu rendered on demand (%.1f%% hit rate), %lu prefetched, %.2f ms per render, %lu evictions, %lu cards kept\n",
+           hitCount, missCount, lookups ? 100.0 * hitCount / lookups : 0.0, prefetchCount,
+           renders ? renderSeconds * 1000.0 / renders : 0.0, evictionCount, (unsigned long)lru.size());
+}
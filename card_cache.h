@@ -0,0 +1,66 @@
+#ifndef CARD_CACHE_H
+#define CARD_CACHE_H
+
+#include "image.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+
+#define CARD_WIDTH 160
+#define CARD_HEIGHT 240
+#define MAX_CARDS 12            // Cards kept around (150 KB each); a round never shows more than four
+
+/* Card layouts, combined as flags */
+#define CARD_LEFT 0             // Left half of the screen
+#define CARD_RIGHT 1            // Right half of the screen (the description box sits 7 px further right)
+#define CARD_VALUE 2            // With the value and "kg CO2eq" under the description
+
+/* CLASS: Cache of fully rendered prompt "cards": an activity's image with its wrapped description and, optionally,
+          its value and unit already drawn on, ready to be blitted to either half of the screen.
+    Author: Niko
+    Members:
+        get(index, layout) - The card for an activity in one of the CARD_* layouts, rendered on a miss (NULL if the
+            activity's image can't be loaded).
+        prefetch(index, layout) - Renders a card ahead of time if it isn't cached yet (see prefetcher.h).
+        clear() - Drops every card.
+        printStats() - Prints hit, miss and render counters.
+    Notes:
+        Nothing on a card changes while it is up, so the text is wrapped and rendered once per activity and layout
+        instead of every frame, and moving a card (e.g. in the slide animation) costs the same as moving its image.
+        Cards are opaque, and evicted least recently used once there are more than MAX_CARDS.
+        Lookups are locked and rendering happens outside the lock, so the prefetch thread can render while the game
+        draws; a card rendered by both at once is only kept once.                                                    */
+class CardCache {
+public:
+    CardCache();
+
+    std::shared_ptr<const Image> get(int index, int layout);
+    bool prefetch(int index, int layout);
+    void clear();
+    void printStats() const;
+
+private:
+    struct Entry {
+        uint32_t key;
+        std::shared_ptr<const Image> card;
+    };
+
+    std::shared_ptr<const Image> lookup(int index, int layout, bool ahead);
+    bool render(int index, int layout, Image* card);
+
+    mutable std::mutex lock;
+    std::list<Entry> lru;   // Most recently used at the front
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> index;
+    unsigned long hitCount;
+    unsigned long missCount;
+    unsigned long evictionCount;
+    unsigned long prefetchCount;    // Cards rendered ahead of time rather than when first drawn
+    double renderSeconds;
+};
+
+extern CardCache Cards;
+
+#endif
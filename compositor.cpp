@@ -0,0 +1,275 @@
+#include "compositor.h"
+#include "image_cache.h"
+#include "memory_ledger.h"
+
+#include <stdio.h>
+
+Compositor Layers;
+
+/* FUNCTION: Grows a bounding box to take in one pixel.
+    Author: Niko
+    Arguments:
+        box - The box (x2/y2 exclusive; empty when x1 >= x2).
+        x, y - The pixel.
+    Returns:
+        NONE                                                  */
+static void growBox(Rect* box, int x, int y) {
+    if (box->x1 >= box->x2) {
+        *box = Rect{x, y, x + 1, y + 1};
+        return;
+    }
+    if (x < box->x1) box->x1 = x;
+    if (y < box->y1) box->y1 = y;
+    if (x + 1 > box->x2) box->x2 = x + 1;
+    if (y + 1 > box->y2) box->y2 = y + 1;
+}
+
+/* FUNCTION: Splits an image into runs of opaque and translucent pixels, dropping everything fully transparent,
+             and works out the bounding boxes of each kind.
+    Author: Niko
+    Arguments:
+        image - The image.
+        layer - Receives the runs, their pixels and the boxes.
+    Returns:
+        NONE                                                                                                       */
+void buildSpans(const Image& image, SpanImage* layer) {
+    layer->width = image.width;
+    layer->height = image.height;
+    layer->spans.clear();
+    layer->pixels.clear();
+    layer->opaqueBox = Rect{0, 0, 0, 0};
+    layer->translucentBox = Rect{0, 0, 0, 0};
+
+    const uint32_t* pixels = image.data();
+    for (int y = 0; y < image.height; y++) {
+        const uint32_t* row = pixels + y * image.width;
+        int x = 0;
+        while (x < image.width) {
+            uint32_t alpha = row[x] >> 24;
+            if (alpha == 0) {
+                x++;
+                continue;
+            }
+
+            bool opaque = alpha == 0xFF;
+            int runEnd = x + 1;
+            while (runEnd < image.width && (row[runEnd] >> 24) != 0 && ((row[runEnd] >> 24) == 0xFF) == opaque) {
+                runEnd++;
+            }
+
+            Span span;
+            span.y = (int16_t)y;
+            span.x1 = (int16_t)x;
+            span.x2 = (int16_t)runEnd;
+            span.opaque = opaque;
+            span.offset = (uint32_t)layer->pixels.size();
+            layer->spans.push_back(span);
+            layer->pixels.insert(layer->pixels.end(), row + x, row + runEnd);
+
+            Rect* box = opaque ? &layer->opaqueBox : &layer->translucentBox;
+            growBox(box, x, y);
+            growBox(box, runEnd - 1, y);
+            x = runEnd;
+        }
+    }
+
+    // Overall bounds: the union of the two boxes
+    layer->bounds = layer->opaqueBox;
+    if (layer->translucentBox.x1 < layer->translucentBox.x2) {
+        growBox(&layer->bounds, layer->translucentBox.x1, layer->translucentBox.y1);
+        growBox(&layer->bounds, layer->translucentBox.x2 - 1, layer->translucentBox.y2 - 1);
+    }
+}
+
+/* FUNCTION: Finds what changed between two same-size frames of an animation: runs of pixels that differ, holding
+             the new frame's pixels. Unlike buildSpans, a pixel that turned transparent is kept (as a translucent
+             run), since whatever it covered has to be brought back.
+    Author: Niko
+    Arguments:
+        previous, next - Consecutive frames.
+        delta - Receives the changed runs and their bounding boxes.
+    Returns:
+        NONE                                                                                                      */
+void buildDeltaSpans(const Image& previous, const Image& next, SpanImage* delta) {
+    delta->width = next.width;
+    delta->height = next.height;
+    delta->spans.clear();
+    delta->pixels.clear();
+    delta->opaqueBox = Rect{0, 0, 0, 0};
+    delta->translucentBox = Rect{0, 0, 0, 0};
+
+    const uint32_t* before = previous.data();
+    const uint32_t* after = next.data();
+    for (int y = 0; y < next.height; y++) {
+        const uint32_t* oldRow = before + y * next.width;
+        const uint32_t* row = after + y * next.width;
+        int x = 0;
+        while (x < next.width) {
+            if (row[x] == oldRow[x]) {
+                x++;
+                continue;
+            }
+
+            bool opaque = (row[x] >> 24) == 0xFF;
+            int runEnd = x + 1;
+            while (runEnd < next.width && row[runEnd] != oldRow[runEnd] && ((row[runEnd] >> 24) == 0xFF) == opaque) {
+                runEnd++;
+            }
+
+            Span span;
+            span.y = (int16_t)y;
+            span.x1 = (int16_t)x;
+            span.x2 = (int16_t)runEnd;
+            span.opaque = opaque;
+            span.offset = (uint32_t)delta->pixels.size();
+            delta->spans.push_back(span);
+            delta->pixels.insert(delta->pixels.end(), row + x, row + runEnd);
+
+            Rect* box = opaque ? &delta->opaqueBox : &delta->translucentBox;
+            growBox(box, x, y);
+            growBox(box, runEnd - 1, y);
+            x = runEnd;
+        }
+    }
+
+    delta->bounds = delta->opaqueBox;
+    if (delta->translucentBox.x1 < delta->translucentBox.x2) {
+        growBox(&delta->bounds, delta->translucentBox.x1, delta->translucentBox.y1);
+        growBox(&delta->bounds, delta->translucentBox.x2 - 1, delta->translucentBox.y2 - 1);
+    }
+}
+
+/* FUNCTION: Draws one image over another of the same size, both possibly translucent ("over" compositing with
+             straight alpha), so that drawing the result matches drawing the two in turn.
+    Author: Niko
+    Arguments:
+        base - The image underneath; receives the result.
+        over - The image on top.
+    Returns:
+        NONE                                                                                                    */
+void flattenOver(Image* base, const Image& over) {
+    const uint32_t* src = over.data();
+    size_t count = base->pixels.size() < (size_t)over.width * over.height ? base->pixels.size() : (size_t)over.width * over.height;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t top = src[i];
+        uint32_t topAlpha = top >> 24;
+        if (topAlpha == 0) {
+            continue;
+        }
+        uint32_t bottom = base->pixels[i];
+        uint32_t bottomAlpha = bottom >> 24;
+        if (topAlpha == 0xFF || bottomAlpha == 0) {
+            base->pixels[i] = top;
+            continue;
+        }
+
+        // Weights scaled by 255 * 255: the top pixel's own alpha, and what shows of the bottom one through it
+        uint32_t topWeight = topAlpha * 255;
+        uint32_t bottomWeight = bottomAlpha * (255 - topAlpha);
+        uint32_t total = topWeight + bottomWeight;
+        uint32_t result = ((total + 127) / 255) << 24;
+        for (int shift = 0; shift <= 16; shift += 8) {
+            uint32_t channel = (((top >> shift) & 0xFF) * topWeight + ((bottom >> shift) & 0xFF) * bottomWeight + total / 2) / total;
+            result |= channel << shift;
+        }
+        base->pixels[i] = result;
+    }
+}
+
+Compositor::Compositor() : builds(0), lookups(0) {
+}
+
+/* FUNCTION: Gets the span layer of one overlay image, building it the first time.
+    Author: Niko
+    Arguments:
+        path - Asset path of the image.
+    Returns:
+        The layer, or an empty pointer if the image can't be loaded. */
+std::shared_ptr<const SpanImage> Compositor::overlay(const char* path) {
+    MEMORY_TAG(MEM_LAYERS);
+    lookups++;
+    auto found = layers.find(path);
+    if (found != layers.end()) {
+        return found->second;
+    }
+
+    std::shared_ptr<const Image> image = Images.get(path);
+    if (!image) {
+        return std::shared_ptr<const SpanImage>();
+    }
+    std::shared_ptr<SpanImage> layer = std::make_shared<SpanImage>();
+    buildSpans(*image, layer.get());
+    builds++;
+
+    layers[path] = layer;
+    return layer;
+}
+
+/* FUNCTION: Gets the span layer of several static overlays flattened into one, building it the first time.
+    Author: Niko
+    Arguments:
+        name - Key to cache the layer under (must not clash with an image path).
+        paths, count - The overlays, bottom first; all should be the same size as the first.
+    Returns:
+        The layer, or an empty pointer if the first image can't be loaded.                                 */
+std::shared_ptr<const SpanImage> Compositor::flatten(const char* name, const char* const* paths, int count) {
+    MEMORY_TAG(MEM_LAYERS);
+    lookups++;
+    auto found = layers.find(name);
+    if (found != layers.end()) {
+        return found->second;
+    }
+
+    std::shared_ptr<const Image> first = count > 0 ? Images.get(paths[0]) : std::shared_ptr<const Image>();
+    if (!first) {
+        return std::shared_ptr<const SpanImage>();
+    }
+    Image flat;
+    flat.width = first->width;
+    flat.height = first->height;
+    flat.pixels.assign(first->data(), first->data() + first->width * first->height);
+
+    for (int i = 1; i < count; i++) {
+        std::shared_ptr<const Image> over = Images.get(paths[i]);
+        if (over && over->width == flat.width && over->height == flat.height) {
+            flattenOver(&flat, *over);
+        } else {
+            printf("Warning: %s can't be flattened into layer %s\n", paths[i], name);
+        }
+    }
+
+    std::shared_ptr<SpanImage> layer = std::make_shared<SpanImage>();
+    buildSpans(flat, layer.get());
+    builds++;
+
+    layers[name] = layer;
+    return layer;
+}
+
+/* FUNCTION: Drops every cached layer.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                         */
+void Compositor::clear() {
+    layers.clear();
+}
+
+/* FUNCTION: Prints layer counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                      */
+void Compositor::printStats() const {
+    unsigned long spans = 0, pixels = 0, screenPixels = 0;
+    for (auto it = layers.begin(); it != layers.end(); ++it) {
+        spans += it->second->spans.size();
+        pixels += it->second->pixels.size();
+        screenPixels += (unsigned long)it->second->width * it->second->height;
+    }
+    printf("Layers: %lu built, %lu lookups, %lu spans holding %lu of %lu pixels (%.1f%%)\n",
+           builds, lookups, spans, pixels, screenPixels, screenPixels ? 100.0 * pixels / screenPixels : 0.0);
+}
@@ -0,0 +1,73 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "display.h"
+#include "image.h"
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* CLASS: One horizontal run of pixels in a layer that are all opaque or all translucent.
+    Author: Niko
+    Members:
+        y, x1, x2 - Row and columns (x2 exclusive), relative to the layer's top-left corner.
+        opaque - Whether the run can be copied instead of blended.
+        offset - Where the run's pixels start in the layer's pixel array.                    */
+struct Span {
+    int16_t y;
+    int16_t x1, x2;
+    uint8_t opaque;
+    uint32_t offset;
+};
+
+/* CLASS: An image reduced to the parts that aren't fully transparent, ready to be drawn over the frame.
+    Author: Niko
+    Members:
+        width, height - Size of the original image.
+        spans - Runs of visible pixels, top to bottom.
+        pixels - The runs' pixels, back to back (everything transparent is dropped).
+        opaqueBox, translucentBox - Bounding boxes of the opaque and the translucent pixels (empty if none).
+        bounds - Bounding box of every visible pixel (the only region drawing the layer can change).         */
+struct SpanImage {
+    int width, height;
+    std::vector<Span> spans;
+    std::vector<uint32_t> pixels;
+    Rect opaqueBox, translucentBox, bounds;
+};
+
+void buildSpans(const Image& image, SpanImage* layer);
+void buildDeltaSpans(const Image& previous, const Image& next, SpanImage* delta);
+void flattenOver(Image* base, const Image& over);
+
+/* CLASS: Builds and caches span layers for static overlays, either one image each or several flattened into one.
+    Author: Niko
+    Members:
+        overlay(path) - The span layer of one image.
+        flatten(name, paths, count) - The span layer of several same-size images drawn over each other in order,
+            cached under name.
+        clear() - Drops every cached layer.
+        printStats() - Prints layer counters.
+    Notes:
+        The layers only depend on the image files, so each is built once per session; drawing one then only touches
+        its visible pixels instead of blending the whole (mostly transparent) screen-sized image.                   */
+class Compositor {
+public:
+    Compositor();
+
+    std::shared_ptr<const SpanImage> overlay(const char* path);
+    std::shared_ptr<const SpanImage> flatten(const char* name, const char* const* paths, int count);
+    void clear();
+    void printStats() const;
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<const SpanImage>> layers;
+    unsigned long builds;
+    unsigned long lookups;
+};
+
+extern Compositor Layers;
+
+#endif
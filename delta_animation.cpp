@@ -0,0 +1,130 @@
+#include "delta_animation.h"
+#include "display.h"
+#include "image_cache.h"
+#include "memory_ledger.h"
+
+#include <stdio.h>
+
+DeltaAnimation::DeltaAnimation() : loaded(false), shown(-1), plays(0), framesShown(0), pixelsDrawn(0) {
+}
+
+/* FUNCTION: Builds the key frame and the deltas between consecutive frames.
+    Author: Niko
+    Arguments:
+        folder - Asset folder of the frames (e.g. "correct_animation").
+        first, last - Numbers of the first and last frame files (first.png through last.png).
+    Returns:
+        true if every frame loaded and they all have the same size.                              */
+bool DeltaAnimation::load(const char* folder, int first, int last) {
+    MEMORY_TAG(MEM_ANIMATIONS);
+    loaded = false;
+    deltas.clear();
+    restores.clear();
+
+    std::shared_ptr<const Image> previous;
+    for (int number = first; number <= last; number++) {
+        char path[64];
+        snprintf(path, sizeof(path), "%s\\%d.png", folder, number);
+        std::shared_ptr<const Image> frame = Images.get(path);
+        if (!frame || (previous && (frame->width != previous->width || frame->height != previous->height))) {
+            printf("Error: animation frame %s is missing or the wrong size\n", path);
+            deltas.clear();
+            return false;
+        }
+
+        if (!previous) {
+            buildSpans(*frame, &key);
+        } else {
+            deltas.push_back(SpanImage());
+            buildDeltaSpans(*previous, *frame, &deltas.back());
+        }
+        previous = frame;
+    }
+
+    restores.resize(deltas.size());
+    loaded = !key.spans.empty() || !deltas.empty();
+    return loaded;
+}
+
+/* FUNCTION: Starts a playback: saves the screen pixels that each delta's translucent runs will be drawn over.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                  */
+void DeltaAnimation::begin() {
+    MEMORY_TAG(MEM_ANIMATIONS);
+    for (size_t i = 0; i < deltas.size(); i++) {
+        SpanImage& restore = restores[i];
+        restore.width = deltas[i].width;
+        restore.height = deltas[i].height;
+        restore.spans.clear();
+        restore.pixels.clear();
+        restore.bounds = deltas[i].translucentBox;
+        restore.opaqueBox = deltas[i].translucentBox;
+        restore.translucentBox = Rect{0, 0, 0, 0};
+
+        for (size_t s = 0; s < deltas[i].spans.size(); s++) {
+            Span span = deltas[i].spans[s];
+            if (span.opaque) {
+                continue;
+            }
+            span.opaque = 1;
+            span.offset = (uint32_t)restore.pixels.size();
+            restore.spans.push_back(span);
+            for (int x = span.x1; x < span.x2; x++) {
+                restore.pixels.push_back(Display.pixel(x, span.y));
+            }
+        }
+    }
+    shown = -1;
+    plays++;
+}
+
+/* FUNCTION: Draws whatever it takes to go from the frame on screen to the requested one.
+    Author: Niko
+    Arguments:
+        frame - The frame to show, 0 to frameCount() - 1 (earlier than the one on screen does nothing).
+    Returns:
+        NONE                                                                                         */
+void DeltaAnimation::show(int frame) {
+    if (!loaded) {
+        return;
+    }
+    if (frame >= frameCount()) {
+        frame = frameCount() - 1;
+    }
+    if (shown < 0) {
+        Display.drawSpans(key, 0, 0);
+        pixelsDrawn += key.pixels.size();
+        shown = 0;
+    }
+    while (shown < frame) {
+        if (!restores[shown].spans.empty()) {
+            Display.drawSpans(restores[shown], 0, 0);
+        }
+        Display.drawSpans(deltas[shown], 0, 0);
+        pixelsDrawn += deltas[shown].pixels.size();
+        shown++;
+    }
+    framesShown++;
+}
+
+/* FUNCTION: Prints frame sizes and playback counters.
+    Author: Niko
+    Arguments:
+        name - What to call the animation.
+    Returns:
+        NONE                                          */
+void DeltaAnimation::printStats(const char* name) const {
+    if (!loaded) {
+        return;
+    }
+    unsigned long deltaPixels = 0;
+    for (size_t i = 0; i < deltas.size(); i++) {
+        deltaPixels += deltas[i].pixels.size();
+    }
+    printf("Delta animation %s: %d frames, key frame %lu px, %.1f px per delta, %lu plays drew %lu px in %lu frames\n", name,
+           frameCount(), (unsigned long)key.pixels.size(), deltas.empty() ? 0.0 : (double)deltaPixels / deltas.size(),
+           plays, pixelsDrawn, framesShown);
+}
@@ -0,0 +1,46 @@
+#ifndef DELTA_ANIMATION_H
+#define DELTA_ANIMATION_H
+
+#include "compositor.h"
+
+#include <vector>
+
+/* CLASS: An overlay animation (full-screen, mostly transparent frames drawn over whatever is on screen) stored as a
+          key frame plus, for every later frame, only the runs of pixels that changed since the one before.
+    Author: Niko
+    Members:
+        load(folder, first, last) - Builds the key frame and deltas from frames first.png to last.png in folder.
+        isLoaded(), frameCount() - Whether it loaded, and how many frames it has.
+        begin() - Starts a playback over the current screen, keeping what the translucent parts of the deltas cover.
+        show(frame) - Brings the screen to a frame (0-based), applying every delta since the last one shown, so
+            frames skipped by the timeline still leave the right pixels behind.
+        printStats(name) - Prints frame sizes and what playback touched.
+    Notes:
+        The answer animations only change a few dozen pixels of the versus badge per frame, so playback touches (and
+        pushes) those instead of blending a whole 320x240 frame 31 times. Runs that aren't opaque are drawn over the
+        background saved by begin(), not over the previous frame, so translucent pixels never build up.              */
+class DeltaAnimation {
+public:
+    DeltaAnimation();
+
+    bool load(const char* folder, int first, int last);
+    bool isLoaded() const { return loaded; }
+    int frameCount() const { return loaded ? (int)deltas.size() + 1 : 0; }
+
+    void begin();
+    void show(int frame);
+    void printStats(const char* name) const;
+
+private:
+    bool loaded;
+    SpanImage key;
+    std::vector<SpanImage> deltas;      // deltas[i] turns frame i into frame i + 1
+    std::vector<SpanImage> restores;    // Screen pixels under deltas[i]'s translucent runs, saved by begin()
+    int shown;                          // Frame on screen, or -1 before the key frame
+
+    unsigned long plays;
+    unsigned long framesShown;
+    unsigned long pixelsDrawn;
+};
+
+#endif
@@ -0,0 +1,489 @@
+#include "display.h"
+#include "compositor.h"
+#include "font.h"
+#include "input.h"
+#include "trace.h"
+
+#include "backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DisplayLayer Display;
+
+/* FUNCTION: Blends a translucent pixel over an opaque one.
+    Author: Niko
+    Arguments:
+        under - Opaque 0xFFRRGGBB pixel already in the frame.
+        over - 0xAARRGGBB pixel drawn on top.
+    Returns:
+        The opaque result.                                      */
+static inline uint32_t blendPixel(uint32_t under, uint32_t over) {
+    uint32_t alpha = over >> 24;
+    uint32_t r = (((over >> 16) & 0xFF) * alpha + ((under >> 16) & 0xFF) * (255 - alpha)) / 255;
+    uint32_t g = (((over >> 8) & 0xFF) * alpha + ((under >> 8) & 0xFF) * (255 - alpha)) / 255;
+    uint32_t b = ((over & 0xFF) * alpha + (under & 0xFF) * (255 - alpha)) / 255;
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+DisplayLayer::DisplayLayer()
+    : back(SCREEN_WIDTH * SCREEN_HEIGHT, 0xFF000000u), front(SCREEN_WIDTH * SCREEN_HEIGHT, 0),
+      lastPushed(0), totalPushed(0), frames(0), textDraws(0), textBatches(0) {
+}
+
+/* FUNCTION: Records a changed region (clipped to the screen).
+    Author: Niko
+    Arguments:
+        x1, y1, x2, y2 - Region corners; x2/y2 are exclusive.
+    Returns:
+        NONE                                                    */
+void DisplayLayer::damage(int x1, int y1, int x2, int y2) {
+    Rect rect = {x1 < 0 ? 0 : x1, y1 < 0 ? 0 : y1,
+                 x2 > SCREEN_WIDTH ? SCREEN_WIDTH : x2, y2 > SCREEN_HEIGHT ? SCREEN_HEIGHT : y2};
+    if (rect.x1 >= rect.x2 || rect.y1 >= rect.y2) {
+        return;
+    }
+
+    // Drop regions the new one covers, and skip the new one if an existing region already covers it
+    for (size_t i = 0; i < dirty.size(); i++) {
+        const Rect& d = dirty[i];
+        if (d.x1 <= rect.x1 && d.y1 <= rect.y1 && d.x2 >= rect.x2 && d.y2 >= rect.y2) {
+            return;
+        }
+    }
+    for (size_t i = 0; i < dirty.size();) {
+        const Rect& d = dirty[i];
+        if (rect.x1 <= d.x1 && rect.y1 <= d.y1 && rect.x2 >= d.x2 && rect.y2 >= d.y2) {
+            dirty[i] = dirty.back();
+            dirty.pop_back();
+        } else {
+            i++;
+        }
+    }
+    dirty.push_back(rect);
+}
+
+/* FUNCTION: Merges dirty regions that overlap or sit close together, so nearby changes are pushed as one region.
+             Two regions are merged when their bounding box is not much bigger than the two of them combined.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                       */
+void DisplayLayer::coalesce() {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < dirty.size() && !merged; i++) {
+            for (size_t j = i + 1; j < dirty.size() && !merged; j++) {
+                Rect a = dirty[i], b = dirty[j];
+                Rect box = {a.x1 < b.x1 ? a.x1 : b.x1, a.y1 < b.y1 ? a.y1 : b.y1,
+                            a.x2 > b.x2 ? a.x2 : b.x2, a.y2 > b.y2 ? a.y2 : b.y2};
+                if (a.intersects(b) || box.area() <= a.area() + b.area() + 1024) {
+                    dirty[i] = box;
+                    dirty[j] = dirty.back();
+                    dirty.pop_back();
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    if (dirty.size() > MAX_DIRTY_RECTS) {
+        Rect box = dirty[0];
+        for (size_t i = 1; i < dirty.size(); i++) {
+            if (dirty[i].x1 < box.x1) box.x1 = dirty[i].x1;
+            if (dirty[i].y1 < box.y1) box.y1 = dirty[i].y1;
+            if (dirty[i].x2 > box.x2) box.x2 = dirty[i].x2;
+            if (dirty[i].y2 > box.y2) box.y2 = dirty[i].y2;
+        }
+        dirty.assign(1, box);
+    }
+}
+
+/* FUNCTION: Sends the pixels of a region that differ from what the LCD already shows.
+             Runs of the same color go out to the backend as one run (a single horizontal line on the LCD).
+    Author: Niko
+    Arguments:
+        rect - Region to push.
+    Returns:
+        Number of pixels sent.                                                            */
+unsigned long DisplayLayer::push(const Rect& rect) {
+    unsigned long pushed = 0;
+
+    for (int y = rect.y1; y < rect.y2; y++) {
+        uint32_t* backRow = back.data() + y * SCREEN_WIDTH;
+        uint32_t* frontRow = front.data() + y * SCREEN_WIDTH;
+
+        int x = rect.x1;
+        while (x < rect.x2) {
+            if (backRow[x] == frontRow[x]) {
+                x++;
+                continue;
+            }
+
+            uint32_t color = backRow[x];
+            int runEnd = x + 1;
+            while (runEnd < rect.x2 && backRow[runEnd] == color && frontRow[runEnd] != color) {
+                runEnd++;
+            }
+
+            Device->drawRun(y, x, runEnd, color & 0xFFFFFF);
+            for (int i = x; i < runEnd; i++) {
+                frontRow[i] = color;
+            }
+            pushed += runEnd - x;
+            x = runEnd;
+        }
+    }
+    return pushed;
+}
+
+/* FUNCTION: Fills the whole frame with one color (replaces LCD.Clear).
+    Author: Niko
+    Arguments:
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                            */
+void DisplayLayer::clear(unsigned int color) {
+    // Text still queued would be painted over anyway
+    textQueue.clear();
+    textChars.clear();
+
+    uint32_t pixel = 0xFF000000u | color;
+    for (size_t i = 0; i < back.size(); i++) {
+        back[i] = pixel;
+    }
+    dirty.clear();
+    damage(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+/* FUNCTION: Fills a rectangle (replaces LCD.FillRectangle).
+    Author: Niko
+    Arguments:
+        x, y - Top-left corner.
+        width, height - Size in pixels.
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                        */
+void DisplayLayer::fillRect(int x, int y, int width, int height, unsigned int color) {
+    flushTextUnder(x, y, x + width, y + height);
+    int x1 = x < 0 ? 0 : x, y1 = y < 0 ? 0 : y;
+    int x2 = x + width > SCREEN_WIDTH ? SCREEN_WIDTH : x + width;
+    int y2 = y + height > SCREEN_HEIGHT ? SCREEN_HEIGHT : y + height;
+    uint32_t pixel = 0xFF000000u | color;
+
+    for (int row = y1; row < y2; row++) {
+        for (int col = x1; col < x2; col++) {
+            back[row * SCREEN_WIDTH + col] = pixel;
+        }
+    }
+    damage(x1, y1, x2, y2);
+}
+
+/* FUNCTION: Draws a one-pixel rectangle outline (replaces LCD.DrawRectangle, same width/height convention).
+    Author: Niko
+    Arguments:
+        x, y - Top-left corner.
+        width, height - Distance to the opposite edges.
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                                                                  */
+void DisplayLayer::drawRect(int x, int y, int width, int height, unsigned int color) {
+    drawLine(x, y, x + width, y, color);
+    drawLine(x, y + height, x + width, y + height, color);
+    drawLine(x, y, x, y + height, color);
+    drawLine(x + width, y, x + width, y + height, color);
+}
+
+/* FUNCTION: Draws a line between two points, both included (replaces LCD.DrawLine).
+    Author: Niko
+    Arguments:
+        x1, y1, x2, y2 - End points.
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                                         */
+void DisplayLayer::drawLine(int x1, int y1, int x2, int y2, unsigned int color) {
+    flushTextUnder(x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, (x1 > x2 ? x1 : x2) + 1, (y1 > y2 ? y1 : y2) + 1);
+    uint32_t pixel = 0xFF000000u | color;
+    int dx = abs(x2 - x1), dy = -abs(y2 - y1);
+    int stepX = x1 < x2 ? 1 : -1, stepY = y1 < y2 ? 1 : -1;
+    int error = dx + dy;
+    int x = x1, y = y1;
+
+    while (true) {
+        if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
+            back[y * SCREEN_WIDTH + x] = pixel;
+        }
+        if (x == x2 && y == y2) {
+            break;
+        }
+        int e2 = 2 * error;
+        if (e2 >= dy) {
+            error += dy;
+            x += stepX;
+        }
+        if (e2 <= dx) {
+            error += dx;
+            y += stepY;
+        }
+    }
+    damage(x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, (x1 > x2 ? x1 : x2) + 1, (y1 > y2 ? y1 : y2) + 1);
+}
+
+/* FUNCTION: Alpha-blends an image into the frame.
+    Author: Niko
+    Arguments:
+        image - The decoded image.
+        x, y - Top-left corner (the image is clipped to the screen).
+    Returns:
+        NONE                                                          */
+void DisplayLayer::drawImage(const Image& image, int x, int y) {
+    flushTextUnder(x, y, x + image.width, y + image.height);
+    int startCol = (x < 0) ? -x : 0;
+    int endCol = (x + image.width > SCREEN_WIDTH) ? SCREEN_WIDTH - x : image.width;
+    int startRow = (y < 0) ? -y : 0;
+    int endRow = (y + image.height > SCREEN_HEIGHT) ? SCREEN_HEIGHT - y : image.height;
+    if (startCol >= endCol || startRow >= endRow) {
+        return;
+    }
+
+    for (int row = startRow; row < endRow; row++) {
+        const uint32_t* src = image.data() + row * image.width;
+        uint32_t* dst = back.data() + (y + row) * SCREEN_WIDTH + x;
+
+        for (int col = startCol; col < endCol; col++) {
+            uint32_t pixel = src[col];
+            uint32_t alpha = pixel >> 24;
+            if (alpha == 0xFF) {
+                dst[col] = pixel;
+            } else if (alpha != 0) {
+                dst[col] = blendPixel(dst[col], pixel);
+            }
+        }
+    }
+    damage(x + startCol, y + startRow, x + endCol, y + endRow);
+}
+
+/* FUNCTION: Draws a prepared overlay: opaque runs are copied, translucent runs are blended, and transparent pixels
+             aren't visited at all. Only the overlay's visible bounds are marked as changed.
+    Author: Niko
+    Arguments:
+        layer - The overlay's spans.
+        x, y - Top-left corner of the overlay (it is clipped to the screen).
+    Returns:
+        NONE                                                                                                       */
+void DisplayLayer::drawSpans(const SpanImage& layer, int x, int y) {
+    TRACE_SCOPE("overlay_blend");
+    flushTextUnder(x + layer.bounds.x1, y + layer.bounds.y1, x + layer.bounds.x2, y + layer.bounds.y2);
+    for (size_t i = 0; i < layer.spans.size(); i++) {
+        const Span& span = layer.spans[i];
+        int row = y + span.y;
+        if (row < 0 || row >= SCREEN_HEIGHT) {
+            continue;
+        }
+        int x1 = x + span.x1, x2 = x + span.x2;
+        const uint32_t* src = layer.pixels.data() + span.offset;
+        if (x1 < 0) {
+            src -= x1;
+            x1 = 0;
+        }
+        if (x2 > SCREEN_WIDTH) {
+            x2 = SCREEN_WIDTH;
+        }
+        if (x1 >= x2) {
+            continue;
+        }
+
+        uint32_t* dst = back.data() + row * SCREEN_WIDTH + x1;
+        if (span.opaque) {
+            memcpy(dst, src, (x2 - x1) * sizeof(uint32_t));
+        } else {
+            for (int col = 0; col < x2 - x1; col++) {
+                dst[col] = blendPixel(dst[col], src[col]);
+            }
+        }
+    }
+    damage(x + layer.bounds.x1, y + layer.bounds.y1, x + layer.bounds.x2, y + layer.bounds.y2);
+}
+
+/* FUNCTION: Draws text with its top-left corner at (x, y) (replaces LCD.SetFontColor + LCD.WriteAt).
+    Author: Niko
+    Arguments:
+        text - The text to draw on one line.
+        x, y - Top-left corner of the first character cell.
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                                                            */
+void DisplayLayer::writeAt(const char* text, int x, int y, unsigned int color) {
+    writeAt(text, (int)strlen(text), x, y, color);
+}
+
+/* FUNCTION: Queues a run of characters that isn't '\0'-terminated (e.g. one line of a laid out string).
+    Author: Niko
+    Arguments:
+        text, length - The characters to draw on one line (copied, so they don't need to outlive the call).
+        x, y - Top-left corner of the first character cell.
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                                                                 */
+void DisplayLayer::writeAt(const char* text, int length, int x, int y, unsigned int color) {
+    QueuedText queued;
+    queued.start = (uint32_t)textChars.size();
+    queued.length = (uint32_t)length;
+    queued.x = x;
+    queued.y = y;
+    queued.color = 0xFF000000u | color;
+
+    Rect area = {x, y, x + length * FONT_CHAR_WIDTH, y + FONT_CHAR_HEIGHT};
+    if (textQueue.empty()) {
+        textBounds = area;
+    } else {
+        textBounds.x1 = area.x1 < textBounds.x1 ? area.x1 : textBounds.x1;
+        textBounds.y1 = area.y1 < textBounds.y1 ? area.y1 : textBounds.y1;
+        textBounds.x2 = area.x2 > textBounds.x2 ? area.x2 : textBounds.x2;
+        textBounds.y2 = area.y2 > textBounds.y2 ? area.y2 : textBounds.y2;
+    }
+    textChars.append(text, length);
+    textQueue.push_back(queued);
+    damage(area.x1, area.y1, area.x2, area.y2);
+}
+
+/* FUNCTION: Flushes the queued text if a draw about to happen could cover any of it.
+    Author: Niko
+    Arguments:
+        x1, y1, x2, y2 - Region the draw can touch; x2/y2 are exclusive.
+    Returns:
+        NONE                                                                         */
+void DisplayLayer::flushTextUnder(int x1, int y1, int x2, int y2) {
+    Rect area = {x1, y1, x2, y2};
+    if (!textQueue.empty() && area.intersects(textBounds)) {
+        flushText();
+    }
+}
+
+/* FUNCTION: Blits every queued text draw into the frame in one batch, each string as a sprite from the glyph atlas.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                         */
+void DisplayLayer::flushText() {
+    if (textQueue.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < textQueue.size(); i++) {
+        const QueuedText& queued = textQueue[i];
+        Glyphs.blitText(back.data(), SCREEN_WIDTH, SCREEN_WIDTH, SCREEN_HEIGHT, textChars.data() + queued.start, queued.length,
+                        queued.x, queued.y, queued.color);
+    }
+    textDraws += textQueue.size();
+    textBatches++;
+    textQueue.clear();
+    textChars.clear();
+}
+
+/* FUNCTION: Pushes this frame's changes to the LCD and shows them (replaces LCD.Update).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                */
+void DisplayLayer::update() {
+    TRACE_SCOPE(TRACE_FRAME_PHASE);
+    flushText();
+    bool overlaid = Trace.overlay();
+    if (overlaid) {
+        drawTraceOverlay();
+    }
+    coalesce();
+
+    lastPushed = 0;
+    for (size_t i = 0; i < dirty.size(); i++) {
+        lastPushed += push(dirty[i]);
+    }
+    dirty.clear();
+
+    // Put the frame back the way the game drew it, so the overlay never ends up in what the game draws over
+    if (overlaid) {
+        for (int y = overlayBox.y1; y < overlayBox.y2; y++) {
+            memcpy(back.data() + y * SCREEN_WIDTH + overlayBox.x1,
+                   underOverlay.data() + (y - overlayBox.y1) * (overlayBox.x2 - overlayBox.x1),
+                   (overlayBox.x2 - overlayBox.x1) * sizeof(uint32_t));
+        }
+        damage(overlayBox.x1, overlayBox.y1, overlayBox.x2, overlayBox.y2);
+    }
+
+    totalPushed += lastPushed;
+    frames++;
+    Device->present();
+    Input.frameShown(Device->now());
+}
+
+/* FUNCTION: Draws the FPS and the busiest phase of the last second (see Tracer::summarize) in the top-left corner,
+             keeping the pixels it covers so update() can put them back once the frame is pushed.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                          */
+void DisplayLayer::drawTraceOverlay() {
+    int frames;
+    const char* busiest;
+    double share;
+    Trace.summarize(&frames, &busiest, &share);
+
+    char text[48];
+    if (busiest) {
+        snprintf(text, sizeof(text), "%d fps %s %.0f%%", frames, busiest, share * 100.0);
+    } else {
+        snprintf(text, sizeof(text), "%d fps", frames);
+    }
+    int length = (int)strlen(text);
+    if (length > (SCREEN_WIDTH - 4) / FONT_CHAR_WIDTH) {
+        length = (SCREEN_WIDTH - 4) / FONT_CHAR_WIDTH;
+    }
+
+    overlayBox.x1 = 0;
+    overlayBox.y1 = 0;
+    overlayBox.x2 = length * FONT_CHAR_WIDTH + 4;
+    overlayBox.y2 = FONT_CHAR_HEIGHT + 2;
+    int width = overlayBox.x2 - overlayBox.x1;
+    underOverlay.resize(width * (overlayBox.y2 - overlayBox.y1));
+    for (int y = overlayBox.y1; y < overlayBox.y2; y++) {
+        memcpy(underOverlay.data() + (y - overlayBox.y1) * width, back.data() + y * SCREEN_WIDTH + overlayBox.x1,
+               width * sizeof(uint32_t));
+    }
+
+    fillRect(overlayBox.x1, overlayBox.y1, width, overlayBox.y2 - overlayBox.y1, BLACK);
+    writeAt(text, length, overlayBox.x1 + 2, overlayBox.y1 + 1, WHITE);
+    flushText();
+}
+
+/* FUNCTION: Marks the LCD's contents as unknown so the next update() repaints every pixel.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                  */
+void DisplayLayer::invalidate() {
+    for (size_t i = 0; i < front.size(); i++) {
+        front[i] = 0;
+    }
+    dirty.clear();
+    damage(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+/* FUNCTION: Prints how many pixels were pushed compared to repainting every frame in full.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                  */
+void DisplayLayer::printStats() const {
+    double fullFrames = (double)frames * SCREEN_WIDTH * SCREEN_HEIGHT;
+    printf("Display: %lu frames, %lu pixels pushed (%.1f per frame, %.1f%% of full repaints), %lu text draws in %lu batches\n",
+           frames, totalPushed, frames ? (double)totalPushed / frames : 0.0,
+           fullFrames > 0 ? 100.0 * totalPushed / fullFrames : 0.0, textDraws, textBatches);
+}
@@ -0,0 +1,100 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "image.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define SCREEN_WIDTH 320
+#define SCREEN_HEIGHT 240
+#define MAX_DIRTY_RECTS 16      // Past this many separate regions a frame is pushed as one bounding box
+
+struct SpanImage;
+
+/* CLASS: A screen region, including x1/y1 and excluding x2/y2.
+    Author: Niko                                                    */
+struct Rect {
+    int x1, y1, x2, y2;
+
+    int area() const { return (x2 - x1) * (y2 - y1); }
+    bool intersects(const Rect& other) const {
+        return x1 < other.x2 && other.x1 < x2 && y1 < other.y2 && other.y1 < y2;
+    }
+};
+
+/* CLASS: Damage-tracking layer between the game and the LCD.
+    Author: Niko
+    Members:
+        clear, fillRect, drawRect, drawLine, drawImage, writeAt - Drawing calls (same coordinates as the LCD's); they only
+            touch an off-screen frame and record the region they changed.
+        drawSpans(layer, x, y) - Draws a prepared overlay (see compositor.h), touching only its visible pixels.
+        flushText() - Draws the text queued by writeAt (done automatically before anything is drawn over it and on update()).
+        update() - Pushes the pixels that actually changed inside the recorded regions to the LCD, then presents the frame
+            (through the backend, see backend.h). With the trace overlay on (see trace.h), the FPS and busiest phase are
+            shown over the frame's top-left corner.
+        invalidate() - Forgets what the LCD shows, so the next update() pushes the whole frame.
+        pixelsPushed() - Pixels sent to the LCD by the last update().
+        printStats() - Prints frame and pixel counters.
+    Notes:
+        The layer keeps a copy of what it last pushed, so redrawing a whole screen that didn't change costs no LCD writes.
+        Images are alpha-blended against the off-screen frame, which the LCD itself can't do.
+        writeAt only queues text; a frame's text draws are blitted together from the glyph atlas (see font.h) when
+        something is drawn over queued text or the frame is pushed, so what ends up on top doesn't change.             */
+class DisplayLayer {
+public:
+    DisplayLayer();
+
+    void clear(unsigned int color);
+    void fillRect(int x, int y, int width, int height, unsigned int color);
+    void drawRect(int x, int y, int width, int height, unsigned int color);
+    void drawLine(int x1, int y1, int x2, int y2, unsigned int color);
+    void drawImage(const Image& image, int x, int y);
+    void drawSpans(const SpanImage& layer, int x, int y);
+    void writeAt(const char* text, int x, int y, unsigned int color);
+    void writeAt(const char* text, int length, int x, int y, unsigned int color);
+    void flushText();
+
+    void update();
+    void invalidate();
+
+    uint32_t pixel(int x, int y) {
+        flushText();
+        return back[y * SCREEN_WIDTH + x];
+    }
+    unsigned long pixelsPushed() const { return lastPushed; }
+    void printStats() const;
+
+private:
+    struct QueuedText {
+        uint32_t start, length;     // Characters in textChars
+        int x, y;
+        uint32_t color;
+    };
+
+    void damage(int x1, int y1, int x2, int y2);
+    void flushTextUnder(int x1, int y1, int x2, int y2);
+    void coalesce();
+    unsigned long push(const Rect& rect);
+    void drawTraceOverlay();
+
+    std::vector<uint32_t> back;     // Frame being drawn (always opaque: 0xFFRRGGBB)
+    std::vector<uint32_t> front;    // What the LCD shows (0 where unknown)
+    std::vector<Rect> dirty;
+    std::vector<QueuedText> textQueue;
+    std::string textChars;
+    Rect textBounds;                // Covers every queued text draw
+    Rect overlayBox;                // Where the trace overlay was drawn this frame
+    std::vector<uint32_t> underOverlay; // The frame's pixels under it
+
+    unsigned long lastPushed;
+    unsigned long totalPushed;
+    unsigned long frames;
+    unsigned long textDraws;
+    unsigned long textBatches;
+};
+
+extern DisplayLayer Display;
+
+#endif
@@ -0,0 +1,333 @@
+#include "emissions.h"
+
+#include <charconv>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+EmissionsDataset Emissions;
+
+EmissionsDataset::EmissionsDataset() : loadSeconds(0.0) {
+    clear();
+}
+
+/* FUNCTION: Removes every activity and unmaps the data file (keeping the arrays' capacity).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                   */
+void EmissionsDataset::clear() {
+    file.close();
+    compiled = false;
+    values.clear();
+    descriptionOffsets.clear();
+    descriptionLengths.clear();
+    noteOffsets.clear();
+    noteLengths.clear();
+    lineErrors.clear();
+    descriptionBase = "";
+    noteBase = "";
+    stringsLength = 0;
+    useArrays();
+}
+
+/* FUNCTION: Points the accessors at the arrays built from a text file.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                             */
+void EmissionsDataset::useArrays() {
+    count = (int)values.size();
+    valueTable = values.data();
+    descriptionOffsetTable = descriptionOffsets.data();
+    descriptionLengthTable = descriptionLengths.data();
+    noteOffsetTable = noteOffsets.data();
+    noteLengthTable = noteLengths.data();
+}
+
+/* FUNCTION: Records one activity whose strings are already inside the text the offsets are relative to.
+    Author: Niko
+    Arguments:
+        description, descriptionLength - The activity's description.
+        value - Its emissions value in kg CO2eq.
+        note, noteLength - Its note (length 0 for none).
+    Returns:
+        NONE                                                                                               */
+void EmissionsDataset::addView(const char* description, size_t descriptionLength, double value, const char* note, size_t noteLength) {
+    values.push_back(value);
+    descriptionOffsets.push_back((uint32_t)(description - descriptionBase));
+    descriptionLengths.push_back((uint32_t)descriptionLength);
+    noteOffsets.push_back((uint32_t)(note - noteBase));
+    noteLengths.push_back((uint32_t)noteLength);
+}
+
+/* FUNCTION: Strips one pair of double quotes around a field, if it has them.
+    Author: Niko
+    Arguments:
+        start, end - The field; narrowed in place.
+    Returns:
+        NONE                                                                     */
+static void unquote(const char** start, const char** end) {
+    if (*end - *start >= 2 && **start == '"' && (*end)[-1] == '"') {
+        (*start)++;
+        (*end)--;
+    }
+}
+
+/* FUNCTION: Tokenizes @-separated data in a single pass (after a quick line count to size the arrays). Each line is "description@value@note" (the note may be left
+             out); fields are recorded as offsets into the text rather than copied. Bad lines are recorded in errors()
+             and skipped, and there is no limit on the number of lines or the length of a field.
+    Author: Niko
+    Arguments:
+        text, length - The data (doesn't need to be '\0'-terminated, and must outlive the dataset's use of it).
+    Returns:
+        Number of activities loaded.                                                                                 */
+int EmissionsDataset::parse(const char* text, size_t length) {
+    auto started = std::chrono::steady_clock::now();
+
+    if (text != (const char*)file.data()) {
+        clear();
+    }
+    descriptionBase = text;
+    noteBase = text;
+    stringsLength = length;
+
+    // Counting lines first (memchr is far faster than the tokenizer) lets the arrays be sized exactly
+    size_t expectedRows = 0;
+    for (const char* p = text; p < text + length; p++) {
+        p = (const char*)memchr(p, '\n', text + length - p);
+        if (!p) {
+            break;
+        }
+        expectedRows++;
+    }
+    expectedRows++;
+    values.reserve(expectedRows);
+    descriptionOffsets.reserve(expectedRows);
+    descriptionLengths.reserve(expectedRows);
+    noteOffsets.reserve(expectedRows);
+    noteLengths.reserve(expectedRows);
+
+    const char* end = text + length;
+    const char* line = text;
+    int lineNumber = 0;
+
+    while (line < end) {
+        const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        const char* next = lineEnd < end ? lineEnd + 1 : end;
+        lineNumber++;
+
+        if (lineEnd > line && lineEnd[-1] == '\r') {
+            lineEnd--;
+        }
+        if (lineEnd == line) {
+            line = next;
+            continue;
+        }
+
+        const char* separator = (const char*)memchr(line, '@', lineEnd - line);
+        if (!separator) {
+            lineErrors.push_back(DataError{lineNumber, "no '@' between the description and the value"});
+            line = next;
+            continue;
+        }
+        if (separator == line) {
+            lineErrors.push_back(DataError{lineNumber, "empty description"});
+            line = next;
+            continue;
+        }
+
+        const char* number = separator + 1;
+        while (number < lineEnd && *number == ' ') {
+            number++;
+        }
+        double value;
+        std::from_chars_result result = std::from_chars(number, lineEnd, value);
+        if (result.ec != std::errc()) {
+            lineErrors.push_back(DataError{lineNumber, "the value is not a number"});
+            line = next;
+            continue;
+        }
+        if (result.ptr < lineEnd && *result.ptr != '@') {
+            lineErrors.push_back(DataError{lineNumber, "unexpected text after the value"});
+            line = next;
+            continue;
+        }
+
+        const char* descriptionStart = line;
+        const char* descriptionEnd = separator;
+        const char* noteStart = result.ptr < lineEnd ? result.ptr + 1 : lineEnd;
+        const char* noteEnd = lineEnd;
+        unquote(&descriptionStart, &descriptionEnd);
+        unquote(&noteStart, &noteEnd);
+
+        addView(descriptionStart, descriptionEnd - descriptionStart, value, noteStart, noteEnd - noteStart);
+        line = next;
+    }
+
+    useArrays();
+    loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return size();
+}
+
+/* FUNCTION: Memory-maps a data file and parses it, printing each line that had to be skipped.
+    Author: Niko
+    Arguments:
+        path - The data file (realistically @SV, since the notes are full of commas).
+    Returns:
+        count - Number of activity/emissions pair entries loaded (0 if the file can't be opened). */
+int EmissionsDataset::load(const char* path) {
+    clear();
+
+    if (!file.open(path)) {
+        printf("Error: Unable to open the data file %s.\n", path);
+        return 0;
+    }
+    int count = parse((const char*)file.data(), file.size());
+
+    for (size_t i = 0; i < lineErrors.size() && i < MAX_REPORTED_DATA_ERRORS; i++) {
+        printf("%s:%d: %s, skipping the line\n", path, lineErrors[i].line, lineErrors[i].message);
+    }
+    if (lineErrors.size() > MAX_REPORTED_DATA_ERRORS) {
+        printf("%s: %lu more bad lines skipped\n", path, (unsigned long)(lineErrors.size() - MAX_REPORTED_DATA_ERRORS));
+    }
+
+    printf("Successfully loaded %i data entries from %s in %.1f ms.\n", count, path, loadSeconds * 1000.0);
+    return count;
+}
+
+/* FUNCTION: Memory-maps a compiled dataset and points the accessors straight at its tables. The offset tables are
+             checked once here so no string can run past its section; the strings themselves are paged in as the game
+             touches them.
+    Author: Niko
+    Arguments:
+        path - The compiled dataset (see tools/compile_emissions).
+    Returns:
+        Number of activities, or 0 if the file is missing or not a valid compiled dataset.            */
+int EmissionsDataset::loadBinary(const char* path) {
+    auto started = std::chrono::steady_clock::now();
+    clear();
+
+    if (!file.open(path) || file.size() < sizeof(EmissionsBinaryHeader)) {
+        file.close();
+        return 0;
+    }
+
+    const unsigned char* data = file.data();
+    uint64_t fileSize = file.size();
+    EmissionsBinaryHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    // Sizes are checked against what is left after their offset, so a huge offset can't wrap the sum around
+    bool valid = memcmp(header.magic, EMISSIONS_BINARY_MAGIC, 4) == 0 && header.version == EMISSIONS_BINARY_VERSION &&
+                 header.valuesOffset % EMISSIONS_TABLE_ALIGNMENT == 0 && header.tablesOffset % EMISSIONS_TABLE_ALIGNMENT == 0 &&
+                 header.valuesOffset <= fileSize && sizeof(double) * header.count <= fileSize - header.valuesOffset &&
+                 header.tablesOffset <= fileSize && 4ull * sizeof(uint32_t) * header.count <= fileSize - header.tablesOffset &&
+                 header.descriptionsOffset <= fileSize && header.descriptionsSize <= fileSize - header.descriptionsOffset &&
+                 header.notesOffset <= fileSize && header.notesSize <= fileSize - header.notesOffset;
+
+    // Every string has to lie inside its own section
+    const uint32_t* tables = (const uint32_t*)(data + header.tablesOffset);
+    for (uint32_t i = 0; valid && i < header.count; i++) {
+        uint64_t descriptionOffset = tables[i], descriptionLength = tables[header.count + i];
+        uint64_t noteOffset = tables[2 * header.count + i], noteLength = tables[3 * header.count + i];
+        valid = descriptionOffset + descriptionLength <= header.descriptionsSize &&
+                noteOffset + noteLength <= header.notesSize;
+    }
+    if (!valid) {
+        printf("Error: %s is not a valid compiled dataset.\n", path);
+        file.close();
+        return 0;
+    }
+
+    compiled = true;
+    count = (int)header.count;
+    valueTable = (const double*)(data + header.valuesOffset);
+    descriptionOffsetTable = (const uint32_t*)(data + header.tablesOffset);
+    descriptionLengthTable = descriptionOffsetTable + header.count;
+    noteOffsetTable = descriptionLengthTable + header.count;
+    noteLengthTable = noteOffsetTable + header.count;
+    descriptionBase = (const char*)data + header.descriptionsOffset;
+    noteBase = (const char*)data + header.notesOffset;
+    stringsLength = header.descriptionsSize + header.notesSize;
+
+    loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    printf("Successfully loaded %i data entries from %s in %.1f ms.\n", count, path, loadSeconds * 1000.0);
+    return count;
+}
+
+/* FUNCTION: Works out where a text data file's compiled dataset lives: the same path with ".bin" in place of ".csv".
+    Author: Niko
+    Arguments:
+        sourcePath - The text data file.
+        binaryPath, size - Receives the compiled dataset's path.
+    Returns:
+        NONE                                                                                                     */
+void compiledDatasetPath(const char* sourcePath, char* binaryPath, size_t size) {
+    size_t length = strlen(sourcePath);
+    if (length >= 4 && strcmp(sourcePath + length - 4, ".csv") == 0) {
+        length -= 4;
+    }
+    snprintf(binaryPath, size, "%.*s.bin", (int)length, sourcePath);
+}
+
+/* FUNCTION: Tells whether a compiled dataset can be used in place of its text file: it has to be valid and
+             compiled from the text file as it is now (same size and modification time), or the text file has to
+             be gone.
+    Author: Niko
+    Arguments:
+        binaryPath - The compiled dataset.
+        sourcePath - The text file it was compiled from.
+    Returns:
+        true if the compiled dataset is up to date.                                                            */
+bool binaryDatasetIsFresh(const char* binaryPath, const char* sourcePath) {
+    FILE* file = fopen(binaryPath, "rb");
+    if (!file) {
+        return false;
+    }
+    EmissionsBinaryHeader header;
+    bool read = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+    if (!read || memcmp(header.magic, EMISSIONS_BINARY_MAGIC, 4) != 0 || header.version != EMISSIONS_BINARY_VERSION) {
+        return false;
+    }
+
+    struct stat source;
+    if (stat(sourcePath, &source) != 0) {
+        return true;
+    }
+    if ((uint64_t)source.st_size != header.sourceSize || (int64_t)source.st_mtime != header.sourceTime) {
+        printf("%s is older than %s, loading the text file (rebuild it with make data)\n", binaryPath, sourcePath);
+        return false;
+    }
+    return true;
+}
+
+/* FUNCTION: Adds up the memory held by the dataset.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        Bytes allocated for the arrays (the mapped file is paged in by the OS and not counted). */
+size_t EmissionsDataset::memoryUsed() const {
+    return values.capacity() * sizeof(double) + lineErrors.capacity() * sizeof(DataError) +
+           (descriptionOffsets.capacity() + descriptionLengths.capacity() + noteOffsets.capacity() + noteLengths.capacity()) * sizeof(uint32_t);
+}
+
+/* FUNCTION: Prints size and memory counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                   */
+void EmissionsDataset::printStats() const {
+    printf("Emissions: %d activities from a %s file, %lu bad lines skipped, %lu bytes of strings, %lu bytes allocated\n",
+           size(), compiled ? "compiled" : "text", (unsigned long)lineErrors.size(), (unsigned long)stringsLength,
+           (unsigned long)memoryUsed());
+}
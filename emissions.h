@@ -0,0 +1,128 @@
+#ifndef EMISSIONS_H
+#define EMISSIONS_H
+
+#include "mapped_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+#define EMISSIONS_FILE "emissions_data.csv"
+#define MAX_REPORTED_DATA_ERRORS 20     // Bad lines printed individually before the rest are only counted
+
+/* Compiled dataset layout (written by tools/compile_emissions, all integers little-endian):
+       EmissionsBinaryHeader
+       double values[count]                                  fixed-stride value table
+       uint32_t descriptionOffsets[count], descriptionLengths[count], noteOffsets[count], noteLengths[count]
+       descriptions, back to back (offsets are relative to descriptionsOffset)
+       notes, starting on an EMISSIONS_NOTES_ALIGNMENT boundary (offsets are relative to notesOffset)
+   Tables start on EMISSIONS_TABLE_ALIGNMENT boundaries. Strings are not '\0'-terminated.                      */
+
+#define EMISSIONS_BINARY_FILE "emissions_data.bin"
+#define EMISSIONS_BINARY_MAGIC "MGED"
+#define EMISSIONS_BINARY_VERSION 1
+#define EMISSIONS_TABLE_ALIGNMENT 16
+#define EMISSIONS_NOTES_ALIGNMENT 4096  // Page size, so the notes share no page with data read at startup
+
+struct EmissionsBinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t sourceSize;        // Size and modification time of the text file it was compiled from,
+    int64_t sourceTime;         // so a stale binary can be spotted without reading the text
+    uint64_t valuesOffset;
+    uint64_t tablesOffset;
+    uint64_t descriptionsOffset;
+    uint64_t descriptionsSize;
+    uint64_t notesOffset;
+    uint64_t notesSize;
+};
+
+static_assert(sizeof(EmissionsBinaryHeader) == 80, "EmissionsBinaryHeader must match the on-disk layout");
+
+/* CLASS: One line of a data file that couldn't be loaded.
+    Author: Niko
+    Members:
+        line - 1-based line number.
+        message - What was wrong with it.  */
+struct DataError {
+    int line;
+    const char* message;
+};
+
+/* CLASS: Every activity and its CO2 emissions (i.e., the "prompts" in the context of a higher-or-lower game), stored
+          as parallel arrays of values and string offsets instead of an array of fixed-size records.
+    Author: Niko
+    Members:
+        load(path) - Memory-maps an @-separated "description@value@note" file and parses it; returns the number of
+            activities loaded.
+        loadBinary(path) - Memory-maps a compiled dataset; returns the number of activities, or 0 if it isn't valid.
+        parse(text, length) - Parses data that is already in memory (the buffer must outlive the dataset's use of it).
+        clear() - Removes every activity and unmaps the file.
+        size() - Number of activities.
+        value(i) - The activity's LCA (life cycle analysis) or direct emissions value in kg CO2eq.
+        description(i) - A description of the activity (e.g., "Generating 1 kg of coffee").
+        note(i) - Additional information or fun fact about the activity (empty if there is none).
+        errors() - Lines the last text load skipped.
+        memoryUsed() - Bytes allocated for the arrays (the mapped file isn't counted).
+        printStats() - Prints size and memory counters.
+    Notes:
+        Strings are views straight into the mapped file and are NOT '\0'-terminated. A text file still needs its
+        arrays built; a compiled one is used in place, so loading it is a header check, and the notes section is
+        only paged in when a note is actually shown. The comparison in the game only touches the value table.      */
+class EmissionsDataset {
+public:
+    EmissionsDataset();
+
+    int load(const char* path);
+    int loadBinary(const char* path);
+    int parse(const char* text, size_t length);
+    void clear();
+
+    int size() const { return count; }
+    double value(int i) const { return valueTable[i]; }
+    std::string_view description(int i) const {
+        return std::string_view(descriptionBase + descriptionOffsetTable[i], descriptionLengthTable[i]);
+    }
+    std::string_view note(int i) const { return std::string_view(noteBase + noteOffsetTable[i], noteLengthTable[i]); }
+
+    const std::vector<DataError>& errors() const { return lineErrors; }
+    size_t memoryUsed() const;
+    void printStats() const;
+
+private:
+    void addView(const char* description, size_t descriptionLength, double value, const char* note, size_t noteLength);
+    void useArrays();
+
+    MappedFile file;
+    bool compiled;
+
+    // What the accessors read: the arrays below for a text file, or the tables inside a compiled file
+    int count;
+    const double* valueTable;
+    const uint32_t* descriptionOffsetTable;
+    const uint32_t* descriptionLengthTable;
+    const uint32_t* noteOffsetTable;
+    const uint32_t* noteLengthTable;
+    const char* descriptionBase;
+    const char* noteBase;
+    size_t stringsLength;
+
+    std::vector<double> values;
+    std::vector<uint32_t> descriptionOffsets;
+    std::vector<uint32_t> descriptionLengths;
+    std::vector<uint32_t> noteOffsets;
+    std::vector<uint32_t> noteLengths;
+
+    std::vector<DataError> lineErrors;
+    double loadSeconds;
+};
+
+void compiledDatasetPath(const char* sourcePath, char* binaryPath, size_t size);
+bool binaryDatasetIsFresh(const char* binaryPath, const char* sourcePath);
+
+extern EmissionsDataset Emissions;
+
+#endif
@@ -0,0 +1,248 @@
+#include "font.h"
+#include "memory_ledger.h"
+
+#include <stdio.h>
+
+/* Classic 5x7 ASCII font (0x20 through 0x7E). Each glyph is 5 columns, least significant bit at the top. */
+static const unsigned char FONT_5X7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+    {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A},
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+    {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},
+    {0x38, 0x44, 0x44, 0x48, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00}, {0x7F, 0x10, 0x28, 0x44, 0x00},
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78}, {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},
+    {0x7C, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C},
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C}, {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},
+    {0x00, 0x00, 0x7F, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x10, 0x08, 0x08, 0x10, 0x08},
+};
+
+/* FUNCTION: Tells whether a dot of a character's 5x7 glyph is set.
+    Author: Niko
+    Arguments:
+        c - The character (anything outside printable ASCII draws as '?').
+        column, row - Dot position, 0-4 and 0-6.
+    Returns:
+        true if the dot is part of the glyph.                                  */
+bool fontGlyphDot(char c, int column, int row) {
+    unsigned char code = (unsigned char)c;
+    if (code < 0x20 || code > 0x7E) {
+        code = '?';
+    }
+    return (FONT_5X7[code - 0x20][column] >> row) & 1;
+}
+
+/* FUNCTION: Rasterizes one character into a pixel buffer, the way the FEH LCD draws it (each dot a 2x2 block).
+             Only the glyph's dots are written; the rest of the character cell is left untouched.
+    Author: Niko
+    Arguments:
+        pixels, stride - Destination buffer and its row length in pixels.
+        width, height - Drawable area of the buffer (dots outside it are clipped).
+        c - Character to draw.
+        x, y - Top-left corner of the character cell.
+        color - Pixel value to write.
+    Returns:
+        NONE                                                                                                       */
+void drawGlyph(uint32_t* pixels, int stride, int width, int height, char c, int x, int y, uint32_t color) {
+    for (int column = 0; column < 5; column++) {
+        for (int row = 0; row < 7; row++) {
+            if (!fontGlyphDot(c, column, row)) {
+                continue;
+            }
+            int dotX = x + 1 + column * FONT_DOT_SIZE;
+            int dotY = y + 1 + row * FONT_DOT_SIZE;
+            for (int dy = 0; dy < FONT_DOT_SIZE; dy++) {
+                for (int dx = 0; dx < FONT_DOT_SIZE; dx++) {
+                    int px = dotX + dx, py = dotY + dy;
+                    if (px >= 0 && px < width && py >= 0 && py < height) {
+                        pixels[py * stride + px] = color;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* FUNCTION: Rasterizes a run of characters on one line (see drawGlyph).
+    Author: Niko
+    Arguments:
+        pixels, stride - Destination buffer and its row length in pixels.
+        width, height - Drawable area of the buffer.
+        text, length - The characters (don't need to be '\0'-terminated).
+        x, y - Top-left corner of the first character cell.
+        advance - Distance between character cells in px.
+        color - Pixel value to write.
+    Returns:
+        NONE                                                               */
+void drawGlyphRun(uint32_t* pixels, int stride, int width, int height, const char* text, int length, int x, int y, int advance, uint32_t color) {
+    if (advance == FONT_CHAR_WIDTH) {
+        Glyphs.blitText(pixels, stride, width, height, text, length, x, y, color);
+        return;
+    }
+    for (int i = 0; i < length; i++) {
+        Glyphs.blit(pixels, stride, width, height, Glyphs.glyph(text[i]), x + i * advance, y, color);
+    }
+}
+
+GlyphAtlas Glyphs;
+
+GlyphAtlas::GlyphAtlas() : spriteHits(0), spriteMisses(0) {
+    build();
+}
+
+/* FUNCTION: Rasterizes every glyph into runs, exactly the pixels drawGlyph would write.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                               */
+void GlyphAtlas::build() {
+    MEMORY_TAG(MEM_TEXT);
+    for (int code = 0; code < 95; code++) {
+        std::vector<GlyphRun>& runs = glyphs[code];
+        for (int py = 0; py < FONT_CHAR_HEIGHT; py++) {
+            int row = (py - 1) / FONT_DOT_SIZE;
+            if (py < 1 || row >= 7) {
+                continue;
+            }
+            int runStart = -1;
+            for (int px = 0; px <= FONT_CHAR_WIDTH; px++) {
+                int column = (px - 1) / FONT_DOT_SIZE;
+                bool set = px >= 1 && column < 5 && px < FONT_CHAR_WIDTH && fontGlyphDot((char)(code + 0x20), column, row);
+                if (set && runStart < 0) {
+                    runStart = px;
+                } else if (!set && runStart >= 0) {
+                    runs.push_back(GlyphRun{(int16_t)py, (int16_t)runStart, (int16_t)px});
+                    runStart = -1;
+                }
+            }
+        }
+    }
+}
+
+/* FUNCTION: Gets one character's glyph.
+    Author: Niko
+    Arguments:
+        c - The character (anything outside printable ASCII draws as '?').
+    Returns:
+        The glyph's runs.                                                    */
+const std::vector<GlyphRun>& GlyphAtlas::glyph(char c) const {
+    unsigned char code = (unsigned char)c;
+    if (code < 0x20 || code > 0x7E) {
+        code = '?';
+    }
+    return glyphs[code - 0x20];
+}
+
+/* FUNCTION: Gets a string's sprite, merging its glyphs' runs row by row the first time it is drawn.
+    Author: Niko
+    Arguments:
+        text, length - The string (doesn't need to be '\0'-terminated).
+    Returns:
+        The string's runs, top to bottom (valid until the next call; the caller holds the lock).        */
+const std::vector<GlyphRun>& GlyphAtlas::sprite(const char* text, int length) {
+    MEMORY_TAG(MEM_TEXT);
+    std::string key(text, length);
+    auto found = sprites.find(key);
+    if (found != sprites.end()) {
+        spriteHits++;
+        return found->second;
+    }
+
+    spriteMisses++;
+    if (sprites.size() >= MAX_TEXT_SPRITES) {
+        sprites.clear();
+    }
+    std::vector<GlyphRun>& runs = sprites[key];
+    for (int py = 0; py < FONT_CHAR_HEIGHT; py++) {
+        for (int i = 0; i < length; i++) {
+            const std::vector<GlyphRun>& glyphRuns = glyph(text[i]);
+            for (size_t j = 0; j < glyphRuns.size(); j++) {
+                if (glyphRuns[j].y != py) {
+                    continue;
+                }
+                int16_t x1 = (int16_t)(glyphRuns[j].x1 + i * FONT_CHAR_WIDTH);
+                int16_t x2 = (int16_t)(glyphRuns[j].x2 + i * FONT_CHAR_WIDTH);
+                // Runs that touch across neighbouring cells become one
+                if (!runs.empty() && runs.back().y == py && runs.back().x2 == x1) {
+                    runs.back().x2 = x2;
+                } else {
+                    runs.push_back(GlyphRun{(int16_t)py, x1, x2});
+                }
+            }
+        }
+    }
+    return runs;
+}
+
+/* FUNCTION: Fills rasterized text into a pixel buffer.
+    Author: Niko
+    Arguments:
+        pixels, stride - Destination buffer and its row length in pixels.
+        width, height - Drawable area of the buffer (runs outside it are clipped).
+        runs - A glyph or sprite.
+        x, y - Top-left corner of its first character cell.
+        color - Pixel value to write.
+    Returns:
+        NONE                                                                         */
+void GlyphAtlas::blit(uint32_t* pixels, int stride, int width, int height, const std::vector<GlyphRun>& runs, int x, int y, uint32_t color) const {
+    for (size_t i = 0; i < runs.size(); i++) {
+        int row = y + runs[i].y;
+        if (row < 0 || row >= height) {
+            continue;
+        }
+        int x1 = x + runs[i].x1, x2 = x + runs[i].x2;
+        if (x1 < 0) {
+            x1 = 0;
+        }
+        if (x2 > width) {
+            x2 = width;
+        }
+        uint32_t* dst = pixels + row * stride;
+        for (int col = x1; col < x2; col++) {
+            dst[col] = color;
+        }
+    }
+}
+
+/* FUNCTION: Blits a string from its sprite, rasterizing the sprite the first time the string is drawn.
+    Author: Niko
+    Arguments:
+        pixels, stride - Destination buffer and its row length in pixels.
+        width, height - Drawable area of the buffer.
+        text, length - The string (doesn't need to be '\0'-terminated).
+        x, y - Top-left corner of its first character cell.
+        color - Pixel value to write.
+    Returns:
+        NONE                                                                                               */
+void GlyphAtlas::blitText(uint32_t* pixels, int stride, int width, int height, const char* text, int length, int x, int y, uint32_t color) {
+    std::lock_guard<std::mutex> guard(lock);
+    blit(pixels, stride, width, height, sprite(text, length), x, y, color);
+}
+
+/* FUNCTION: Prints sprite counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                       */
+void GlyphAtlas::printStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    unsigned long lookups = spriteHits + spriteMisses;
+    printf("Glyphs: %lu text sprites blitted, %lu rasterized (%.1f%% reused), %lu kept\n", spriteHits, spriteMisses,
+           lookups ? 100.0 * spriteHits / lookups : 0.0, (unsigned long)sprites.size());
+}
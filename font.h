@@ -0,0 +1,66 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define FONT_CHAR_WIDTH 12      // Same character cell as the FEH LCD font: 5x7 glyphs drawn with 2x2 dots
+#define FONT_CHAR_HEIGHT 17
+#define FONT_DOT_SIZE 2
+#define MAX_TEXT_SPRITES 128    // Strings kept pre-rasterized before the sprite cache starts over
+
+bool fontGlyphDot(char c, int column, int row);
+void drawGlyph(uint32_t* pixels, int stride, int width, int height, char c, int x, int y, uint32_t color);
+void drawGlyphRun(uint32_t* pixels, int stride, int width, int height, const char* text, int length, int x, int y, int advance, uint32_t color);
+
+/* CLASS: A horizontal run of set pixels in rasterized text.
+    Author: Niko
+    Members:
+        y - Pixel row, relative to the top of the character cell.
+        x1, x2 - Pixel columns (x2 exclusive), relative to the left edge of the first character cell. */
+struct GlyphRun {
+    int16_t y;
+    int16_t x1, x2;
+};
+
+/* CLASS: Pre-rasterized font: every glyph as runs of set pixels, plus whole strings cached as sprites (their glyphs'
+          runs merged row by row).
+    Author: Niko
+    Members:
+        glyph(c) - Runs of one character's glyph, top to bottom.
+        blit(pixels, stride, width, height, runs, x, y, color) - Fills the runs into a pixel buffer, clipped.
+        blitText(pixels, stride, width, height, text, length, x, y, color) - Blits a whole string at FONT_CHAR_WIDTH
+            spacing from its sprite, which is built on a miss.
+        printStats() - Prints sprite counters.
+    Notes:
+        Runs are masks, so one atlas serves every text color: drawing is a fill per run instead of testing 35 dots
+        and writing 2x2 blocks per character. Text drawn every frame (labels, scores, the losing screen's lines) is
+        rasterized once and blitted from then on.
+        The glyphs are built up front and never change; the sprite cache is locked, since cards are also rendered on
+        the prefetch thread.                                                                                       */
+class GlyphAtlas {
+public:
+    GlyphAtlas();
+
+    const std::vector<GlyphRun>& glyph(char c) const;
+    void blit(uint32_t* pixels, int stride, int width, int height, const std::vector<GlyphRun>& runs, int x, int y, uint32_t color) const;
+    void blitText(uint32_t* pixels, int stride, int width, int height, const char* text, int length, int x, int y, uint32_t color);
+    void printStats() const;
+
+private:
+    void build();
+    const std::vector<GlyphRun>& sprite(const char* text, int length);
+
+    std::vector<GlyphRun> glyphs[95];
+    mutable std::mutex lock;    // Guards the sprites and their counters
+    std::unordered_map<std::string, std::vector<GlyphRun>> sprites;
+    unsigned long spriteHits;
+    unsigned long spriteMisses;
+};
+
+extern GlyphAtlas Glyphs;
+
+#endif
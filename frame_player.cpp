@@ -0,0 +1,246 @@
+#include "frame_player.h"
+#include "image_cache.h"
+#include "memory_ledger.h"
+#include "trace.h"
+#include "backend.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+
+/* FUNCTION: Builds the ordered frame list for an animation folder.
+             If the folder has a manifest.txt ("<file> <delay in ms>" per line, '#' for comments) it is used as is;
+             otherwise every frame_XX_delay-Ys.png in the folder is used, ordered by XX, with its delay taken from the name.
+    Author: Niko
+    Arguments:
+        folder - Asset path of the folder, with or without a trailing separator (e.g. "GIFs\\3\\").
+        frames - Receives the frame list.
+    Returns:
+        true if at least one frame was found.                                                                           */
+bool loadFrameSequence(const char* folder, std::vector<FrameInfo>* frames) {
+    frames->clear();
+
+    std::string prefix = folder;
+    if (!prefix.empty() && prefix.back() != '\\' && prefix.back() != '/') {
+        prefix += '\\';
+    }
+
+    FILE* manifest = openAsset((prefix + "manifest.txt").c_str(), "r");
+    if (manifest) {
+        char line[256];
+        while (fgets(line, sizeof(line), manifest)) {
+            char name[200];
+            double delayMs;
+            if (line[0] == '#' || sscanf(line, "%199s %lf", name, &delayMs) != 2) {
+                continue;
+            }
+            FrameInfo frame;
+            frame.path = prefix + name;
+            frame.delay = delayMs / 1000.0;
+            frames->push_back(frame);
+        }
+        fclose(manifest);
+        return !frames->empty();
+    }
+
+    char nativeFolder[512];
+    toNativePath(prefix.c_str(), nativeFolder, sizeof(nativeFolder));
+
+    std::vector<std::pair<int, FrameInfo>> found;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(nativeFolder, error), end; !error && it != end; it.increment(error)) {
+        std::string name = it->path().filename().string();
+        int number;
+        double delay;
+        if (sscanf(name.c_str(), "frame_%d_delay-%lfs.png", &number, &delay) != 2) {
+            continue;
+        }
+        FrameInfo frame;
+        frame.path = prefix + name;
+        frame.delay = delay;
+        found.push_back(std::make_pair(number, frame));
+    }
+
+    std::sort(found.begin(), found.end(),
+              [](const std::pair<int, FrameInfo>& a, const std::pair<int, FrameInfo>& b) { return a.first < b.first; });
+    for (size_t i = 0; i < found.size(); i++) {
+        frames->push_back(found[i].second);
+    }
+    return !frames->empty();
+}
+
+FramePlayer::FramePlayer(int slots)
+    : ring(slots < 2 ? 2 : slots), stopping(false), writeSeq(0), readSeq(0), holding(false),
+      lastStarvedSeq(-1), nextDue(-1.0), plays(0), shownCount(0), droppedCount(0), starvedCount(0) {
+}
+
+FramePlayer::~FramePlayer() {
+    close();
+}
+
+/* FUNCTION: Loads an animation folder's frame list and starts decoding it in the background.
+    Author: Niko
+    Arguments:
+        folder - Asset path of the animation folder.
+    Returns:
+        true if the folder had frames to play.                                            */
+bool FramePlayer::open(const char* folder) {
+    MEMORY_TAG(MEM_GIF_FRAMES);
+    close();
+    if (!loadFrameSequence(folder, &frames)) {
+        printf("Error: No animation frames found in %s\n", folder);
+        return false;
+    }
+
+    stopping = false;
+    writeSeq = 0;
+    readSeq = 0;
+    holding = false;
+    lastStarvedSeq = -1;
+    nextDue = -1.0;
+    plays++;
+    worker = std::thread(&FramePlayer::decodeLoop, this);
+    return true;
+}
+
+/* FUNCTION: Stops the decoding thread and releases the ring buffer's pixels.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                  */
+void FramePlayer::close() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+    for (size_t i = 0; i < ring.size(); i++) {
+        ring[i].pixels = std::vector<uint32_t>();
+        ring[i].view = NULL;
+        ring[i].width = ring[i].height = 0;
+    }
+}
+
+/* FUNCTION: Worker thread body: decodes upcoming frames into free ring slots until stopped.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                  */
+void FramePlayer::decodeLoop() {
+    const long long slots = (long long)ring.size();
+    Trace.nameThread("gif_decoder");
+    MEMORY_TAG(MEM_GIF_FRAMES);
+
+    while (true) {
+        long long seq;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] {
+                long long oldest = holding ? readSeq - 1 : readSeq;
+                return stopping || writeSeq - oldest < slots;
+            });
+            if (stopping) {
+                return;
+            }
+            seq = writeSeq;
+        }
+
+        // The slot is not visible to playback until writeSeq moves past it, so decode without holding the lock
+        Image& slot = ring[seq % slots];
+        const FrameInfo& frame = frames[seq % frames.size()];
+        TRACE_SCOPE("image_decode");
+        std::shared_ptr<const Image> warm = Images.find(frame.path.c_str());
+        if (warm) {
+            // Warmed at startup (see warmup.h): copying it is far cheaper than decoding it again
+            slot.width = warm->width;
+            slot.height = warm->height;
+            slot.pixels.assign(warm->data(), warm->data() + warm->width * warm->height);
+            slot.view = NULL;
+        } else if (!loadImage(frame.path.c_str(), &slot)) {
+            printf("Error: Unable to decode frame %s\n", frame.path.c_str());
+            slot.width = slot.height = 0;
+            slot.pixels.clear();
+            slot.view = NULL;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            writeSeq = seq + 1;
+        }
+        wake.notify_all();
+    }
+}
+
+/* FUNCTION: Advances playback to the given time.
+    Author: Niko
+    Arguments:
+        now - Current time in seconds (e.g. Device->now()).
+    Returns:
+        The frame to draw if a new one is due and decoded, otherwise NULL (keep showing the previous frame). */
+const Image* FramePlayer::update(double now) {
+    if (frames.empty()) {
+        return NULL;
+    }
+
+    const Image* frame;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        if (nextDue < 0) {
+            nextDue = now;
+        }
+
+        if (readSeq >= writeSeq && now >= nextDue && !Device->realTime()) {
+            // Decoding takes no time on this clock (see backend.h), so wait for the frame rather than stall
+            wake.wait(guard, [this] { return stopping || readSeq < writeSeq; });
+        }
+        if (readSeq >= writeSeq) {
+            // Due but not decoded yet: count the stall once, and keep showing the previous frame
+            if (now >= nextDue && lastStarvedSeq != readSeq) {
+                starvedCount++;
+                lastStarvedSeq = readSeq;
+            }
+            return NULL;
+        }
+        if (now < nextDue) {
+            return NULL;
+        }
+
+        // Skip frames whose successor is already due as well, as long as that successor is decoded
+        while (readSeq + 1 < writeSeq && now >= nextDue + frames[readSeq % frames.size()].delay) {
+            nextDue += frames[readSeq % frames.size()].delay;
+            readSeq++;
+            droppedCount++;
+        }
+
+        // After a stall, restart the schedule from now instead of dropping everything that piled up
+        double delay = frames[readSeq % frames.size()].delay;
+        if (now - nextDue > delay) {
+            nextDue = now;
+        }
+
+        frame = &ring[readSeq % (long long)ring.size()];
+        nextDue += delay;
+        readSeq++;
+        holding = true;
+        shownCount++;
+    }
+    wake.notify_all();
+    return frame;
+}
+
+/* FUNCTION: Prints how many times the player was opened and what playback did over all of them.
+    Author: Niko
+    Arguments:
+        name - What to call the animations.
+    Returns:
+        NONE                                                                                  */
+void FramePlayer::printStats(const char* name) const {
+    printf("Frame player %s: %lu plays, %lu frames shown, %lu dropped, %lu stalls waiting on decode\n", name, plays,
+           shownCount, droppedCount, starvedCount);
+}
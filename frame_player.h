@@ -0,0 +1,76 @@
+#ifndef FRAME_PLAYER_H
+#define FRAME_PLAYER_H
+
+#include "asset_bundle.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define FRAME_RING_SLOTS 6      // Decoded frames buffered ahead of playback (6 full-screen frames is ~1.8 MB)
+
+/* CLASS: One frame of an animation on disk.
+    Author: Niko
+    Members:
+        path - Asset path of the frame's PNG.
+        delay - How long the frame stays on screen, in seconds.                */
+struct FrameInfo {
+    std::string path;
+    double delay;
+};
+
+bool loadFrameSequence(const char* folder, std::vector<FrameInfo>* frames);
+
+/* CLASS: Plays a looping frame sequence (e.g. a losing-screen GIF) with decoding done on a worker thread.
+    Author: Niko
+    Members:
+        open(folder) - Reads the frame list (manifest.txt or frame_XX_delay-Ys.png names) and starts decoding.
+        close() - Stops the worker thread and frees the ring buffer.
+        update(now) - Returns the frame that should be drawn now if it changed since the last call, or NULL.
+        framesShown(), framesDropped(), framesStarved() - Playback counters, over every open() since launch.
+        printStats(name) - Prints how many times it was opened and the playback counters.
+    Notes:
+        Decoded frames go into a ring of FRAME_RING_SLOTS images, so memory use does not depend on the GIF's length.
+        A frame returned by update() stays valid until the next call that returns a frame.
+        Frames whose display time passed before they could be shown are dropped rather than drawn late. */
+class FramePlayer {
+public:
+    FramePlayer(int slots = FRAME_RING_SLOTS);
+    ~FramePlayer();
+
+    bool open(const char* folder);
+    void close();
+    const Image* update(double now);
+
+    int frameCount() const { return (int)frames.size(); }
+    unsigned long framesShown() const { return shownCount; }
+    unsigned long framesDropped() const { return droppedCount; }
+    unsigned long framesStarved() const { return starvedCount; }
+    void printStats(const char* name) const;
+
+private:
+    void decodeLoop();
+
+    std::vector<FrameInfo> frames;
+    std::vector<Image> ring;
+
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+
+    long long writeSeq;     // Next frame the worker will decode (frames count up forever, looping over the sequence)
+    long long readSeq;      // Next frame playback will show
+    bool holding;           // Whether frame readSeq - 1 is on screen, so its slot can't be reused yet
+    long long lastStarvedSeq;
+    double nextDue;         // Time at which frame readSeq should appear (negative until playback starts)
+
+    unsigned long plays;
+    unsigned long shownCount;
+    unsigned long droppedCount;
+    unsigned long starvedCount;
+};
+
+#endif
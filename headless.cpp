@@ -0,0 +1,163 @@
+#include "headless.h"
+#include "display.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <thread>
+
+HeadlessBackend Headless;
+
+HeadlessBackend::HeadlessBackend()
+    : startTime(std::chrono::steady_clock::now()), random(std::random_device()()), frames(0), runs(0), pixels(0),
+      samples(0), touchedSamples(0), framesDumped(0) {
+    frame.width = SCREEN_WIDTH;
+    frame.height = SCREEN_HEIGHT;
+    frame.pixels.assign(SCREEN_WIDTH * SCREEN_HEIGHT, 0xFF000000u);
+}
+
+/* FUNCTION: Fills part of a framebuffer row.
+    Author: Niko
+    Arguments:
+        y - The row.
+        x1, x2 - First and one past the last column (clipped to the screen).
+        color - 0xRRGGBB color.
+    Returns:
+        NONE                                                                 */
+void HeadlessBackend::drawRun(int y, int x1, int x2, uint32_t color) {
+    if (y < 0 || y >= SCREEN_HEIGHT) {
+        return;
+    }
+    if (x1 < 0) {
+        x1 = 0;
+    }
+    if (x2 > SCREEN_WIDTH) {
+        x2 = SCREEN_WIDTH;
+    }
+    uint32_t* row = frame.pixels.data() + y * SCREEN_WIDTH;
+    for (int x = x1; x < x2; x++) {
+        row[x] = 0xFF000000u | color;
+    }
+    runs++;
+    pixels += x2 > x1 ? x2 - x1 : 0;
+}
+
+/* FUNCTION: Ends a frame, dumping it if it was asked for.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                   */
+void HeadlessBackend::present() {
+    frames++;
+    for (size_t i = 0; i < dumpFrames.size(); i++) {
+        if (dumpFrames[i] != frames) {
+            continue;
+        }
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%05ld.png", dumpFolder.empty() ? "." : dumpFolder.c_str(), frames);
+        if (saveFrame(path)) {
+            framesDumped++;
+        } else {
+            printf("Error: unable to write %s\n", path);
+        }
+        dumpFrames.erase(dumpFrames.begin() + i);
+        break;
+    }
+}
+
+/* FUNCTION: Samples the scripted touchscreen.
+    Author: Niko
+    Arguments:
+        x, y - Receive the touch position while a press is held.
+    Returns:
+        true if a scripted press covers the current time.        */
+bool HeadlessBackend::touch(float* x, float* y) {
+    double t = now();
+    samples++;
+    for (size_t i = 0; i < presses.size(); i++) {
+        if (t >= presses[i].start && t < presses[i].end) {
+            *x = presses[i].x;
+            *y = presses[i].y;
+            touchedSamples++;
+            return true;
+        }
+    }
+    return false;
+}
+
+double HeadlessBackend::now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void HeadlessBackend::sleep(double seconds) {
+    if (seconds > 0) {
+        TRACE_SCOPE(TRACE_SLEEP_PHASE);
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    }
+}
+
+int HeadlessBackend::randInt() {
+    return (int)(random() & 0x7FFFFFFF);
+}
+
+/* FUNCTION: Reads a touch script (see the class notes for the format).
+    Author: Niko
+    Arguments:
+        path - Native path of the script.
+    Returns:
+        false if the file can't be opened.                                */
+bool HeadlessBackend::loadTouchScript(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    presses.clear();
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        Press press;
+        double duration;
+        if (line[0] == '#' || sscanf(line, "%lf %f %f %lf", &press.start, &press.x, &press.y, &duration) != 4) {
+            continue;
+        }
+        press.end = press.start + duration;
+        presses.push_back(press);
+    }
+    fclose(file);
+    return true;
+}
+
+/* FUNCTION: Asks for a frame to be dumped when it is presented.
+    Author: Niko
+    Arguments:
+        frame - Frame number, counting from 1.
+    Returns:
+        NONE                                                   */
+void HeadlessBackend::dumpFrame(long frame) {
+    dumpFrames.push_back(frame);
+}
+
+void HeadlessBackend::setDumpFolder(const char* folder) {
+    dumpFolder = folder;
+}
+
+/* FUNCTION: Writes the framebuffer to a PNG.
+    Author: Niko
+    Arguments:
+        path - Native path of the file.
+    Returns:
+        true if it was written.                  */
+bool HeadlessBackend::saveFrame(const char* path) const {
+    return encodePNG(path, frame);
+}
+
+/* FUNCTION: Prints frame, pixel and touch counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                           */
+void HeadlessBackend::printStats() const {
+    printf("Headless: %ld frames (%lu dumped), %lu runs setting %lu pixels, %lu touch samples (%lu pressed) from %zu scripted presses\n",
+           frames, framesDumped, runs, pixels, samples, touchedSamples, presses.size());
+}
@@ -0,0 +1,68 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "backend.h"
+#include "image.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+/* CLASS: Backend with no hardware behind it: frames go into an in-memory 320x240 framebuffer and touches come from
+          a script, so the game can run (and be profiled or checked) on machines without the simulator window.
+    Author: Niko
+    Members:
+        loadTouchScript(path) - Reads the touches to play: one "start x y duration" line per press (seconds since
+            launch, screen pixels, seconds held), '#' for comments; false if the file can't be read.
+        dumpFrame(frame) - Asks for a frame (numbered from 1, in present() order) to be written as a PNG.
+        setDumpFolder(folder) - Where dumped frames go (default the working directory), as frame_NNNNN.png.
+        saveFrame(path) - Writes the framebuffer as it is now.
+        framebuffer() - The framebuffer (0xFFRRGGBB pixels).
+        printStats() - Prints frame, pixel and touch counters.
+    Notes:
+        The clock and sleeps are real, so timings measured headless are comparable to the simulator's minus the cost
+        of its window. Random numbers come from a generator seeded from std::random_device.                           */
+class HeadlessBackend : public Backend {
+public:
+    HeadlessBackend();
+
+    const char* name() const { return "headless"; }
+    void drawRun(int y, int x1, int x2, uint32_t color);
+    void present();
+    bool touch(float* x, float* y);
+    double now();
+    void sleep(double seconds);
+    int randInt();
+
+    bool loadTouchScript(const char* path);
+    void dumpFrame(long frame);
+    void setDumpFolder(const char* folder);
+    bool saveFrame(const char* path) const;
+    const Image& framebuffer() const { return frame; }
+    void printStats() const;
+
+private:
+    struct Press {
+        double start, end;
+        float x, y;
+    };
+
+    Image frame;
+    std::vector<Press> presses;
+    std::vector<long> dumpFrames;       // Frames still to be dumped, in any order
+    std::string dumpFolder;
+    std::chrono::steady_clock::time_point startTime;
+    std::mt19937 random;
+
+    long frames;
+    unsigned long runs;
+    unsigned long pixels;
+    unsigned long samples;
+    unsigned long touchedSamples;
+    unsigned long framesDumped;
+};
+
+extern HeadlessBackend Headless;
+
+#endif
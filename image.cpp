@@ -0,0 +1,755 @@
+#include "image.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+
+///////////////////////
+/* INFLATE (RFC 1951) */
+///////////////////////
+
+#define HUFFMAN_FAST_BITS 10    // Codes this short are decoded with a single table lookup
+
+/* CLASS: Canonical Huffman code used by the inflater.
+    Author: Niko
+    Members:
+        count - Number of codes of each bit length (0 through 15).
+        symbol - Symbols ordered by code, as required by the canonical decode.
+        fast - Lookup table indexed by the next HUFFMAN_FAST_BITS stream bits; each entry is (length << 9) | symbol, or 0 if the code is longer. */
+struct Huffman {
+    short count[16];
+    short symbol[288];
+    unsigned short fast[1 << HUFFMAN_FAST_BITS];
+};
+
+/* CLASS: Little-endian bit reader over the zlib stream.
+    Author: Niko
+    Members:
+        p, end - Current position and end of the compressed input.
+        bitBuffer, bitCount - Bits loaded but not yet consumed.
+        padding - Zero bytes fed in after the end of the input.
+        overrun - Set if the decoder read well past the end of the input. */
+struct BitReader {
+    const unsigned char* p;
+    const unsigned char* end;
+    uint64_t bitBuffer;
+    int bitCount;
+    int padding;
+    bool overrun;
+};
+
+static void refill(BitReader* br) {
+    while (br->bitCount <= 56) {
+        uint64_t byte = 0;
+        if (br->p < br->end) {
+            byte = *br->p++;
+        } else if (++br->padding > 8) {
+            br->overrun = true;     // Zero padding is fine near the end, but a valid stream never needs this much
+        }
+        br->bitBuffer |= byte << br->bitCount;
+        br->bitCount += 8;
+    }
+}
+
+static unsigned int getBits(BitReader* br, int n) {
+    if (n == 0) return 0;
+    if (br->bitCount < n) refill(br);
+    unsigned int value = (unsigned int)(br->bitBuffer & ((1ull << n) - 1));
+    br->bitBuffer >>= n;
+    br->bitCount -= n;
+    return value;
+}
+
+/* FUNCTION: Builds the decode tables for a canonical Huffman code from its code lengths.
+    Author: Niko
+    Arguments:
+        h - Code to fill in.
+        lengths - Bit length of each symbol's code (0 if the symbol is unused).
+        n - Number of symbols.
+    Returns:
+        true if the lengths describe a usable code, false if it is over-subscribed.   */
+static bool buildHuffman(Huffman* h, const unsigned char* lengths, int n) {
+    short offsets[16];
+    int nextCode[16];
+
+    memset(h->count, 0, sizeof(h->count));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (int i = 0; i < n; i++) {
+        h->count[lengths[i]]++;
+    }
+    h->count[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) return false;
+    }
+
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++) {
+        offsets[len + 1] = offsets[len] + h->count[len];
+    }
+    for (int i = 0; i < n; i++) {
+        if (lengths[i] != 0) {
+            h->symbol[offsets[lengths[i]]++] = (short)i;
+        }
+    }
+
+    int code = 0;
+    nextCode[0] = 0;
+    for (int len = 1; len < 16; len++) {
+        code = (code + h->count[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+    for (int i = 0; i < n; i++) {
+        int len = lengths[i];
+        if (len == 0 || len > HUFFMAN_FAST_BITS) continue;
+
+        // Stream bits arrive LSB first, so index the table by the bit-reversed code
+        int c = nextCode[len]++;
+        int reversed = 0;
+        for (int b = 0; b < len; b++) {
+            reversed = (reversed << 1) | ((c >> b) & 1);
+        }
+        for (int k = reversed; k < (1 << HUFFMAN_FAST_BITS); k += (1 << len)) {
+            h->fast[k] = (unsigned short)((len << 9) | i);
+        }
+    }
+    return true;
+}
+
+/* FUNCTION: Decodes one symbol, using the fast table when possible and walking the canonical code otherwise.
+    Author: Niko
+    Returns:
+        The decoded symbol, or -1 on an invalid code.                                                        */
+static int decodeSymbol(BitReader* br, const Huffman* h) {
+    if (br->bitCount < 16) refill(br);
+
+    unsigned short entry = h->fast[br->bitBuffer & ((1 << HUFFMAN_FAST_BITS) - 1)];
+    if (entry != 0) {
+        int len = entry >> 9;
+        br->bitBuffer >>= len;
+        br->bitCount -= len;
+        return entry & 0x1FF;
+    }
+
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; len++) {
+        code |= getBits(br, 1);
+        int count = h->count[len];
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static const short LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const short LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                       3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const short DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const short DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                     7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* FUNCTION: Decompresses a zlib stream into a buffer whose final size is already known (as it always is for PNG).
+    Author: Niko
+    Arguments:
+        src, srcSize - The zlib stream (2-byte header, deflate data, adler32).
+        dst, dstSize - Output buffer and its exact expected size.
+    Returns:
+        true if exactly dstSize bytes were produced without errors.                                              */
+static bool inflateZlib(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize) {
+    if (srcSize < 2 || (src[0] & 0x0F) != 8 || ((src[0] << 8) | src[1]) % 31 != 0) {
+        return false;
+    }
+
+    BitReader br = {src + 2, src + srcSize, 0, 0, 0, false};
+    size_t out = 0;
+    bool lastBlock = false;
+
+    Huffman* lit = (Huffman*)malloc(sizeof(Huffman));
+    Huffman* dist = (Huffman*)malloc(sizeof(Huffman));
+    if (!lit || !dist) {
+        free(lit);
+        free(dist);
+        return false;
+    }
+    bool ok = true;
+
+    while (ok && !lastBlock) {
+        lastBlock = getBits(&br, 1);
+        int type = getBits(&br, 2);
+
+        if (type == 0) {
+            // Stored block: realign to a byte boundary and copy LEN bytes
+            br.bitBuffer >>= (br.bitCount & 7);
+            br.bitCount -= (br.bitCount & 7);
+            unsigned int len = getBits(&br, 16);
+            unsigned int nlen = getBits(&br, 16);
+            if ((len ^ 0xFFFF) != nlen || out + len > dstSize) {
+                ok = false;
+                break;
+            }
+            while (len > 0 && br.bitCount >= 8) {
+                dst[out++] = (unsigned char)getBits(&br, 8);
+                len--;
+            }
+            if ((size_t)(br.end - br.p) < len) {
+                ok = false;
+                break;
+            }
+            memcpy(dst + out, br.p, len);
+            br.p += len;
+            out += len;
+            continue;
+        }
+
+        if (type == 1) {
+            unsigned char lengths[320];
+            int i = 0;
+            for (; i < 144; i++) lengths[i] = 8;
+            for (; i < 256; i++) lengths[i] = 9;
+            for (; i < 280; i++) lengths[i] = 7;
+            for (; i < 288; i++) lengths[i] = 8;
+            for (i = 0; i < 30; i++) lengths[288 + i] = 5;
+            buildHuffman(lit, lengths, 288);
+            buildHuffman(dist, lengths + 288, 30);
+        } else if (type == 2) {
+            static const unsigned char ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            unsigned char lengths[320];
+            int nlen = getBits(&br, 5) + 257;
+            int ndist = getBits(&br, 5) + 1;
+            int ncode = getBits(&br, 4) + 4;
+            if (nlen > 286 || ndist > 30) {
+                ok = false;
+                break;
+            }
+
+            memset(lengths, 0, 19);
+            for (int i = 0; i < ncode; i++) {
+                lengths[ORDER[i]] = (unsigned char)getBits(&br, 3);
+            }
+            Huffman* codeLengths = lit;     // Reuse the literal table while reading the code lengths
+            if (!buildHuffman(codeLengths, lengths, 19)) {
+                ok = false;
+                break;
+            }
+
+            int index = 0;
+            while (index < nlen + ndist) {
+                int symbol = decodeSymbol(&br, codeLengths);
+                if (symbol < 0) {
+                    ok = false;
+                    break;
+                }
+                if (symbol < 16) {
+                    lengths[index++] = (unsigned char)symbol;
+                    continue;
+                }
+
+                unsigned char repeat = 0;
+                int times;
+                if (symbol == 16) {
+                    if (index == 0) {
+                        ok = false;
+                        break;
+                    }
+                    repeat = lengths[index - 1];
+                    times = 3 + getBits(&br, 2);
+                } else if (symbol == 17) {
+                    times = 3 + getBits(&br, 3);
+                } else {
+                    times = 11 + getBits(&br, 7);
+                }
+                if (index + times > nlen + ndist) {
+                    ok = false;
+                    break;
+                }
+                while (times--) {
+                    lengths[index++] = repeat;
+                }
+            }
+            if (!ok || lengths[256] == 0 ||
+                !buildHuffman(lit, lengths, nlen) || !buildHuffman(dist, lengths + nlen, ndist)) {
+                ok = false;
+                break;
+            }
+        } else {
+            ok = false;
+            break;
+        }
+
+        // Decode literal/length + distance pairs until the end-of-block symbol
+        while (true) {
+            int symbol = decodeSymbol(&br, lit);
+            if (symbol < 0 || br.overrun) {
+                ok = false;
+                break;
+            }
+            if (symbol < 256) {
+                if (out >= dstSize) {
+                    ok = false;
+                    break;
+                }
+                dst[out++] = (unsigned char)symbol;
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) {
+                ok = false;
+                break;
+            }
+            size_t len = LENGTH_BASE[symbol] + getBits(&br, LENGTH_EXTRA[symbol]);
+
+            int distSymbol = decodeSymbol(&br, dist);
+            if (distSymbol < 0 || distSymbol >= 30) {
+                ok = false;
+                break;
+            }
+            size_t distance = DIST_BASE[distSymbol] + getBits(&br, DIST_EXTRA[distSymbol]);
+            if (distance > out || out + len > dstSize) {
+                ok = false;
+                break;
+            }
+
+            const unsigned char* from = dst + out - distance;
+            unsigned char* to = dst + out;
+            for (size_t i = 0; i < len; i++) {
+                to[i] = from[i];    // Byte at a time on purpose: source and destination may overlap
+            }
+            out += len;
+        }
+    }
+
+    free(lit);
+    free(dist);
+    return ok && out == dstSize;
+}
+
+
+/////////////////////
+/* PNG DECODING    */
+/////////////////////
+
+static uint32_t readBE32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+/* FUNCTION: Converts an asset path written the way the game writes them (with '\\' separators) to the platform's own separators.
+    Author: Niko
+    Arguments:
+        path - Asset path, e.g. "emissions_images\\4.png".
+        out, outSize - Buffer for the converted path (truncated if too small).
+    Returns:
+        NONE                                                                                                                   */
+void toNativePath(const char* path, char* out, size_t outSize) {
+    size_t i = 0;
+    for (; path[i] != '\0' && i < outSize - 1; i++) {
+#ifdef _WIN32
+        out[i] = path[i];
+#else
+        out[i] = (path[i] == '\\') ? '/' : path[i];
+#endif
+    }
+    out[i] = '\0';
+}
+
+/* FUNCTION: Opens an asset path on any platform.
+    Author: Niko
+    Arguments:
+        path - Asset path, e.g. "emissions_images\\4.png".
+        mode - fopen mode string.
+    Returns:
+        The opened file, or NULL.                       */
+FILE* openAsset(const char* path, const char* mode) {
+    char fixed[512];
+    toNativePath(path, fixed, sizeof(fixed));
+    return fopen(fixed, mode);
+}
+
+/* FUNCTION: Decodes a PNG held in memory into 0xAARRGGBB pixels.
+             Supports every non-interlaced PNG the game ships: RGB, RGBA, grayscale and 1/2/4/8-bit palettes (with tRNS).
+    Author: Niko
+    Arguments:
+        data, size - The complete PNG file contents.
+        image - Image to fill in.
+    Returns:
+        true on success, false if the data is not a PNG this decoder understands.                                         */
+bool decodePNGMemory(const unsigned char* data, size_t size, Image* image) {
+    static const unsigned char SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    if (size < 8 || memcmp(data, SIGNATURE, 8) != 0) {
+        return false;
+    }
+
+    int width = 0, height = 0, bitDepth = 0, colorType = 0, interlace = 0;
+    uint32_t palette[256];
+    int paletteSize = 0;
+    int transparentGray = -1, transparentR = -1, transparentG = -1, transparentB = -1;
+    std::vector<unsigned char> compressed;
+
+    for (int i = 0; i < 256; i++) {
+        palette[i] = 0xFF000000u;
+    }
+
+    size_t pos = 8;
+    while (pos + 12 <= size) {
+        uint32_t length = readBE32(data + pos);
+        const unsigned char* type = data + pos + 4;
+        const unsigned char* body = data + pos + 8;
+        if (length > size - pos - 12) {
+            return false;
+        }
+
+        if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            width = (int)readBE32(body);
+            height = (int)readBE32(body + 4);
+            bitDepth = body[8];
+            colorType = body[9];
+            interlace = body[12];
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            paletteSize = (int)(length / 3);
+            if (paletteSize > 256) paletteSize = 256;
+            for (int i = 0; i < paletteSize; i++) {
+                palette[i] = 0xFF000000u | ((uint32_t)body[i * 3] << 16) | ((uint32_t)body[i * 3 + 1] << 8) | body[i * 3 + 2];
+            }
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            if (colorType == 3) {
+                for (uint32_t i = 0; i < length && i < 256; i++) {
+                    palette[i] = (palette[i] & 0x00FFFFFFu) | ((uint32_t)body[i] << 24);
+                }
+            } else if (colorType == 0 && length >= 2) {
+                transparentGray = (body[0] << 8) | body[1];
+            } else if (colorType == 2 && length >= 6) {
+                transparentR = (body[0] << 8) | body[1];
+                transparentG = (body[2] << 8) | body[3];
+                transparentB = (body[4] << 8) | body[5];
+            }
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), body, body + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+
+        pos += 12 + length;
+    }
+
+    int channels;
+    switch (colorType) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: return false;
+    }
+    if (width <= 0 || height <= 0 || width > 8192 || height > 8192 || interlace != 0 ||
+        (bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16)) {
+        return false;
+    }
+
+    size_t stride = ((size_t)width * channels * bitDepth + 7) / 8;
+    int bpp = (channels * bitDepth + 7) / 8;
+    std::vector<unsigned char> raw((stride + 1) * height);
+    if (!inflateZlib(compressed.data(), compressed.size(), raw.data(), raw.size())) {
+        return false;
+    }
+
+    // Undo the per-scanline filters in place
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = raw.data() + y * (stride + 1);
+        unsigned char filter = row[0];
+        unsigned char* cur = row + 1;
+        const unsigned char* prev = (y > 0) ? raw.data() + (y - 1) * (stride + 1) + 1 : NULL;
+
+        switch (filter) {
+            case 0:
+                break;
+            case 1:
+                for (size_t x = bpp; x < stride; x++) cur[x] += cur[x - bpp];
+                break;
+            case 2:
+                if (prev) for (size_t x = 0; x < stride; x++) cur[x] += prev[x];
+                break;
+            case 3:
+                for (size_t x = 0; x < stride; x++) {
+                    int left = (x >= (size_t)bpp) ? cur[x - bpp] : 0;
+                    int up = prev ? prev[x] : 0;
+                    cur[x] += (unsigned char)((left + up) >> 1);
+                }
+                break;
+            case 4:
+                for (size_t x = 0; x < stride; x++) {
+                    int left = (x >= (size_t)bpp) ? cur[x - bpp] : 0;
+                    int up = prev ? prev[x] : 0;
+                    int upLeft = (prev && x >= (size_t)bpp) ? prev[x - bpp] : 0;
+                    cur[x] += (unsigned char)paeth(left, up, upLeft);
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    image->width = width;
+    image->height = height;
+    image->view = NULL;
+    image->pixels.resize((size_t)width * height);
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = raw.data() + y * (stride + 1) + 1;
+        uint32_t* dst = image->pixels.data() + (size_t)y * width;
+
+        if (bitDepth == 8 && colorType == 6) {
+            for (int x = 0; x < width; x++, row += 4) {
+                dst[x] = ((uint32_t)row[3] << 24) | ((uint32_t)row[0] << 16) | ((uint32_t)row[1] << 8) | row[2];
+            }
+        } else if (bitDepth == 8 && colorType == 2) {
+            for (int x = 0; x < width; x++, row += 3) {
+                uint32_t alpha = (row[0] == transparentR && row[1] == transparentG && row[2] == transparentB) ? 0 : 0xFF;
+                dst[x] = (alpha << 24) | ((uint32_t)row[0] << 16) | ((uint32_t)row[1] << 8) | row[2];
+            }
+        } else if (bitDepth == 8 && colorType == 3) {
+            for (int x = 0; x < width; x++) {
+                dst[x] = palette[row[x]];
+            }
+        } else {
+            // Uncommon layouts: sample by sample, keeping the high byte of 16-bit samples
+            for (int x = 0; x < width; x++) {
+                unsigned int sample[4];
+                for (int c = 0; c < channels; c++) {
+                    size_t bit = ((size_t)x * channels + c) * bitDepth;
+                    if (bitDepth == 16) {
+                        sample[c] = (row[bit / 8] << 8) | row[bit / 8 + 1];
+                    } else {
+                        sample[c] = (row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1 << bitDepth) - 1);
+                    }
+                }
+
+                int maxValue = (1 << bitDepth) - 1;
+                uint32_t a = 0xFF, r, g, b;
+                if (colorType == 3) {
+                    dst[x] = palette[sample[0] & 0xFF];
+                    continue;
+                } else if (colorType == 0 || colorType == 4) {
+                    r = g = b = sample[0] * 255 / maxValue;
+                    if (colorType == 4) a = sample[1] * 255 / maxValue;
+                    else if ((int)sample[0] == transparentGray) a = 0;
+                } else {
+                    r = sample[0] * 255 / maxValue;
+                    g = sample[1] * 255 / maxValue;
+                    b = sample[2] * 255 / maxValue;
+                    if (colorType == 6) a = sample[3] * 255 / maxValue;
+                    else if ((int)sample[0] == transparentR && (int)sample[1] == transparentG && (int)sample[2] == transparentB) a = 0;
+                }
+                dst[x] = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* FUNCTION: Reads and decodes a PNG file from disk.
+    Author: Niko
+    Arguments:
+        path - Asset path of the PNG.
+        image - Image to fill in.
+    Returns:
+        true on success, false if the file is missing or not a supported PNG.   */
+bool decodePNG(const char* path, Image* image) {
+    FILE* file = openAsset(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(file);
+        return false;
+    }
+
+    std::vector<unsigned char> data(size);
+    size_t got = fread(data.data(), 1, size, file);
+    fclose(file);
+
+    return got == (size_t)size && decodePNGMemory(data.data(), data.size(), image);
+}
+
+/* FUNCTION: Reads only the dimensions of a PNG from its IHDR chunk, without decoding it.
+    Author: Niko
+    Arguments:
+        path - Asset path of the PNG.
+        width, height - Receive the image dimensions.
+    Returns:
+        true if the header could be read.                                                   */
+bool readPNGSize(const char* path, int* width, int* height) {
+    FILE* file = openAsset(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    unsigned char header[24];
+    size_t got = fread(header, 1, sizeof(header), file);
+    fclose(file);
+    if (got != sizeof(header) || memcmp(header + 12, "IHDR", 4) != 0) {
+        return false;
+    }
+
+    *width = (int)readBE32(header + 16);
+    *height = (int)readBE32(header + 20);
+    return true;
+}
+
+
+
+//////////////////
+/* PNG ENCODING */
+//////////////////
+
+/* FUNCTION: Updates a PNG chunk CRC (CRC-32, reflected polynomial 0xEDB88320) with more bytes.
+    Author: Niko
+    Arguments:
+        crc - CRC so far (start with 0).
+        data, size - The bytes.
+    Returns:
+        The updated CRC.                                                                          */
+static uint32_t updateCrc(uint32_t crc, const unsigned char* data, size_t size) {
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        built = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void putBE32(unsigned char* p, uint32_t value) {
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+static void writeChunk(FILE* file, const char* type, const unsigned char* data, size_t size) {
+    unsigned char header[8];
+    putBE32(header, (uint32_t)size);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = updateCrc(updateCrc(0, header + 4, 4), data, size);
+    unsigned char trailer[4];
+    putBE32(trailer, crc);
+
+    fwrite(header, 1, 8, file);
+    fwrite(data, 1, size, file);
+    fwrite(trailer, 1, 4, file);
+}
+
+/* FUNCTION: Writes an image to disk as an 8-bit RGBA PNG. The pixels go out in stored (uncompressed) deflate blocks:
+             it is meant for screenshots and debugging, where writing fast and simply matters more than file size.
+    Author: Niko
+    Arguments:
+        path - Native path of the file to create.
+        image - The image (0xAARRGGBB pixels).
+    Returns:
+        true if the file was written.                                                                                   */
+bool encodePNG(const char* path, const Image& image) {
+    if (image.width <= 0 || image.height <= 0) {
+        return false;
+    }
+
+    // Scanlines, each behind filter type 0, as the PNG byte order wants them
+    size_t rowBytes = (size_t)image.width * 4 + 1;
+    std::vector<unsigned char> raw(rowBytes * image.height);
+    const uint32_t* pixels = image.data();
+    for (int y = 0; y < image.height; y++) {
+        unsigned char* row = raw.data() + y * rowBytes;
+        row[0] = 0;
+        for (int x = 0; x < image.width; x++) {
+            uint32_t pixel = pixels[y * image.width + x];
+            row[1 + x * 4] = (unsigned char)(pixel >> 16);
+            row[2 + x * 4] = (unsigned char)(pixel >> 8);
+            row[3 + x * 4] = (unsigned char)pixel;
+            row[4 + x * 4] = (unsigned char)(pixel >> 24);
+        }
+    }
+
+    // zlib stream: header, stored blocks of up to 65535 bytes, adler32
+    std::vector<unsigned char> zlib;
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t offset = 0;
+    do {
+        size_t length = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+        bool last = offset + length == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((unsigned char)length);
+        zlib.push_back((unsigned char)(length >> 8));
+        zlib.push_back((unsigned char)~length);
+        zlib.push_back((unsigned char)(~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    unsigned char adler[4];
+    putBE32(adler, (b << 16) | a);
+    zlib.insert(zlib.end(), adler, adler + 4);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, 8, file);
+
+    unsigned char header[13];
+    putBE32(header, (uint32_t)image.width);
+    putBE32(header + 4, (uint32_t)image.height);
+    header[8] = 8;      // Bit depth
+    header[9] = 6;      // RGBA
+    header[10] = 0;     // Deflate
+    header[11] = 0;     // Adaptive filtering
+    header[12] = 0;     // No interlace
+    writeChunk(file, "IHDR", header, sizeof(header));
+    writeChunk(file, "IDAT", zlib.data(), zlib.size());
+    writeChunk(file, "IEND", NULL, 0);
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
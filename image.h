@@ -0,0 +1,38 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+/* CLASS: A decoded image held in memory as 32-bit pixels.
+    Author: Niko
+    Members:
+        width, height - Dimensions of the image in pixels.
+        pixels - Row-major pixel data, one 0xAARRGGBB value per pixel (empty when the image is a view).
+        view - Pixels owned by someone else (e.g. a memory-mapped asset bundle), or NULL.
+        data() - The pixels to draw, whichever of the two holds them.
+        byteSize() - Bytes of pixel memory owned by this image.
+    Notes:
+        Unlike FEHImage, an Image never touches the disk once decoded, so it can be drawn as often as needed for free. */
+struct Image {
+    int width;
+    int height;
+    std::vector<uint32_t> pixels;
+    const uint32_t* view;
+
+    Image() : width(0), height(0), view(NULL) {}
+    const uint32_t* data() const { return view ? view : pixels.data(); }
+    size_t byteSize() const { return pixels.size() * sizeof(uint32_t); }
+};
+
+void toNativePath(const char* path, char* out, size_t outSize);
+FILE* openAsset(const char* path, const char* mode);
+
+bool decodePNG(const char* path, Image* image);
+bool decodePNGMemory(const unsigned char* data, size_t size, Image* image);
+bool readPNGSize(const char* path, int* width, int* height);
+bool encodePNG(const char* path, const Image& image);
+
+#endif
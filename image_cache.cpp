@@ -0,0 +1,147 @@
+#include "image_cache.h"
+#include "memory_ledger.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+ImageCache Images(IMAGE_CACHE_BUDGET);
+
+ImageCache::ImageCache(size_t budgetBytes)
+    : budgetBytes(budgetBytes), usedBytes(0), hitCount(0), missCount(0), evictionCount(0) {
+}
+
+/* FUNCTION: Picks the memory tag an image is counted under, from the folder it is in.
+    Author: Niko
+    Arguments:
+        path - Asset path of the PNG.
+    Returns:
+        MEM_GIF_FRAMES, MEM_ANIMATIONS or MEM_IMAGES.                                  */
+static int memoryTagFor(const char* path) {
+    if (strncmp(path, "GIFs", 4) == 0) {
+        return MEM_GIF_FRAMES;
+    }
+    if (strncmp(path, "correct_animation", 17) == 0 || strncmp(path, "incorrect_animation", 19) == 0) {
+        return MEM_ANIMATIONS;
+    }
+    return MEM_IMAGES;
+}
+
+/* FUNCTION: Looks an image up by path, loading and inserting it on a miss.
+    Author: Niko
+    Arguments:
+        path - Asset path of the PNG (e.g. "emissions_images\\4.png").
+    Returns:
+        The decoded image, or NULL if the file is missing or can't be decoded.   */
+std::shared_ptr<const Image> ImageCache::get(const char* path) {
+    MEMORY_TAG(memoryTagFor(path));
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = index.find(path);
+        if (found != index.end()) {
+            hitCount++;
+            lru.splice(lru.begin(), lru, found->second);    // Move to the front without reallocating
+            return found->second->image;
+        }
+        missCount++;
+    }
+
+    std::shared_ptr<Image> image = std::make_shared<Image>();
+    {
+        TRACE_SCOPE("image_decode");
+        if (!loadImage(path, image.get())) {
+            printf("Error: Unable to decode image %s\n", path);
+            return std::shared_ptr<const Image>();
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = index.find(path);
+    if (found != index.end()) {
+        // Another thread loaded it meanwhile: keep theirs so everyone shares one copy
+        lru.splice(lru.begin(), lru, found->second);
+        return found->second->image;
+    }
+
+    lru.push_front(Entry());
+    lru.front().path = path;
+    lru.front().image = image;
+    index[lru.front().path] = lru.begin();
+    usedBytes += image->byteSize();
+
+    evictToBudget();
+    return image;
+}
+
+/* FUNCTION: Looks an image up by path without loading it on a miss (e.g. to use a frame warmed at startup).
+    Author: Niko
+    Arguments:
+        path - Asset path of the PNG.
+    Returns:
+        The decoded image, or NULL if it isn't cached.                                                        */
+std::shared_ptr<const Image> ImageCache::find(const char* path) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = index.find(path);
+    if (found == index.end()) {
+        return std::shared_ptr<const Image>();
+    }
+    hitCount++;
+    lru.splice(lru.begin(), lru, found->second);
+    return found->second->image;
+}
+
+/* FUNCTION: Changes the memory budget and evicts down to it.
+    Author: Niko
+    Arguments:
+        budgetBytes - New budget in bytes of decoded pixels.
+    Returns:
+        NONE                                                    */
+void ImageCache::setBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> guard(lock);
+    this->budgetBytes = budgetBytes;
+    evictToBudget();
+}
+
+/* FUNCTION: Drops every cached image (counters are kept).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                  */
+void ImageCache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    lru.clear();
+    index.clear();
+    usedBytes = 0;
+}
+
+/* FUNCTION: Evicts least recently used images until the cache fits its budget.
+             The most recently used image is always kept, even if it alone is over budget. The caller holds the lock.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                 */
+void ImageCache::evictToBudget() {
+    while (usedBytes > budgetBytes && lru.size() > 1) {
+        Entry& victim = lru.back();
+        usedBytes -= victim.image->byteSize();
+        index.erase(victim.path);
+        lru.pop_back();
+        evictionCount++;
+    }
+}
+
+/* FUNCTION: Prints hit/miss/eviction counters and memory use to the console.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                  */
+void ImageCache::printStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    unsigned long lookups = hitCount + missCount;
+    printf("Image cache: %lu hits, %lu misses (%.1f%% hit rate), %lu evictions, %zu images, %.1f of %.1f MB\n",
+           hitCount, missCount, lookups ? 100.0 * hitCount / lookups : 0.0, evictionCount,
+           lru.size(), usedBytes / 1048576.0, budgetBytes / 1048576.0);
+}
@@ -0,0 +1,62 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include "asset_bundle.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define IMAGE_CACHE_BUDGET (48 * 1024 * 1024)     // Default bytes of decoded pixels kept around (all 99 prompt images are ~15 MB)
+
+/* CLASS: Process-wide cache of decoded images keyed by asset path, with a memory budget and LRU eviction.
+    Author: Niko
+    Members:
+        get(path) - Returns the decoded image, loading it (from the asset bundle or disk) only on a miss (NULL if it can't be loaded).
+        find(path) - Returns the image only if it is already cached (NULL otherwise), without loading anything.
+        setBudget(bytes) - Changes the memory budget, evicting least recently used images if needed.
+        hits(), misses(), evictions() - Counters since startup.
+        printStats() - Prints the counters and current memory use.
+    Notes:
+        Images are handed out as shared pointers so an evicted image stays valid for whoever is still drawing it.
+        Raw images served from the memory-mapped bundle are views, so they cost nothing against the budget.
+        Safe to use from several threads (the prefetcher loads on its own); decoding happens outside the lock. */
+class ImageCache {
+public:
+    ImageCache(size_t budgetBytes);
+
+    std::shared_ptr<const Image> get(const char* path);
+    std::shared_ptr<const Image> find(const char* path);
+    void setBudget(size_t budgetBytes);
+    void clear();
+
+    size_t budget() const { std::lock_guard<std::mutex> guard(lock); return budgetBytes; }
+    size_t bytesUsed() const { std::lock_guard<std::mutex> guard(lock); return usedBytes; }
+    unsigned long hits() const { std::lock_guard<std::mutex> guard(lock); return hitCount; }
+    unsigned long misses() const { std::lock_guard<std::mutex> guard(lock); return missCount; }
+    unsigned long evictions() const { std::lock_guard<std::mutex> guard(lock); return evictionCount; }
+    void printStats() const;
+
+private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const Image> image;
+    };
+
+    void evictToBudget();
+
+    mutable std::mutex lock;
+    std::list<Entry> lru;   // Most recently used at the front
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t budgetBytes;
+    size_t usedBytes;
+    unsigned long hitCount;
+    unsigned long missCount;
+    unsigned long evictionCount;
+};
+
+extern ImageCache Images;
+
+#endif
@@ -0,0 +1,244 @@
+#include "input.h"
+#include "display.h"
+#include "trace.h"
+
+#include "backend.h"
+
+#include <math.h>
+#include <stdio.h>
+
+InputLayer Input;
+
+InputLayer::InputLayer()
+    : head(0), count(0), buttonCount(0), touching(false), lastX(0), lastY(0), pressedButton(-1),
+      gestureCorner(-1), gestureStart(0.0), gestureDone(false), pendingPressTime(-1.0), samples(0), responses(0), totalLatency(0.0), maxLatency(0.0) {
+}
+
+/* FUNCTION: Appends an event to the queue, dropping the oldest one if the queue is full.
+    Author: Reagan
+    Arguments:
+        type - Event type.
+        x, y - Touch position.
+        time - Sample time.
+    Returns:
+        NONE                                                                                */
+void InputLayer::push(int type, float x, float y, double time) {
+    if (count == INPUT_QUEUE_SIZE) {
+        head = (head + 1) % INPUT_QUEUE_SIZE;
+        count--;
+    }
+    TouchEvent& event = queue[(head + count) % INPUT_QUEUE_SIZE];
+    event.type = type;
+    event.x = x;
+    event.y = y;
+    event.time = time;
+    event.button = pressedButton;
+    count++;
+}
+
+/* FUNCTION: Reads the touch controller once and queues the events the sample implies.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                            */
+void InputLayer::poll() {
+    TRACE_SCOPE("input_poll");
+    float x, y;
+    bool down = Device->touch(&x, &y);
+    double now = Device->now();
+    samples++;
+
+    if (down && !touching) {
+        touching = true;
+        lastX = x;
+        lastY = y;
+        pressedButton = hitTest(x, y);
+        pendingPressTime = now;
+        push(TOUCH_PRESS, x, y, now);
+    } else if (down && touching) {
+        if (fabs(x - lastX) >= DRAG_THRESHOLD || fabs(y - lastY) >= DRAG_THRESHOLD) {
+            lastX = x;
+            lastY = y;
+            push(TOUCH_DRAG, x, y, now);
+        }
+    } else if (!down && touching) {
+        touching = false;
+        push(TOUCH_RELEASE, lastX, lastY, now);
+        pressedButton = -1;
+    }
+
+    // A press on a button belongs to the screen (the game's right note button sits in the top-right corner)
+    checkTraceGesture(down && pressedButton < 0, x, y, now);
+}
+
+/* FUNCTION: Finds which trace gesture corner a point is in.
+    Author: Niko
+    Arguments:
+        x, y - Touch position.
+    Returns:
+        TRACE_GESTURE_OVERLAY (top left), TRACE_GESTURE_DUMP (top right) or -1.   */
+int InputLayer::traceCorner(float x, float y) const {
+    if (y >= TRACE_CORNER_SIZE) {
+        return -1;
+    }
+    if (x < TRACE_CORNER_SIZE) {
+        return TRACE_GESTURE_OVERLAY;
+    }
+    if (x >= SCREEN_WIDTH - TRACE_CORNER_SIZE) {
+        return TRACE_GESTURE_DUMP;
+    }
+    return -1;
+}
+
+/* FUNCTION: Follows a touch held in a trace gesture corner and sets the gesture off once it has been held long enough.
+             Leaving the corner, lifting the touch or pressing a button starts over.
+    Author: Niko
+    Arguments:
+        down, x, y - The touch sample (down is false for a touch held on a button).
+        now - Sample time.
+    Returns:
+        NONE                                                                                                            */
+void InputLayer::checkTraceGesture(bool down, float x, float y, double now) {
+    int corner = down ? traceCorner(x, y) : -1;
+    if (corner != gestureCorner) {
+        gestureCorner = corner;
+        gestureStart = now;
+        gestureDone = false;
+    }
+    if (corner < 0 || gestureDone || now - gestureStart < TRACE_HOLD_SECONDS) {
+        return;
+    }
+
+    gestureDone = true;
+    if (corner == TRACE_GESTURE_OVERLAY) {
+        Trace.setOverlay(!Trace.overlay());
+    } else if (!Trace.write(Trace.path())) {
+        printf("Error: unable to write trace %s\n", Trace.path());
+    }
+}
+
+/* FUNCTION: Pops the oldest queued event.
+    Author: Reagan
+    Arguments:
+        event - Receives the event.
+    Returns:
+        true if there was an event.         */
+bool InputLayer::nextEvent(TouchEvent* event) {
+    if (count == 0) {
+        return false;
+    }
+    *event = queue[head];
+    head = (head + 1) % INPUT_QUEUE_SIZE;
+    count--;
+    return true;
+}
+
+/* FUNCTION: Waits for the next event, sleeping between touch samples instead of spinning.
+    Author: Reagan
+    Arguments:
+        event - Receives the event.
+        timeout - Longest time to wait in seconds, or a negative number to wait forever.
+    Returns:
+        true if an event arrived, false on timeout (or once the backend has finished).   */
+bool InputLayer::waitEvent(TouchEvent* event, double timeout) {
+    double deadline = Device->now() + timeout;
+
+    while (true) {
+        if (nextEvent(event)) {
+            return true;
+        }
+        poll();
+        if (nextEvent(event)) {
+            return true;
+        }
+
+        double remaining = deadline - Device->now();
+        if ((timeout >= 0 && remaining <= 0) || Device->finished()) {
+            return false;
+        }
+        int sleepMs = INPUT_POLL_MS;
+        if (timeout >= 0 && remaining * 1000 < sleepMs) {
+            sleepMs = (int)(remaining * 1000) + 1;
+        }
+        Device->sleep(sleepMs / 1000.0);
+    }
+}
+
+/* FUNCTION: Empties the hit-test table and the event queue, ready for a new screen.
+             A touch that is still held from the previous screen won't count as a press here.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                  */
+void InputLayer::clearButtons() {
+    buttonCount = 0;
+    head = 0;
+    count = 0;
+    pressedButton = -1;
+}
+
+/* FUNCTION: Registers a button rectangle for hit-testing (edges included, like the old buttonPress()).
+    Author: Reagan
+    Arguments:
+        x1, y1 - Top-left corner.
+        x2, y2 - Bottom-right corner.
+    Returns:
+        The button's id, or -1 if the table is full.                                                    */
+int InputLayer::addButton(int x1, int y1, int x2, int y2) {
+    if (buttonCount == MAX_BUTTONS) {
+        return -1;
+    }
+    Button& button = buttons[buttonCount];
+    button.x1 = x1;
+    button.y1 = y1;
+    button.x2 = x2;
+    button.y2 = y2;
+    return buttonCount++;
+}
+
+/* FUNCTION: Finds which registered button contains a point (the first registered wins on overlap).
+    Author: Reagan
+    Arguments:
+        x, y - Touch position.
+    Returns:
+        The button's id, or -1.                                                                     */
+int InputLayer::hitTest(float x, float y) const {
+    for (int i = 0; i < buttonCount; i++) {
+        if (x >= buttons[i].x1 && x <= buttons[i].x2 && y >= buttons[i].y1 && y <= buttons[i].y2) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* FUNCTION: Records touch-to-response latency: the time from a press to the first frame shown after it.
+    Author: Reagan
+    Arguments:
+        now - Time the frame was shown.
+    Returns:
+        NONE                                                                                               */
+void InputLayer::frameShown(double now) {
+    if (pendingPressTime < 0) {
+        return;
+    }
+    double latency = now - pendingPressTime;
+    totalLatency += latency;
+    if (latency > maxLatency) {
+        maxLatency = latency;
+    }
+    responses++;
+    pendingPressTime = -1.0;
+}
+
+/* FUNCTION: Prints touch sampling and latency counters.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        NONE                                             */
+void InputLayer::printStats() const {
+    printf("Input: %lu touch samples, %lu presses answered, touch-to-frame latency %.1f ms average, %.1f ms max\n",
+           samples, responses, responses ? 1000.0 * totalLatency / responses : 0.0, 1000.0 * maxLatency);
+}
@@ -0,0 +1,92 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#define INPUT_POLL_MS 10        // Touch sampling period while waiting for input
+#define INPUT_QUEUE_SIZE 32     // Events kept before the oldest are dropped
+#define MAX_BUTTONS 16          // Hit-test rectangles a screen can register
+#define DRAG_THRESHOLD 3        // Pixels a held touch must move to report a drag
+
+/* Trace gestures (corners held for TRACE_HOLD_SECONDS) */
+#define TRACE_GESTURE_OVERLAY 0
+#define TRACE_GESTURE_DUMP 1
+
+/* Touch event types */
+#define TOUCH_PRESS 0
+#define TOUCH_RELEASE 1
+#define TOUCH_DRAG 2
+
+/* CLASS: One touch event.
+    Author: Reagan
+    Members:
+        type - TOUCH_PRESS, TOUCH_RELEASE or TOUCH_DRAG.
+        x, y - Touch position (for a release, the last position seen).
+        time - When the sample that produced the event was taken (Device->now()).
+        button - Id of the registered button under the touch when it was pressed, or -1. */
+struct TouchEvent {
+    int type;
+    float x, y;
+    double time;
+    int button;
+};
+
+/* CLASS: Samples the touchscreen once per tick and turns the samples into a queue of touch events.
+    Author: Reagan
+    Members:
+        poll() - Takes one touch sample and queues any press, drag or release it implies.
+        nextEvent(event) - Pops the oldest queued event without waiting.
+        waitEvent(event, timeout) - Sleeps between samples until an event arrives or the timeout (seconds, < 0 = forever) passes.
+        clearButtons() - Empties the hit-test table and drops queued events (call when a screen is entered).
+        addButton(x1, y1, x2, y2) - Registers a button rectangle; returns its id.
+        frameShown(now) - Called by the display after each update, to measure touch-to-response latency.
+        printStats() - Prints sampling and latency counters.
+    Notes:
+        Each tick reads the touch controller exactly once, no matter how many buttons a screen has.
+        Holding the top-left corner for TRACE_HOLD_SECONDS toggles the FPS overlay, and holding the top-right corner
+        writes the trace out (see trace.h), on any screen. A press that starts on a button never counts, so holding a
+        button that sits in a corner (like the game's right note button) only does what the button does. */
+class InputLayer {
+public:
+    InputLayer();
+
+    void poll();
+    bool nextEvent(TouchEvent* event);
+    bool waitEvent(TouchEvent* event, double timeout);
+
+    void clearButtons();
+    int addButton(int x1, int y1, int x2, int y2);
+    int hitTest(float x, float y) const;
+
+    void frameShown(double now);
+    void printStats() const;
+
+private:
+    void push(int type, float x, float y, double time);
+    int traceCorner(float x, float y) const;
+    void checkTraceGesture(bool down, float x, float y, double now);
+
+    TouchEvent queue[INPUT_QUEUE_SIZE];
+    int head, count;
+
+    struct Button {
+        int x1, y1, x2, y2;
+    };
+    Button buttons[MAX_BUTTONS];
+    int buttonCount;
+
+    bool touching;
+    float lastX, lastY;
+    int pressedButton;
+
+    int gestureCorner;          // TRACE_GESTURE_* corner held since gestureStart, or -1
+    double gestureStart;
+    bool gestureDone;           // The held corner's gesture already went off
+
+    double pendingPressTime;    // Time of a press that hasn't been answered by a frame yet (< 0 if none)
+    unsigned long samples;
+    unsigned long responses;
+    double totalLatency, maxLatency;
+};
+
+extern InputLayer Input;
+
+#endif
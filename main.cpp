@@ -1,40 +1,57 @@
-#include "FEHLCD.h"
-#include "FEHRandom.h"
-#include "FEHImages.h"
-#include "FEHUtility.h"
+#include "backend.h"
+#include "headless.h"
+#include "image_cache.h"
+#include "frame_player.h"
+#include "display.h"
+#include "compositor.h"
+#include "input.h"
+#include "scene.h"
+#include "score_store.h"
+#include "emissions.h"
+#include "text.h"
+#include "card_cache.h"
+#include "timeline.h"
+#include "delta_animation.h"
+#include "prefetcher.h"
+#include "warmup.h"
+#include "replay.h"
+#include "bench.h"
+#include "rounds.h"
+#include "memory_ledger.h"
+#include "trace.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string_view>
 
 
 ////////////////////////
 /* GLOBAL DEFINITIONS */
 ////////////////////////
 
-/* CLASS: Represents an activity and its CO2 emissions (i.e., a "prompt" in the context of a higher-or-lower game).
-    Author: Niko
-    Members:
-        activityDescription - A description of the activity (e.g., "Generating 1 kg of coffee").
-        emissionValue - The activity's LCA (life cycle analysis) or direct emissions value in kg CO2eq.
-        note - Additional information or fun fact about the activity (optional). 
-    Constructors:
-        Emission() - Default constructor.
-        Emission(const char* activity, double value) - Initializes with activity and value based on parsed data. */
-class Emission {
-public:
-    char activityDescription[128];
-    double emissionValue;
-    char activityNote[512];
-    Emission();
-    Emission(const char* activity, double value, const char* note);
-};
+#define NUM_GIFS 11     // Maximum expected GIFs (also predetermined; frame counts and timing come from each GIF's folder)
+#define GIF_WARM_FRAMES 2               // Frames of each GIF loaded at startup, so the losing screen starts without a decode
+#define ANSWER_ANIMATION_FRAMES 31      // Frames 1-31 of correct_animation/incorrect_animation (frame 0 is the versus sign)
+#define ANSWER_ANIMATION_SECONDS 0.31   // 10 ms per frame
+#define SLIDE_SECONDS 0.6               // Prompt slide after a correct answer
+#define SCROLL_SECONDS 0.6              // Value count-up when a prompt is revealed
 
-#define DATA_SIZE 99    // Maximum expected data entries (predetermined and able to be updated as more data is included in .csv)
-#define NUM_GIFS 11     // Maximum expected GIFs (also predetermined)
-const int NUM_FRAMES[NUM_GIFS] = {25, 9, 79, 55, 98, 91, 50, 65, 97, 92, 99};   // Total frames (really, last frame file ##) for each GIF so that they can be displayed accordingly
-Emission emissions[DATA_SIZE];  // Globally define array of data so that it can be referenced in functions and wherever
+/* Benchmark scenarios (see runBenchmarks) */
+#define BENCH_IDLE_SECONDS 5.0          // Title screen left alone
+#define BENCH_GIF_SECONDS 10.0          // Each losing screen GIF
+#define BENCH_LEADERBOARD_SECONDS 1.0
+#define BENCH_SCORE_LOG "bench_scores.log"          // Made-up score store for the leaderboard scenarios, removed after
+#define BENCH_SCORE_SUMMARY "bench_scores.summary"
+
+// Static full-screen overlays that are always drawn together, so they're flattened into one layer (see compositor.h)
+const char* ROUND_OVERLAYS[] = {"images\\meaner_greener_buttons.png", "correct_animation\\0.png", "images\\note_buttons.png"};
+const char* REVEAL_OVERLAYS[] = {"images\\note_buttons.png", "correct_animation\\0.png"};
+
+// Answer feedback animations, built from their frames the first time each is played
+DeltaAnimation correctAnimation;
+DeltaAnimation incorrectAnimation;
 
 using namespace std;
 
@@ -43,40 +60,223 @@ using namespace std;
 /* FUNCTION PROTOTYPES */
 /////////////////////////
 
-int loadEmissionsFromFile(Emission emissions[], int size);
-
-void getDistinctInts(int max, int* index1, int* index2);
-void getDistinctIntForNextRound(int max, int currentIndex, int* newIndex);
+void buildWarmManifest();
+void drawWarmupProgress(int done, int total);
+int runBenchmarks(const char* baselinePath, double threshold, bool updateBaseline, bool requireBaseline);
 
+void drawImage(const char* path, int x, int y);
+void drawCard(int index, int layout, int x);
 void drawButtonWithText(int x1, int y1, int x2, int y2, unsigned int rectColor, const char* textLabel, unsigned int textColor);
-int buttonPress(int x1, int y1, int x2, int y2);
 void drawBackButton();
 
-void titleScreen();
-void instructionsScreen();
-void creditsScreen();
-void creditsCreditsScreen();
-void referencesScreen();
-void leaderboardScreen();
-
-void printTextWithinBox(const char* note, unsigned int textColor, int x1, int y1, int x2, int y2);
 void displayActivityLeft(int index);
 void displayActivityRight(int index);
 
-void losingScreen(int score);
-
 void displayVersus();
 void correct_animation();
 void incorrect_animation();
+void playAnswerAnimation(const char* name, DeltaAnimation* animation);
 
 void drawNoteButtons();
+void drawOverlay(const char* path, int x, int y);
+void drawRoundOverlays();
+void drawRevealOverlays();
 void slidePrompts(int index1, int index2, int newIndex);
 void scrollingValue(int index);
 
-void displayBriefing();
-void playGame();
 
-void mainMenu();
+
+////////////
+/* SCENES */
+////////////
+
+/* Scene ids (see scene.h) */
+#define SCENE_TITLE 0
+#define SCENE_MENU 1
+#define SCENE_INSTRUCTIONS 2
+#define SCENE_CREDITS 3
+#define SCENE_CREDITS_CREDITS 4
+#define SCENE_REFERENCES 5
+#define SCENE_LEADERBOARD 6
+#define SCENE_BRIEFING 7
+#define SCENE_GAME 8
+#define SCENE_LOSING 9
+
+/* CLASS: Title screen with a flashing continue arrow.
+    Author: Niko
+    Members:
+        continueButton - Id of the arrow's button.
+        isFlashing - Whether the arrow is currently hidden.
+        lastFlashTime - When the arrow last flashed.       */
+class TitleScene : public Scene {
+public:
+    void enter();
+    int touch(const TouchEvent& event);
+    int tick(double now);
+    double wakeTime(double now);
+    void draw();
+
+private:
+    int continueButton;
+    bool isFlashing;
+    double lastFlashTime;
+};
+
+/* CLASS: Main menu, from which every other screen is reached.
+    Author: Niko
+    Members:
+        playButton, instructionsButton, creditsButton, leaderboardButton, quitButton - Button ids. */
+class MenuScene : public Scene {
+public:
+    void enter();
+    int touch(const TouchEvent& event);
+    void draw();
+
+private:
+    int playButton, instructionsButton, creditsButton, leaderboardButton, quitButton;
+};
+
+/* CLASS: A premade full-screen image with a back button (instructions, credits and references screens).
+    Author: Reagan
+    Members:
+        path - Image to show.
+        clearFirst - Whether to clear the screen before drawing the image.
+        backScene - Scene the back button goes to.
+        backButton - Id of the back button.                                                                 */
+class ImageScene : public Scene {
+public:
+    ImageScene(const char* path, bool clearFirst, int backScene);
+
+    void enter();
+    int touch(const TouchEvent& event);
+    void draw();
+
+private:
+    const char* path;
+    bool clearFirst;
+    int backScene;
+    int backButton;
+};
+
+/* CLASS: Credits menu, leading to the references or the game credits.
+    Author: Reagan
+    Members:
+        backButton, referencesButton, creditsButton - Button ids.     */
+class CreditsScene : public Scene {
+public:
+    void enter();
+    int touch(const TouchEvent& event);
+    void draw();
+
+private:
+    int backButton, referencesButton, creditsButton;
+};
+
+/* CLASS: Leaderboard with the top 5 scores from previous games.
+    Author: Reagan
+    Members:
+        topScores - The scores shown, copied from the score store when the scene is entered.
+        backButton - Id of the back button.                           */
+class LeaderboardScene : public Scene {
+public:
+    void enter();
+    int touch(const TouchEvent& event);
+    void draw();
+
+private:
+    int topScores[5];
+    int backButton;
+};
+
+/* CLASS: The two "before you play" pages shown before each game.
+    Author: Niko
+    Members:
+        page - Page currently shown (0 or 1).                        */
+class BriefingScene : public Scene {
+public:
+    void enter();
+    int touch(const TouchEvent& event);
+    void draw();
+
+private:
+    int page;
+};
+
+/* CLASS: One game of higher or lower, from the first prompt to the wrong answer.
+    Author: Reagan and Niko
+    Members:
+        index1, index2 - Prompts on the left and right.
+        nextIndex - Prompt that slides in after a correct answer, chosen up front so it can be prefetched.
+        score - Correct answers so far.
+        noteIndex - Prompt whose note is being shown full-screen, or -1.
+        higherButton, lowerButton, leftNoteButton, rightNoteButton - Button ids.
+    Notes:
+        The reveal, correct/incorrect and slide animations still run to completion inside touch(); they are bounded
+        and return to the main loop afterwards. While a round is up, the loader thread (see prefetcher.h) gets the
+        revealed cards of the right prompt and every card of the next one ready, so answering never waits on disk or
+        decoding.                                                                                                    */
+class GameScene : public Scene {
+public:
+    void enter();
+    void exit();
+    int touch(const TouchEvent& event);
+    void draw();
+
+private:
+    int answer(char choice);
+
+    int index1, index2;
+    int nextIndex;
+    int score;
+    int noteIndex;
+    int higherButton, lowerButton, leftNoteButton, rightNoteButton;
+};
+
+/* CLASS: Losing screen with a random GIF and the final score.
+    Author: Niko
+    Members:
+        setScore(score) - Sets the score to show (called by the game before it transitions here).
+        setGif(index) - Plays that GIF from then on instead of a random one (0 goes back to random; for benchmarks).
+        printStats() - Prints GIF playback counters over every visit (on exit, with the other stats).
+        gif - Player for the GIF chosen on entry.
+        gifIndex - Which GIF is playing.
+        frame - Latest frame to draw.
+        scoreText - The formatted score.
+        rankText - The score's percentile rank among every game logged on the device.
+        backButton - Id of the back button.                                                         */
+class LosingScene : public Scene {
+public:
+    void setScore(int score);
+    void setGif(int index) { forcedGif = index; }
+    void printStats() const { gif.printStats("losing screen GIFs"); }
+
+    void enter();
+    void exit();
+    int touch(const TouchEvent& event);
+    int tick(double now);
+    double wakeTime(double now);
+    void draw();
+
+private:
+    FramePlayer gif;
+    int gifIndex;
+    int forcedGif;
+    const Image* frame;
+    char scoreText[20];
+    char rankText[40];
+    int backButton;
+};
+
+TitleScene titleScene;
+MenuScene menuScene;
+ImageScene instructionsScene("images\\instructions.png", false, SCENE_MENU);
+CreditsScene creditsScene;
+ImageScene creditsCreditsScene("images\\credits.png", false, SCENE_CREDITS);
+ImageScene referencesScene("images\\references.png", true, SCENE_CREDITS);
+LeaderboardScene leaderboardScene;
+BriefingScene briefingScene;
+GameScene gameScene;
+LosingScene losingScene;
 
 
 
@@ -85,109 +285,229 @@ void mainMenu();
 /* MAIN FUNCTION */
 ///////////////////
 
-int main()
+int main(int argc, char** argv)
 {
-    // Load data
-    int count = loadEmissionsFromFile(emissions, DATA_SIZE);
-    
-    // Enter game, starting on title screen!
-    titleScreen();
+    // "--data file" plays with another data file (e.g. a content pack) instead of emissions_data.csv
+    // "--warm none|hot|all" picks what is loaded up front (see warmup.h); low-memory units can warm only the hot set
+    // "--backend feh|headless" picks what the game runs on (see backend.h); headless runs take "--touch-script file"
+    // and can write frames out with "--dump-frame n" (any number of times) into "--dump-dir folder"
+    // "--record file" records the session from the title screen on; "--replay file" plays one back (add "--fast" to
+    // run it as fast as possible) and writes frame times to "--report file" (see replay.h)
+    // "--bench" runs the frame-time benchmarks instead of the game and checks them against "--baseline file" (see
+    // runBenchmarks); "--threshold fraction" sets the slowdown allowed and "--update-baseline" saves this run instead,
+    // while "--require-baseline" fails (exit status 2) instead of saving one when there is none
+    // "--trace file" writes the phase trace (see trace.h) to file on exit; "--no-trace" turns tracing off and "--fps"
+    // starts with the FPS overlay on
+    // "--memory-budget tag=MB" (any number of times) warns when a memory tag goes over MB (see memory_ledger.h)
+    const char* dataPath = EMISSIONS_FILE;
+    int warmSet = WARM_ALL;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* reportPath = REPLAY_REPORT_FILE;
+    bool replayFast = false;
+    bool bench = false;
+    bool updateBaseline = false;
+    bool requireBaseline = false;
+    const char* baselinePath = BENCH_BASELINE_FILE;
+    double threshold = BENCH_THRESHOLD;
+    bool traceOnExit = false;
+#ifndef HEADLESS_ONLY
+    const char* backendName = "feh";
+#else
+    const char* backendName = "headless";
+#endif
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            dataPath = argv[++i];
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            backendName = argv[++i];
+        } else if (strcmp(argv[i], "--touch-script") == 0 && i + 1 < argc) {
+            if (!Headless.loadTouchScript(argv[++i])) {
+                printf("Error: unable to read touch script %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--dump-frame") == 0 && i + 1 < argc) {
+            Headless.dumpFrame(atol(argv[++i]));
+        } else if (strcmp(argv[i], "--dump-dir") == 0 && i + 1 < argc) {
+            Headless.setDumpFolder(argv[++i]);
+        } else if (strcmp(argv[i], "--warm") == 0 && i + 1 < argc) {
+            warmSet = parseWarmSet(argv[++i]);
+            if (warmSet < 0) {
+                printf("Warning: unknown warm set %s (use none, hot or all); warming everything\n", argv[i]);
+                warmSet = WARM_ALL;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            replayFast = true;
+        } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            reportPath = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--update-baseline") == 0) {
+            updateBaseline = true;
+        } else if (strcmp(argv[i], "--require-baseline") == 0) {
+            requireBaseline = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            Trace.setPath(argv[++i]);
+            traceOnExit = true;
+        } else if (strcmp(argv[i], "--no-trace") == 0) {
+            Trace.setEnabled(false);
+        } else if (strcmp(argv[i], "--fps") == 0) {
+            Trace.setOverlay(true);
+        } else if (strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc) {
+            char tagName[32];
+            double megabytes;
+            int tag = -1;
+            if (sscanf(argv[++i], "%31[^=]=%lf", tagName, &megabytes) == 2) {
+                tag = MemoryLedger::tagByName(tagName);
+            }
+            if (tag < 0) {
+                printf("Warning: bad memory budget %s (use e.g. images=40)\n", argv[i]);
+            } else {
+                Memory.setBudget(tag, (size_t)(megabytes * 1048576.0));
+            }
+        }
+    }
+    Trace.nameThread("main");
 
-    return 0;
-}
+    Device = createBackend(backendName);
+    if (!Device) {
+        printf("Error: unknown backend %s\n", backendName);
+        return 1;
+    }
+    if (bench) {
+        // Times everything up to the title screen as the cold start scenario
+        Bench.start(Device);
+        Device = &Bench;
+    }
 
+    // Load data, from the compiled dataset (make data) when it is up to date, since that needs no parsing
+    char binaryPath[260];
+    compiledDatasetPath(dataPath, binaryPath, sizeof(binaryPath));
+    int count = 0;
+    {
+        MEMORY_TAG(MEM_DATASET);
+        if (binaryDatasetIsFresh(binaryPath, dataPath)) {
+            count = Emissions.loadBinary(binaryPath);
+        }
+        if (count == 0) {
+            count = Emissions.load(dataPath);
+        }
+    }
+    if (count < 2) {
+        printf("Error: The game needs at least two activities in %s.\n", dataPath);
+        return 1;
+    }
 
+    // Use the packed asset bundle if one has been built (make bundle); otherwise images load from the loose PNGs
+    if (Bundle.open(BUNDLE_FILE)) {
+        printf("Using asset bundle %s (%d assets)\n", BUNDLE_FILE, Bundle.entryCount());
+    }
 
+    // Load the score summary (imports losing_scores.txt the first time). Benchmarks leave the player's scores alone:
+    // the leaderboard scenarios make a store of their own.
+    if (!bench) {
+        Scores.open(SCORE_LOG_FILE, SCORE_SUMMARY_FILE);
+    }
 
-//////////////////////////
-/* FUNCTION DEFINITIONS */
-//////////////////////////
+    // Decode what the screens will need on every core, behind a progress bar, so no screen hitches on first entry
+    buildWarmManifest();
+    if (Warmup.run(warmSet, drawWarmupProgress) > 0) {
+        // The overlay layers only take a moment once their images are in, but aren't built off the main thread
+        Layers.flatten("round overlays", ROUND_OVERLAYS, 3);
+        Layers.flatten("reveal overlays", REVEAL_OVERLAYS, 2);
+    }
 
-/* Default constructor for Emission class.
-   Initializes every parameter as empty or some default value. */
-Emission::Emission() {
-    strcpy(activityDescription, "");
-    emissionValue = 0.0;
-    strcpy(activityNote, "");
-}
-/* Parameterized constructor for Emission class.
-   Initializes activity description, emission value, note, and text color based on data file. */
-Emission::Emission(const char* activity, double value, const char* note) {
-    strcpy(activityDescription, activity);
-    emissionValue = value;
-    strcpy(activityNote, note);
-}
+    Scenes.add(SCENE_TITLE, &titleScene, "title");
+    Scenes.add(SCENE_MENU, &menuScene, "menu");
+    Scenes.add(SCENE_INSTRUCTIONS, &instructionsScene, "instructions");
+    Scenes.add(SCENE_CREDITS, &creditsScene, "credits");
+    Scenes.add(SCENE_CREDITS_CREDITS, &creditsCreditsScene, "credits_credits");
+    Scenes.add(SCENE_REFERENCES, &referencesScene, "references");
+    Scenes.add(SCENE_LEADERBOARD, &leaderboardScene, "leaderboard");
+    Scenes.add(SCENE_BRIEFING, &briefingScene, "briefing");
+    Scenes.add(SCENE_GAME, &gameScene, "game");
+    Scenes.add(SCENE_LOSING, &losingScene, "losing");
+
+    if (bench) {
+        int status = runBenchmarks(baselinePath, threshold, updateBaseline, requireBaseline);
+        Prefetch.stop();
+        if (traceOnExit && !Trace.write(Trace.path())) {
+            printf("Error: unable to write trace %s\n", Trace.path());
+        }
+        return status;
+    }
 
-/* FUNCTION: Reads emissions data from file emissions_data.csv into an array of Emission objects.
-    Author: Niko
-    Arguments:
-        emissions - Array to store the loaded data.
-        size - Maximum number of entries the array can hold.
-    Returns:
-        count - Number of activity/emissions pair entries loaded or 1 if the file can't be opened.   */
-int loadEmissionsFromFile(Emission emissions[], int size) {
-    FILE* file = fopen("emissions_data.csv", "r");  // Open the CSV (realistically @SV) file
-    if (!file) {
-        printf("Error: Unable to open the data file.\n");
-        return 1;
-        LCD.WriteLine("Error: Unable to open the data file.");
-        while (1) {
-            LCD.Update();
+    // Recordings start at the title screen, after loading and warm-up, so their timing doesn't depend on either
+    Backend* platform = Device;
+    if (replayPath) {
+        if (!Replayer.start(replayPath, platform, replayFast)) {
+            printf("Error: unable to read recording %s\n", replayPath);
+            return 1;
         }
+        Device = &Replayer;
+    } else if (recordPath) {
+        if (!Recorder.start(recordPath, platform)) {
+            printf("Error: unable to create recording %s\n", recordPath);
+            return 1;
+        }
+        Device = &Recorder;
     }
 
-    char activity[128];
-    double value;
-    char note[512];
-    int count = 0;
+    // Enter game, starting on title screen! Every screen runs from this one loop until Quit is pressed.
+    Scenes.run(SCENE_TITLE);
+    Prefetch.stop();
 
-    while (fscanf(file, "%127[^@]@%lf@%511[^\n]\n", activity, &value, note) == 3 && count < size) {
-        emissions[count] = Emission(activity, value, note);
-        count++;
+    if (Device == &Replayer) {
+        if (Replayer.writeReport(reportPath)) {
+            printf("Wrote replay report to %s\n", reportPath);
+        } else {
+            printf("Error: unable to write replay report %s\n", reportPath);
+        }
+    } else if (Device == &Recorder) {
+        Recorder.stop();
+    }
+    Device = platform;
+    if (traceOnExit && !Trace.write(Trace.path())) {
+        printf("Error: unable to write trace %s\n", Trace.path());
     }
 
-    fclose(file);
-    printf("Successfully loaded %i data entries.", count);
-    return count;
+    Images.printStats();
+    Display.printStats();
+    Input.printStats();
+    Scenes.printStats();
+    Scores.printStats();
+    Emissions.printStats();
+    Layers.printStats();
+    Cards.printStats();
+    TextLayouts.printStats();
+    Glyphs.printStats();
+    Animations.printStats();
+    Prefetch.printStats();
+    Warmup.printStats();
+    if (Device == &Headless) {
+        Headless.printStats();
+    }
+    correctAnimation.printStats("correct_animation");
+    incorrectAnimation.printStats("incorrect_animation");
+    losingScene.printStats();
+    Memory.printStats();
+    return 0;
 }
 
-/* FUNCTION: Generates TWO distinct random integers between 0 and max (inclusive), ensuring the two integers are not equal.
-    Author: Niko
-    Arguments:
-        max - The maximum value for the random integers, inclusive.
-        index1 - A reference to an integer that will store the first distinct random index.
-        index2 - A reference to an integer that will store the second distinct random index, ensuring it's different from index1.
-    Returns:
-        NONE                                                                                                                            */
-void getDistinctInts(int max, int* index1, int* index2) {
-    *index1 = Random.RandInt() % (max);
-    do {
-        *index2 = Random.RandInt() % (max);
-    } while (*index2 == *index1);
-}
 
-/* FUNCTION: Generates ONE random integer between 0 and max (inclusive), ensuring it is different from the previously selected index.
-    Author: Niko
-    Arguments:
-        max - The maximum value for the random integer, exclusive. The function will generate a random integer in the range [0, max].
-        currentIndex - The index of the "winning" value (the current value to compare against).
-        newIndex - A reference to an integer that will store the new distinct random index, ensuring it's different from currentIndex.
-    Returns:
-        NONE                                                                                                                            */
-void getDistinctIntForNextRound(int max, int currentIndex, int* newIndex) {
-    int attempts = 0;
-    const int MAX_ATTEMPTS = 10;  // Max attempts to generate a distinct value randomly
 
-    do {
-        *newIndex = Random.RandInt() % max;
-        attempts++;
-    } while (*newIndex == currentIndex && attempts < MAX_ATTEMPTS);
 
-    // If after multiple attempts we still get currentIndex, adjust manually
-    if (*newIndex == currentIndex) {
-        *newIndex = (currentIndex + 1) % max;
-    }
-}
+//////////////////////////
+/* FUNCTION DEFINITIONS */
+//////////////////////////
 
 /* FUNCTION: Displays an activity and its emissions value on the LEFT half of the screen.
     Author: Niko
@@ -196,34 +516,10 @@ void getDistinctIntForNextRound(int max, int currentIndex, int* newIndex) {
     Returns:
         NONE                                                                              */
 void displayActivityLeft(int index) {
-    char filename[20];
-    sprintf(filename, "emissions_images\\%d.png", index);
-
-    FEHImage leftImage(filename);
-    leftImage.Draw(0,0);
-
-    LCD.SetFontColor(WHITE);
-    unsigned int textColor = WHITE;
-
-    int lineHeight = 17;
-    int currentY = 4;
+    // Image, description, value and unit all come pre-rendered on the activity's card
+    drawCard(index, CARD_LEFT | CARD_VALUE, 0);
 
-    printTextWithinBox(emissions[index].activityDescription, textColor, 8, 24, 145, 200);
-
-    // Display value below description
-    char valueText[20];
-    if (emissions[index].emissionValue == (int)emissions[index].emissionValue) {
-        sprintf(valueText, "%d", (int)emissions[index].emissionValue);
-    } else if (emissions[index].emissionValue == (int)(emissions[index].emissionValue * 10) / 10.0) {
-        sprintf(valueText, "%.1f", emissions[index].emissionValue);
-    } else {
-        sprintf(valueText, "%.2f", emissions[index].emissionValue);
-    }
-
-    printTextWithinBox(valueText, textColor, 4, 200, 156, 216);
-    printTextWithinBox("kg CO2eq", textColor, 4, 220, 156, 236);
-
-    LCD.Update();
+    Display.update();
 }
 
 /* FUNCTION: Displays an activity and its emissions value on the RIGHT half of the screen.
@@ -233,27 +529,182 @@ void displayActivityLeft(int index) {
     Returns:
         NONE                                                                              */
 void displayActivityRight(int index) {
-    char filename[20];
-    sprintf(filename, "emissions_images\\%d.png", index);
+    drawCard(index, CARD_RIGHT, 160);
 
-    FEHImage rightImage(filename);
-    rightImage.Draw(160,0);
+    // Higher/lower buttons, versus sign and note buttons in one pass
+    drawRoundOverlays();
 
-    unsigned int textColor = WHITE;
-    LCD.SetFontColor(textColor);
+    Display.update();
+}
 
-    int lineHeight = 17;
-    int currentY = 4;
+/* FUNCTION: Lists every asset the startup warm-up can load, hot ones first: the title art, the round overlays and
+             the answer animations, then every prompt image, the other screens' art and the first frames of each GIF.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                             */
+void buildWarmManifest() {
+    Warmup.addImage("images\\title_screen.png", WARM_HOT);
+    Warmup.addImage("images\\meaner_greener_buttons.png", WARM_HOT);
+    Warmup.addImage("images\\note_buttons.png", WARM_HOT);
+    Warmup.addImage("correct_animation\\0.png", WARM_HOT);
+    Warmup.addAnimation(&correctAnimation, "correct_animation", 1, ANSWER_ANIMATION_FRAMES, WARM_HOT);
+    Warmup.addAnimation(&incorrectAnimation, "incorrect_animation", 1, ANSWER_ANIMATION_FRAMES, WARM_HOT);
+
+    char path[64];
+    for (int i = 0; i < Emissions.size(); i++) {
+        sprintf(path, "emissions_images\\%d.png", i);
+        Warmup.addImage(path, WARM_ALL);
+    }
 
-    printTextWithinBox(emissions[index].activityDescription, textColor, 175, 24, 312, 200);
+    Warmup.addImage("images\\before_you_play1.png", WARM_ALL);
+    Warmup.addImage("images\\before_you_play2.png", WARM_ALL);
+    Warmup.addImage("images\\instructions.png", WARM_ALL);
+    Warmup.addImage("images\\credits.png", WARM_ALL);
+    Warmup.addImage("images\\references.png", WARM_ALL);
+
+    for (int gif = 1; gif <= NUM_GIFS; gif++) {
+        std::vector<FrameInfo> frames;
+        sprintf(path, "GIFs\\%d\\", gif);
+        if (loadFrameSequence(path, &frames)) {
+            for (int i = 0; i < GIF_WARM_FRAMES && i < (int)frames.size(); i++) {
+                Warmup.addImage(frames[i].path.c_str(), WARM_ALL);
+            }
+        }
+    }
+}
+
+/* FUNCTION: Runs the frame-time benchmark scenarios after the cold start (see bench.h), BENCH_RUNS times: the idle
+             title screen, one round's value reveal, answer animations and prompt slide, BENCH_GIF_SECONDS of each
+             losing screen GIF and the leaderboard with 1k, 100k and 10M games logged. Then prints the results and
+             checks them against the baseline, saving them as the baseline if there isn't one yet (unless
+             requireBaseline is set) or updateBaseline is set.
+    Author: Niko
+    Arguments:
+        baselinePath - Native path of the baseline file.
+        threshold - Slowdown allowed before a result counts as a regression, as a fraction.
+        updateBaseline - Whether to save this run as the baseline instead of comparing.
+        requireBaseline - Whether a missing baseline is a failure rather than a first run.
+    Returns:
+        The exit status: 1 if anything regressed, 2 if a required baseline is missing, otherwise 0.                   */
+int runBenchmarks(const char* baselinePath, double threshold, bool updateBaseline, bool requireBaseline) {
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        Bench.begin("title_idle", BENCH_IDLE_SECONDS);
+        Scenes.run(SCENE_TITLE);
+
+        // A round on the first three prompts, their cards rendered beforehand as the loader thread would have
+        Bench.end();
+        int left = 0, right = 1, next = 2 % Emissions.size();
+        Cards.get(left, CARD_LEFT | CARD_VALUE);
+        Cards.get(right, CARD_RIGHT);
+        Cards.get(right, CARD_RIGHT | CARD_VALUE);
+        Cards.get(next, CARD_RIGHT);
+        displayActivityLeft(left);
+        displayActivityRight(right);
+
+        Bench.begin("scrolling_value");
+        scrollingValue(right);
+        Bench.begin("correct_animation");
+        correct_animation();
+        Bench.begin("slide_prompts");
+        slidePrompts(left, right, next);
+        Bench.begin("incorrect_animation");
+        incorrect_animation();
+
+        losingScene.setScore(0);
+        for (int gif = 1; gif <= NUM_GIFS; gif++) {
+            char name[20];
+            sprintf(name, "gif_%d", gif);
+            losingScene.setGif(gif);
+            Bench.begin(name, BENCH_GIF_SECONDS);
+            Scenes.run(SCENE_LOSING);
+        }
+        losingScene.setGif(0);
+
+        // Opening the store is part of opening the leaderboard here, so a store that grows with the log would show
+        const unsigned long games[] = {1000, 100000, 10000000};
+        const char* names[] = {"leaderboard_1k", "leaderboard_100k", "leaderboard_10m"};
+        for (int i = 0; i < 3; i++) {
+            Bench.end();
+            Scores.create(BENCH_SCORE_LOG, BENCH_SCORE_SUMMARY, games[i], BENCH_SEED);
+            Bench.begin(names[i], BENCH_LEADERBOARD_SECONDS);
+            Scores.open(BENCH_SCORE_LOG, BENCH_SCORE_SUMMARY);
+            Scenes.run(SCENE_LEADERBOARD);
+        }
+    }
+    Bench.end();
+    remove(BENCH_SCORE_LOG);
+    remove(BENCH_SCORE_SUMMARY);
+
+    Bench.printResults();
+    if (!updateBaseline) {
+        int regressions = Bench.compare(baselinePath, threshold);
+        if (regressions > 0) {
+            printf("%d regressions of more than %.0f%% against %s\n", regressions, threshold * 100.0, baselinePath);
+            return 1;
+        }
+        if (regressions == 0) {
+            printf("No regressions of more than %.0f%% against %s\n", threshold * 100.0, baselinePath);
+            return 0;
+        }
+        if (requireBaseline) {
+            printf("Error: no baseline at %s (save one with --update-baseline on this machine)\n", baselinePath);
+            return 2;
+        }
+        printf("No baseline at %s yet\n", baselinePath);
+    }
+    if (!Bench.writeBaseline(baselinePath)) {
+        printf("Error: unable to write baseline %s\n", baselinePath);
+        return 1;
+    }
+    printf("Saved this run as the baseline in %s\n", baselinePath);
+    return 0;
+}
 
-    FEHImage buttons("images\\meaner_greener_buttons.png");
-    buttons.Draw(0,0);
-    displayVersus(); 
-    FEHImage note_buttons("images\\note_buttons.png");
-    note_buttons.Draw(0,0);
+/* FUNCTION: Draws the startup progress screen.
+    Author: Niko
+    Arguments:
+        done, total - Assets warmed so far, out of how many.
+    Returns:
+        NONE                                               */
+void drawWarmupProgress(int done, int total) {
+    if (done == 0) {
+        Display.clear(BLACK);
+        Display.writeAt("Loading...", 100, 96, WHITE);
+        Display.drawRect(40, 120, 240, 16, WHITE);
+    }
+    Display.fillRect(42, 122, 236 * done / total, 12, WHITE);
+    Display.update();
+}
 
-    LCD.Update();
+/* FUNCTION: Draws an image through the shared image cache, so each file is only decoded once per session.
+    Author: Niko
+    Arguments:
+        path - Asset path of the image.
+        x, y - Screen coordinates of the image's top-left corner (the image is clipped to the screen).
+    Returns:
+        NONE                                                                                               */
+void drawImage(const char* path, int x, int y) {
+    std::shared_ptr<const Image> image = Images.get(path);
+    if (image) {
+        Display.drawImage(*image, x, y);
+    }
+}
+
+/* FUNCTION: Draws an activity's pre-rendered card (see card_cache.h) at the top of the screen.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+        layout - CARD_* layout flags.
+        x - Screen x coordinate of the card's left edge (the card is clipped to the screen).
+    Returns:
+        NONE                                                                                 */
+void drawCard(int index, int layout, int x) {
+    std::shared_ptr<const Image> card = Cards.get(index, layout);
+    if (card) {
+        Display.drawImage(*card, x, 0);
+    }
 }
 
 /* FUNCTION: Draws a button with specified coordinates, colors, and text label.
@@ -270,10 +721,7 @@ void drawButtonWithText(int x1, int y1, int x2, int y2, unsigned int rectColor,
     int buttonWidth = x2 - x1;
     int buttonHeight = y2 - y1;
     
-    LCD.SetFontColor(rectColor);
-    LCD.DrawRectangle(x1, y1, buttonWidth, buttonHeight);
-
-    LCD.SetFontColor(textColor);
+    Display.drawRect(x1, y1, buttonWidth, buttonHeight, rectColor);
     
     int midX = (x1 + x2) / 2;
     int midY = (y1 + y2) / 2;
@@ -281,41 +729,68 @@ void drawButtonWithText(int x1, int y1, int x2, int y2, unsigned int rectColor,
     int textX = midX - textWidth / 2;
     int textY = midY - 8; 
     
-    LCD.WriteAt(textLabel, textX, textY);
-    
-    LCD.Update();
+    Display.writeAt(textLabel, textX, textY, textColor);
 }
 
-/* FUNCTION: Detects if a button is pressed based on its coordinates.
-    Author: Reagan
+/* FUNCTION: Draws standard back button in the bottom right of screen.
+    Author: Niko
     Arguments:
-        x1, y1 - Coordinates for the top-left corner of the button.
-        x2, y2 - Coordinates for the bottom-right corner of the button.
+        NONE
     Returns:
-        1 if the button is pressed, 0 otherwise.                       */
-int buttonPress(int x1, int y1, int x2, int y2) {
-    float x_pos, y_pos;
-    float x_trash, y_trash;
+        NONE                                                          */ 
+void drawBackButton() {
+    drawButtonWithText(252, 209, 319, 239, WHITE, "Back", WHITE);
+}
 
-    if (LCD.Touch(&x_pos, &y_pos)) {
-        if (x_pos >= x1 && x_pos <= x2 && y_pos >= y1 && y_pos <= y2) {
-            while (LCD.Touch(&x_trash, &y_trash)) {};
+/* FUNCTION: Shows the title screen with the arrow visible and its first flash due in half a second.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                          */
+void TitleScene::enter() {
+    continueButton = Input.addButton(273, 206, 306, 227);
+    isFlashing = false;
+    lastFlashTime = Device->now();
+}
 
-            return 1;
-        }
+/* FUNCTION: Continues to the main menu when the arrow is pressed.
+    Author: Niko
+    Arguments:
+        event - The touch event.
+    Returns:
+        SCENE_MENU if the arrow was pressed, SCENE_STAY otherwise.  */
+int TitleScene::touch(const TouchEvent& event) {
+    if (event.type == TOUCH_PRESS && event.button == continueButton) {
+        return SCENE_MENU;
     }
+    return SCENE_STAY;
+}
 
-    return 0;
+/* FUNCTION: Flashes the "Continue" arrow on and off every half second.
+    Author: Niko
+    Arguments:
+        now - Current time in seconds.
+    Returns:
+        SCENE_STAY                                                       */
+int TitleScene::tick(double now) {
+    if (now - lastFlashTime >= 0.5) {
+        isFlashing = !isFlashing;
+        lastFlashTime = now;
+        redraw();
+    }
+    return SCENE_STAY;
 }
 
-/* FUNCTION: Draws standard back button in the bottom right of screen.
+/* FUNCTION: Works out how long the loop can sleep before the arrow is due to flash.
     Author: Niko
     Arguments:
-        NONE
+        now - Current time in seconds.
     Returns:
-        NONE                                                          */ 
-void drawBackButton() {
-    drawButtonWithText(252, 209, 319, 239, WHITE, "Back", WHITE);
+        Seconds until the next flash (0 if it is already due).                        */
+double TitleScene::wakeTime(double now) {
+    double untilFlash = lastFlashTime + 0.5 - now;
+    return untilFlash > 0 ? untilFlash : 0;
 }
 
 /* FUNCTION: Displays the title screen with a flashing continue arrow.
@@ -324,163 +799,150 @@ void drawBackButton() {
         NONE
     Returns:
         NONE                                                          */
-void titleScreen() {
-    FEHImage titleScreen("images\\title_screen.png");
-    
-    // "Continue" arrow flashing functionality
-    bool isFlashing = false;
-    float lastFlashTime = TimeNow();
-
-    while (1) {
-        float currentTime = TimeNow();
-        if (currentTime - lastFlashTime > 0.5) {
-            isFlashing = !isFlashing;
-            lastFlashTime = currentTime;
-        }
+void TitleScene::draw() {
+    Display.clear(BLACK);
+    drawImage("images\\title_screen.png", 0, 0);
 
-        LCD.Clear(BLACK);
-        titleScreen.Draw(0, 0);
+    if (isFlashing) {
+        Display.fillRect(273, 206, 33, 21, BLACK);
+    }
+}
 
-        if (isFlashing) {
-            LCD.SetFontColor(BLACK);
-            LCD.FillRectangle(273, 206, 33, 21);
-        }
-        if (buttonPress(273, 206, 306, 227)) {
-            mainMenu();
-            return;
-        }
+/* FUNCTION: Sets up a screen that shows one premade image with the standard back button.
+    Author: Niko
+    Arguments:
+        path - Asset path of the image.
+        clearFirst - Whether to clear the screen first (for images that don't cover all of it).
+        backScene - Scene the back button goes to.
+    Returns:
+        NONE                                                                                     */
+ImageScene::ImageScene(const char* path, bool clearFirst, int backScene)
+    : path(path), clearFirst(clearFirst), backScene(backScene), backButton(-1) {
+}
 
-        LCD.Update();
-        Sleep(10);
+/* FUNCTION: Registers the back button.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                             */
+void ImageScene::enter() {
+    backButton = Input.addButton(252, 209, 319, 239);
+}
+
+/* FUNCTION: Goes back when the back button is pressed.
+    Author: Niko
+    Arguments:
+        event - The touch event.
+    Returns:
+        The scene given to the constructor if the back button was pressed, SCENE_STAY otherwise.  */
+int ImageScene::touch(const TouchEvent& event) {
+    if (event.type == TOUCH_PRESS && event.button == backButton) {
+        return backScene;
     }
+    return SCENE_STAY;
 }
 
-/* FUNCTION: Displays the instructions screen.
+/* FUNCTION: Displays a premade screen image (instructions, "credits" with the game's logo and each of our names, or
+             "abbreviated references") with the standard back button.
     Author: Reagan
     Arguments:
         NONE
     Returns:
-        NONE                                  */
-void instructionsScreen() {
-    FEHImage instructions("images\\instructions.png");
-    instructions.Draw(0,0);
+        NONE                                                                                                           */
+void ImageScene::draw() {
+    if (clearFirst) {
+        Display.clear(BLACK);
+    }
+    drawImage(path, 0, 0);
     drawBackButton();
-    LCD.Update();
-    while (1) {
-        if (buttonPress(252, 209, 319, 239)) {
-            mainMenu();
-            return;
-        }
+}
+
+/* FUNCTION: Registers the back, references and credits buttons.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                      */
+void CreditsScene::enter() {
+    backButton = Input.addButton(252, 209, 319, 239);
+    referencesButton = Input.addButton(15, 108, 305, 150);
+    creditsButton = Input.addButton(35, 60, 285, 102);
+}
+
+/* FUNCTION: Allows for navigation from the credits menu to references or game credits.
+    Author: Reagan
+    Arguments:
+        event - The touch event.
+    Returns:
+        The scene to go to, or SCENE_STAY.                                                */
+int CreditsScene::touch(const TouchEvent& event) {
+    if (event.type != TOUCH_PRESS) {
+        return SCENE_STAY;
     }
+    if (event.button == backButton) {           // Back to menu
+        return SCENE_MENU;
+    }
+    if (event.button == referencesButton) {     // To references
+        return SCENE_REFERENCES;
+    }
+    if (event.button == creditsButton) {        // To credits
+        return SCENE_CREDITS_CREDITS;
+    }
+    return SCENE_STAY;
 }
 
-/* FUNCTION: Displays the credits menu and allows for navigation to references or game credits.
+/* FUNCTION: Displays the credits menu.
     Author: Reagan
     Arguments:
         NONE
     Returns:
-        NONE                                                                                   */
-void creditsScreen() {
-    LCD.Clear(BLACK);
+        NONE                          */
+void CreditsScene::draw() {
+    Display.clear(BLACK);
 
     drawButtonWithText(35, 60, 285, 102, WHITE, "Credits", WHITE);
     drawButtonWithText(35, 108, 285, 150, WHITE, "Abbr. References", WHITE);
     drawBackButton();
-    LCD.Update();
-    
-    while (1) {
-        if (buttonPress(252, 209, 319, 239)) {  // Back to menu
-            mainMenu();
-            return;
-        }
-        if (buttonPress(15, 108, 305, 150)) {   // To references
-            referencesScreen();
-            return;
-        }
-        if (buttonPress(35, 60, 285, 102)) {    // To credits
-            creditsCreditsScreen();
-            return;
-        }
-    }
 }
 
-/* FUNCTION: Displays premade "credits" image that illustrates the game's logo and each of our names. 
+/* FUNCTION: Loads the leaderboard with the top 5 scores from previous games (every single losing score is logged on
+             the device, so high scores are DEVICE SPECIFIC). The score store keeps the top scores up to date as games
+             are logged, so this is O(5) however many games have been played.
     Author: Reagan
     Arguments:
         NONE
     Returns:
-        NONE                                                                                        */
-void creditsCreditsScreen() {
-    FEHImage a("images\\credits.png");
-    a.Draw(0,0);
-    drawBackButton();
-    LCD.Update();
+        NONE                                                                                                         */
+void LeaderboardScene::enter() {
+    backButton = Input.addButton(252, 209, 319, 239);
 
-    while (1) {
-        if (buttonPress(252, 209, 319, 239)) {
-            creditsScreen();
-            return;
-        }
+    for (int i=0; i<5; i++) {
+        topScores[i] = i < Scores.topCount() ? Scores.top(i) : 0;
     }
 }
 
-/* FUNCTION: Displays premade "abbreviated references" image.
-    Author: Niko
+/* FUNCTION: Goes back to the main menu when the back button is pressed.
+    Author: Reagan
     Arguments:
-        NONE
+        event - The touch event.
     Returns:
-        NONE                                                 */
-void referencesScreen() {
-    LCD.Clear(BLACK);
-    FEHImage references("images\\references.png");
-    references.Draw(0,0);
-
-    drawBackButton();
-    while (1) {
-        if (buttonPress(252, 209, 319, 239)) {
-            creditsScreen();
-            return;
-        }
+        SCENE_MENU if the back button was pressed, SCENE_STAY otherwise.  */
+int LeaderboardScene::touch(const TouchEvent& event) {
+    if (event.type == TOUCH_PRESS && event.button == backButton) {
+        return SCENE_MENU;
     }
+    return SCENE_STAY;
 }
 
-/* FUNCTION: Displays the leaderboard with the top 5 scores from previous games (reads in .txt file with every 
-             single losing score, so high scores are DEVICE SPECIFIC).
+/* FUNCTION: Displays the leaderboard read in enter().
     Author: Reagan
     Arguments:
         NONE
     Returns:
-        NONE                                                                                                  */
-void leaderboardScreen() {
-    LCD.Clear(BLACK);
-    
-    FILE *scoresFile = fopen("losing_scores.txt", "r");
-    if (!scoresFile) {
-        printf("Error: Unable to open losing_scores.txt\n");
-    }
-
-    int scoresData[1000];
-    int index = 0;
-
-    while (fscanf(scoresFile, "%i", &scoresData[index]) != EOF && index < 1000) {
-        index++;
-    }
-    fclose(scoresFile);
-
-    //  Iterate to find top 5 scores ever
-    int topScores[5] = {0, 0, 0, 0, 0};
-    for (int i=0; i<5; i++) {
-        int maxIndex = -1;
-        for (int j=0; j<index; j++) {
-            if (scoresData[j] > topScores[i]) {
-                topScores[i] = scoresData[j];
-                maxIndex = j;
-            }
-        }
-        if (maxIndex != -1) {
-            scoresData[maxIndex] = -1;  // Set currently found top score to -1 so that second highest can be found, then third, then fourth...
-        }
-    }
+        NONE                                         */
+void LeaderboardScene::draw() {
+    Display.clear(BLACK);
 
     // Display leaderboard title and top 5 scores on LCD
     char scoresStr[5][20];
@@ -488,8 +950,7 @@ void leaderboardScreen() {
         sprintf(scoresStr[i], "%i", topScores[i]);  // Format top scores as strings for compatibility with printTextWithinBox()
     }
     printTextWithinBox("DEVICE TOP 5 SCORES:", WHITE, 0, 0, 320, 30);
-    LCD.SetFontColor(WHITE);
-    LCD.DrawLine(35, 32, 285, 32);
+    Display.drawLine(35, 32, 285, 32, WHITE);
     printTextWithinBox(scoresStr[0], WHITE, 0, 40, 319, 70);
     printTextWithinBox(scoresStr[1], WHITE, 0, 80, 319, 110);
     printTextWithinBox(scoresStr[2], WHITE, 0, 120, 319, 150);
@@ -497,119 +958,102 @@ void leaderboardScreen() {
     printTextWithinBox(scoresStr[4], WHITE, 0, 200, 319, 230);
 
     drawBackButton();
-    LCD.Update();
-    while (1) {
-        if (buttonPress(252, 209, 319, 239)) {
-            mainMenu();
-            return;
-        }
-    }
 }
 
-/* FUNCTION: Displays a any text string both horizontally and vertically centered within a defined "text box" on the LCD.
+/* FUNCTION: Remembers the final score to show, and works out its rank among every game logged on the device.
     Author: Niko
     Arguments:
-        note - The note text to display.
-        textColor - The color of the text.
-        x1, y1 - Coordinates for the top-left corner of the box.
-        x2, y2 - Coordinates for the bottom-right corner of the box.
-    Returns:    
-        NONE                                                                                                             */                                   
-void printTextWithinBox(const char* note, unsigned int textColor, int x1, int y1, int x2, int y2) {
-    int noteLength = strlen(note);
-    const int lineLength = (x2 - x1) / 12; // Each char is 12px wide, determine how many characters fit per line of text w/in dimensions
-    const int lineHeight = 17;
-
-    int totalLines = (noteLength + lineLength - 1) / lineLength; // Calculate total lines needed, rounding up
-    int textHeight = totalLines * lineHeight;
-
-    int initialY = y1 + ((y2 - y1) - textHeight) / 2;
-
-    int lineStartChar = 0;
-
-    while (lineStartChar < noteLength) {
-        int lineEndChar = lineStartChar + lineLength;
-        if (lineEndChar < noteLength) {
-            // Avoid splitting words in the middle
-            while (lineEndChar > lineStartChar && note[lineEndChar] != ' ' && note[lineEndChar] != '\0') {
-                lineEndChar--;
-            }
-        }
-
-        // If no space is found, use the full line length
-        if (lineEndChar == lineStartChar) {
-            lineEndChar = lineStartChar + lineLength;
-        }
-
-        char line[lineEndChar - lineStartChar + 1];
-        strncpy(line, note + lineStartChar, lineEndChar - lineStartChar);
-        line[lineEndChar - lineStartChar] = '\0';
-
-        // Calculate the X position to center the text horizontally within the box
-        int textWidth = strlen(line) * 12;
-        int textX = x1 + (x2 - x1 - textWidth) / 2;
-
-        LCD.SetFontColor(textColor);
-        LCD.WriteAt(line, textX, initialY);
-
-        // Move the current line start "cursor" down by the line height
-        initialY += lineHeight;
-        lineStartChar = lineEndChar + 1;
-    }
+        score - The final score.
+    Returns:
+        NONE                                                                                                   */
+void LosingScene::setScore(int score) {
+    sprintf(scoreText, "Score: %d", score);
+    sprintf(rankText, "Better than %d%% of players", (int)Scores.percentile(score));
 }
 
-/* FUNCTION: Displays a losing screen with a GIF and final score.
+/* FUNCTION: Starts a randomly selected GIF playing.
     Author: Niko
     Arguments:
-        score - The players score after which they lost.
+        NONE
     Returns:
-        NONE                                                     */
-void losingScreen(int score) {
-    // Randomly select a GIF
-    int randomGifIndex = Random.RandInt() % NUM_GIFS + 1;
+        NONE                                   */
+void LosingScene::enter() {
+    gifIndex = forcedGif > 0 ? forcedGif : Device->randInt() % NUM_GIFS + 1;
 
     char folderPath[30];
-    sprintf(folderPath, "GIFs\\%d\\", randomGifIndex);
-
-    int frameIndex = 0;
-    const unsigned int frameDelayMs = 40;  // Each frame lasts for 40 ms (25 FPS)
-    unsigned int lastFrameTimeMs = TimeNow() * 1000;
-    char scoreText[20];
-    sprintf(scoreText, "Score: %d", score);
+    sprintf(folderPath, "GIFs\\%d\\", gifIndex);
 
-    // Infinite loop to play GIF
-    while (true) {
-        unsigned int currentTimeMs = TimeNow() * 1000;
+    // Frames are decoded ahead of time on a worker thread; tick() only picks up the ones that are ready
+    gif.open(folderPath);
+    frame = NULL;
 
-        if ((currentTimeMs - lastFrameTimeMs) >= frameDelayMs) {
-            char filename[100];
-            sprintf(filename, "%sframe_%02d_delay-0.04s.png", folderPath, frameIndex);
-            
-            FEHImage frameImage(filename);
-            frameImage.Draw(0, 0);
+    backButton = Input.addButton(252, 209, 319, 239);
+}
 
-            frameIndex++;
-            if (frameIndex >= NUM_FRAMES[randomGifIndex - 1]) {
-                frameIndex = 0;
-            }
+/* FUNCTION: Stops the GIF's decoding thread and frees its frames.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                        */
+void LosingScene::exit() {
+    gif.close();
+}
 
-            lastFrameTimeMs = currentTimeMs;
+/* FUNCTION: Goes back to the main menu when the back button is pressed.
+    Author: Niko
+    Arguments:
+        event - The touch event.
+    Returns:
+        SCENE_MENU if the back button was pressed, SCENE_STAY otherwise.  */
+int LosingScene::touch(const TouchEvent& event) {
+    if (event.type == TOUCH_PRESS && event.button == backButton) {
+        return SCENE_MENU;
+    }
+    return SCENE_STAY;
+}
 
-            drawBackButton();
-            printTextWithinBox("You lost!", WHITE, 0, 70, 319, 120);
-            printTextWithinBox(scoreText, WHITE, 0, 100, 319, 150);
-            
-            LCD.Update();
-        }
+/* FUNCTION: Redraws as soon as the player says the next frame is due.
+    Author: Niko
+    Arguments:
+        now - Current time in seconds.
+    Returns:
+        SCENE_STAY                                                      */
+int LosingScene::tick(double now) {
+    const Image* next = gif.update(now);
+    if (next) {
+        frame = next;
+        redraw();
+    }
+    return SCENE_STAY;
+}
 
-        // Check for the back button press continuously
-        if (buttonPress(252, 209, 319, 239)) {
-            mainMenu();
-            return;
-        }
+/* FUNCTION: Wakes often enough not to miss a frame (the player drops frames if the loop oversleeps).
+    Author: Niko
+    Arguments:
+        now - Current time in seconds.
+    Returns:
+        Seconds to sleep at most.                                                                      */
+double LosingScene::wakeTime(double now) {
+    return 0.005;
+}
 
-        Sleep(1);
+/* FUNCTION: Displays the losing screen's current GIF frame and the final score.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                    */
+void LosingScene::draw() {
+    if (!frame) {
+        return;
     }
+    Display.drawImage(*frame, 0, 0);
+
+    drawBackButton();
+    printTextWithinBox("You lost!", WHITE, 0, 70, 319, 120);
+    printTextWithinBox(scoreText, WHITE, 0, 100, 319, 150);
+    printTextWithinBox(rankText, WHITE, 0, 130, 319, 180);
 }
 
 /* FUNCTION: Displays premade versus sign image between the two activities.
@@ -619,8 +1063,7 @@ void losingScreen(int score) {
     Returns:
         NONE                                                               */
 void displayVersus() {
-    FEHImage versus("correct_animation\\0.png");
-    versus.Draw(0,0);
+    drawOverlay("correct_animation\\0.png", 0, 0);
 }
 
 /* FUNCTION: Plays the animation for a CORRECT answer as a sequence of premade frames.
@@ -630,30 +1073,7 @@ void displayVersus() {
     Returns:
         NONE                                                                          */
 void correct_animation() {
-    int frameIndex = 1;
-    const unsigned int frameDelayMs = 10;  // Each frame lasts for 10 ms
-    unsigned int lastFrameTimeMs = TimeNow() * 1000;
-
-    while (frameIndex <= 31) {
-        unsigned int currentTimeMs = TimeNow() * 1000;
-
-        // Only update the frame when the appropriate time has passed
-        if ((currentTimeMs - lastFrameTimeMs) >= frameDelayMs) {
-            char filename[40];
-            sprintf(filename, "correct_animation\\%d.png", frameIndex);
-
-            // Load and draw the current frame
-            FEHImage frameImage(filename);
-            frameImage.Draw(0, 0);
-            LCD.Update();
-
-            frameIndex++;
-
-            lastFrameTimeMs = currentTimeMs;
-        }
-    }
-
-    Sleep(1.0);
+    playAnswerAnimation("correct_animation", &correctAnimation);
 }
 
 /* FUNCTION: Plays the animation for an INCORRECT answer as a sequence of premade frames.
@@ -663,30 +1083,36 @@ void correct_animation() {
     Returns:
         NONE                                                                             */
 void incorrect_animation() {
-    int frameIndex = 1;
-    const unsigned int frameDelayMs = 10;  // Each frame lasts for 10 ms
-    unsigned int lastFrameTimeMs = TimeNow() * 1000;
-
-    while (frameIndex <= 31) {
-        unsigned int currentTimeMs = TimeNow() * 1000;
-
-        // Only update the frame when the appropriate time has passed
-        if ((currentTimeMs - lastFrameTimeMs) >= frameDelayMs) {
-            char filename[40];
-            sprintf(filename, "incorrect_animation\\%d.png", frameIndex);
+    playAnswerAnimation("incorrect_animation", &incorrectAnimation);
+}
 
-            // Load and draw the current frame
-            FEHImage frameImage(filename);
-            frameImage.Draw(0, 0);
-            LCD.Update();
+/* FUNCTION: Plays one of the answer animations on the wall clock (so it lasts ANSWER_ANIMATION_SECONDS on every unit,
+             dropping frames if drawing can't keep up), then holds the last frame for a second. Only the pixels that
+             change between frames are drawn (see delta_animation.h).
+    Author: Niko
+    Arguments:
+        name - The animation's folder ("correct_animation" or "incorrect_animation").
+        animation - Where its delta frames are kept (prefetched when a game starts, or built on the first play).
+    Returns:
+        NONE                                                                                                              */
+void playAnswerAnimation(const char* name, DeltaAnimation* animation) {
+    TRACE_SCOPE(name);
+    // Usually built by the loader thread while the round was up; otherwise it is built here as before
+    Prefetch.claim(animation);
+    if (!animation->isLoaded() && !animation->load(name, 1, ANSWER_ANIMATION_FRAMES)) {
+        return;
+    }
 
-            frameIndex++;
+    Timeline timeline(name, ANSWER_ANIMATION_SECONDS, ANSWER_ANIMATION_SECONDS / (ANSWER_ANIMATION_FRAMES - 1));
+    double progress;
 
-            lastFrameTimeMs = currentTimeMs;
-        }
+    animation->begin();
+    while (timeline.nextFrame(&progress)) {
+        animation->show((int)(progress * (ANSWER_ANIMATION_FRAMES - 1) + 0.5));
+        Display.update();
     }
 
-    Sleep(1.0);
+    Device->sleep(1.0);
 }
 
 /* FUNCTION: Emulates the Higher Lower Game's "sliding" animation.
@@ -699,6 +1125,7 @@ void incorrect_animation() {
     Returns:
         NONE                                                                        */
 void slidePrompts(int index1, int index2, int newIndex) {
+    TRACE_SCOPE("slidePrompts");
     const int screenWidth = 320;
 
     /* Start positions for each prompt (think three image columns: 1 must slide off the screen from position left, 2 must slide from 
@@ -712,12 +1139,20 @@ void slidePrompts(int index1, int index2, int newIndex) {
     int end2 = 0;                 // End position of Activity 2 (leftmost position)
     int end3 = 160;               // End position of Activity 3 (middle of the screen)
 
-    int steps = 30;               // Total number of frames (adjust to control duration of animation)
-    
-    for (int i = 0; i <= steps; i++) {
-        // Calculate t (in range [0, 1]) and interpolate position coordinate
-        float t = (float)i / steps;
-        t = 1 - pow(1 - t, 5);
+    Timeline timeline("slide", SLIDE_SECONDS);
+    double progress;
+
+    // Each prompt slides as the card it is shown as when the slide starts (the new one as it will end up), text included
+    std::shared_ptr<const Image> card1 = Cards.get(index1, CARD_LEFT | CARD_VALUE);
+    std::shared_ptr<const Image> card2 = Cards.get(index2, CARD_RIGHT | CARD_VALUE);
+    std::shared_ptr<const Image> card3 = Cards.get(newIndex, CARD_RIGHT);
+    if (!card1 || !card2 || !card3) {
+        return;
+    }
+
+    while (timeline.nextFrame(&progress)) {
+        // Ease the wall-clock progress (quintic ease-out) and interpolate position coordinate
+        double t = ease(EASE_OUT_QUINT, progress);
 
         // Calculate the interpolated positions
         int position1 = start1 + (end1 - start1) * t;
@@ -726,33 +1161,19 @@ void slidePrompts(int index1, int index2, int newIndex) {
 
         // Draw Prompt 1 if it is still on the screen
         if (position1 + 160 > 0) {
-            FEHImage image1;
-            char filename1[20];
-            sprintf(filename1, "emissions_images\\%d.png", index1);
-            image1.Open(filename1);
-            image1.Draw(position1, 0);
+            Display.drawImage(*card1, position1, 0);
         }
 
         // Draw Prompt 2 (always on the screen)
-        FEHImage image2;
-        char filename2[20];
-        sprintf(filename2, "emissions_images\\%d.png", index2);
-        image2.Open(filename2);
-        image2.Draw(position2, 0);
+        Display.drawImage(*card2, position2, 0);
 
         // Draw Prompt 3 if it has started to slide in
         if (position3 < screenWidth) {
-            FEHImage image3;
-            char filename3[20];
-            sprintf(filename3, "emissions_images\\%d.png", newIndex);
-            image3.Open(filename3);
-            image3.Draw(position3, 0);
+            Display.drawImage(*card3, position3, 0);
         }
 
         // Update the LCD screen to reflect the new positions
-        LCD.Update();
-
-        Sleep(5);
+        Display.update();
     }
 }
 
@@ -763,8 +1184,47 @@ void slidePrompts(int index1, int index2, int newIndex) {
     Returns:
         NONE                                               */
 void drawNoteButtons() {
-    FEHImage note("images\\note_buttons.png");
-    note.Draw(0,0);
+    drawOverlay("images\\note_buttons.png", 0, 0);
+}
+
+/* FUNCTION: Draws a mostly transparent overlay image by its visible spans only (built once, then cached).
+    Author: Niko
+    Arguments:
+        path - Asset path of the overlay.
+        x, y - Screen coordinates of the overlay's top-left corner.
+    Returns:
+        NONE                                                                                              */
+void drawOverlay(const char* path, int x, int y) {
+    std::shared_ptr<const SpanImage> layer = Layers.overlay(path);
+    if (layer) {
+        Display.drawSpans(*layer, x, y);
+    }
+}
+
+/* FUNCTION: Draws the higher/lower buttons, the versus sign and the note buttons, flattened into one layer.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                               */
+void drawRoundOverlays() {
+    std::shared_ptr<const SpanImage> layer = Layers.flatten("round overlays", ROUND_OVERLAYS, 3);
+    if (layer) {
+        Display.drawSpans(*layer, 0, 0);
+    }
+}
+
+/* FUNCTION: Draws the note buttons and the versus sign (what stays up while a value is revealed), flattened into one layer.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                                 */
+void drawRevealOverlays() {
+    std::shared_ptr<const SpanImage> layer = Layers.flatten("reveal overlays", REVEAL_OVERLAYS, 2);
+    if (layer) {
+        Display.drawSpans(*layer, 0, 0);
+    }
 }
 
 /* FUNCTION: Emulates the Higher Lower Game's value "scrolling" animation.
@@ -775,217 +1235,225 @@ void drawNoteButtons() {
     Returns:
         NONE                                                                   */
 void scrollingValue(int index) {
-    char filename[20];
-    sprintf(filename, "emissions_images\\%d.png", index);
-    FEHImage rightImage(filename);
-
-    double emissionValue = emissions[index].emissionValue;
+    TRACE_SCOPE("scrollingValue");
+    double emissionValue = Emissions.value(index);
     char valueText[20];
-    float currentValue = 0.0;
-    int interval = 5; // ms for each update
-    int totalFrames = 30; // Number of frames to complete scrolling effect
-    float increment = emissionValue / totalFrames;
-
-    for (int i = 0; i < totalFrames; i++) {
-        if (currentValue + increment > emissionValue) {
-            increment = emissionValue - currentValue;
-        }
+    Timeline timeline("scroll", SCROLL_SECONDS);
+    double progress;
 
-        currentValue += increment;
+    while (timeline.nextFrame(&progress)) {
+        if (progress < 1.0) {
+            float currentValue = emissionValue * progress;
 
-        rightImage.Draw(160,0);
-        drawNoteButtons();
-        displayVersus();
+            // The card carries the image and description; only the running value is drawn per frame
+            drawCard(index, CARD_RIGHT, 160);
+            drawRevealOverlays();
 
-        LCD.SetFontColor(WHITE);
-        if ((int)currentValue == currentValue) {
-            sprintf(valueText, "%d", (int)currentValue);
+            if ((int)currentValue == currentValue) {
+                sprintf(valueText, "%d", (int)currentValue);
+            } else {
+                sprintf(valueText, "%.2f", currentValue);
+            }
+            int valueX = 164 + (152 - strlen(valueText) * 12) / 2;
+            Display.writeAt(valueText, valueX, 213, WHITE);
         } else {
-            sprintf(valueText, "%.2f", currentValue);
+            // Final display of the exact emission value
+            drawCard(index, CARD_RIGHT | CARD_VALUE, 160);
+            drawRevealOverlays();
         }
-        int valueX = 164 + (152 - strlen(valueText) * 12) / 2;
-        LCD.WriteAt(valueText, valueX, 213);
-        
-        printTextWithinBox(emissions[index].activityDescription, WHITE, 175, 24, 312, 200);
-
-        LCD.Update();
 
-        Sleep(interval);
-    }
-
-    // Final display of the exact emission value
-    rightImage.Draw(160,0);
-    displayVersus();
-    drawNoteButtons();
-    LCD.SetFontColor(WHITE);
-    
-    if (emissions[index].emissionValue == (int)emissions[index].emissionValue) {
-        sprintf(valueText, "%d", (int)emissions[index].emissionValue);
-    } else if (emissions[index].emissionValue == (int)(emissions[index].emissionValue * 10) / 10.0) {
-        sprintf(valueText, "%.1f", emissions[index].emissionValue);
-    } else {
-        sprintf(valueText, "%.2f", emissions[index].emissionValue);
+        Display.update();
     }
 
-    printTextWithinBox(emissions[index].activityDescription, WHITE, 175, 24, 312, 200);
-    printTextWithinBox(valueText, WHITE, 164, 200, 316, 216);
-    printTextWithinBox("kg CO2eq", WHITE, 164, 220, 316, 236);
-
-    Sleep(1.0);   // Keep value up before moving on too quick
+    Device->sleep(1.0);   // Keep value up before moving on too quick
 }
 
-/* FUNCTION: Draws the premade "briefing"/"before you play" image to the screen.
+/* FUNCTION: Draws the current premade "briefing"/"before you play" image to the screen.
     Author: Niko
     Arguments:
         NONE
     Returns:
         NONE                                                                    */
-void displayBriefing() {
-    FEHImage a("images\\before_you_play1.png");
-    FEHImage b("images\\before_you_play2.png");
-    
-    a.Draw(0,0);
-    LCD.Update();
-
-    while (1) {
-        if (buttonPress(0,0,320,240)) {
-            break;
-        }
+void BriefingScene::draw() {
+    if (page == 0) {
+        drawImage("images\\before_you_play1.png", 0, 0);
+    } else {
+        drawImage("images\\before_you_play2.png", 0, 0);
     }
+}
 
-    b.Draw(0,0);
-    LCD.Update();
+/* FUNCTION: Starts the briefing on its first page.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                         */
+void BriefingScene::enter() {
+    page = 0;
+}
 
-    while (1) {
-        if (buttonPress(0,0,320,340)) {
-            break;
-        }
+/* FUNCTION: Turns the page on a tap anywhere; after the last page the game starts.
+    Author: Niko
+    Arguments:
+        event - The touch event.
+    Returns:
+        SCENE_GAME after the last page, SCENE_STAY otherwise.                        */
+int BriefingScene::touch(const TouchEvent& event) {
+    if (event.type != TOUCH_PRESS) {
+        return SCENE_STAY;
     }
-
-    return;
+    if (page == 1) {
+        return SCENE_GAME;
+    }
+    page++;
+    redraw();
+    return SCENE_STAY;
 }
 
-/* FUNCTION: Main game loop that handles playing the game and the overall Higher Lower Game inspired logic.
+/* FUNCTION: Starts a game: gets the initial two distinct prompts and registers the game's buttons.
     Author: Reagan and Niko
     Arguments:
         NONE
     Returns:
-        NONE                                                                                               */
-void playGame() {
-    displayBriefing();
-
-    LCD.Clear(BLACK);
-    LCD.Update();
-
-    int index1, index2, currentIndex, newIndex;
-    int score = 0;
-    bool gameOn = true;
-
-    // Get the initial two distinct prompts
-    getDistinctInts(DATA_SIZE, &index1, &index2);
-
-    while (gameOn) {
-        // Display both activities
-        displayActivityLeft(index1);
-        displayActivityRight(index2);
-        displayVersus();
-        LCD.Update();
-
-        char choice;
-        while (true) {
-            // Check if the user presses "Higher" or "Lower" button
-            if (buttonPress(164, 213, 238, 236)) {
-                choice = 'H';   // User chose "Higher"
-                break;
-            }
-            if (buttonPress(242, 213, 316, 236)) {
-                choice = 'L';   // User chose "Lower"
-                break;
-            }
+        NONE                                                                                          */
+void GameScene::enter() {
+    Display.clear(BLACK);
+    Display.update();
+
+    score = 0;
+    noteIndex = -1;
+    getDistinctInts(Emissions.size(), &index1, &index2);
+    getDistinctIntForNextRound(Emissions.size(), index2, &nextIndex);
+
+    // Get the reveal and the first slide ready while the player decides
+    Prefetch.requestAnimation(&correctAnimation, "correct_animation", 1, ANSWER_ANIMATION_FRAMES);
+    Prefetch.requestAnimation(&incorrectAnimation, "incorrect_animation", 1, ANSWER_ANIMATION_FRAMES);
+    Prefetch.requestPrompt(index2);
+    Prefetch.requestPrompt(nextIndex);
+
+    higherButton = Input.addButton(164, 213, 238, 236);
+    lowerButton = Input.addButton(242, 213, 316, 236);
+    leftNoteButton = Input.addButton(136, 4, 157, 24);
+    rightNoteButton = Input.addButton(296, 4, 317, 24);
+}
 
-            // Check if the user presses the left or right note buttons
-            if (buttonPress(136, 4, 157, 24)) {
-                LCD.Clear(BLACK);
-                printTextWithinBox(emissions[index1].activityNote, WHITE, 0, 0, 320, 240);
-                LCD.Update();
-
-                while (1) {
-                    if (buttonPress(0, 0, 320, 240)) {
-                        displayActivityLeft(index1);
-                        displayActivityRight(index2);
-                        displayVersus();
-                        LCD.Update();
-                        break;
-                    }
-                    Sleep(1);
-                }
-            }
-            if (buttonPress(296, 4, 317, 24)) {
-                LCD.Clear(BLACK);
-                printTextWithinBox(emissions[index2].activityNote, WHITE, 0, 0, 320, 240);
-                LCD.Update();
-
-                while (1) {
-                    if (buttonPress(0, 0, 320, 240)) {
-                        displayActivityLeft(index1);
-                        displayActivityRight(index2);
-                        displayVersus();
-                        LCD.Update();
-                        break;
-                    }
-                    Sleep(1);
-                }
-            }
+/* FUNCTION: Leaves the game: prompts still being prefetched won't be needed.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                 */
+void GameScene::exit() {
+    Prefetch.cancel();
+}
 
-            Sleep(1);
-        }
+/* FUNCTION: Displays both activities, or the note that was asked for.
+    Author: Reagan and Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                           */
+void GameScene::draw() {
+    if (noteIndex >= 0) {
+        Display.clear(BLACK);
+        printTextWithinBox(Emissions.note(noteIndex), WHITE, 0, 0, 320, 240);
+        return;
+    }
 
-        scrollingValue(index2);
+    displayActivityLeft(index1);
+    displayActivityRight(index2);   // Also draws the versus sign
+}
 
-        // Determine if the user was correct
-        if ((choice == 'H' && emissions[index2].emissionValue > emissions[index1].emissionValue) ||
-            (choice == 'L' && emissions[index2].emissionValue < emissions[index1].emissionValue)) {
-            // Correct guess
-            correct_animation();
-            score++;
+/* FUNCTION: Handles the "Higher"/"Lower" and note buttons.
+    Author: Reagan and Niko
+    Arguments:
+        event - The touch event.
+    Returns:
+        SCENE_LOSING once the game is lost, SCENE_STAY otherwise. */
+int GameScene::touch(const TouchEvent& event) {
+    if (event.type != TOUCH_PRESS) {
+        return SCENE_STAY;
+    }
 
-            int previousLeftIndex = index1;
-            int previousRightIndex = index2;
-            currentIndex = index2;
-            getDistinctIntForNextRound(DATA_SIZE, currentIndex, &newIndex);
-            index1 = currentIndex;
-            index2 = newIndex;
+    // A note is up: any tap goes back to the prompts
+    if (noteIndex >= 0) {
+        noteIndex = -1;
+        redraw();
+        return SCENE_STAY;
+    }
 
-            slidePrompts(previousLeftIndex, previousRightIndex, newIndex);
+    // Check if the user presses "Higher" or "Lower" button
+    if (event.button == higherButton) {
+        return answer('H');     // User chose "Higher"
+    }
+    if (event.button == lowerButton) {
+        return answer('L');     // User chose "Lower"
+    }
 
-        } else {
-            // Incorrect guess, end the game
-            gameOn = false;
-            incorrect_animation();
-        }
+    // Check if the user presses the left or right note buttons
+    if (event.button == leftNoteButton) {
+        noteIndex = index1;
+        redraw();
+    }
+    if (event.button == rightNoteButton) {
+        noteIndex = index2;
+        redraw();
     }
+    return SCENE_STAY;
+}
 
-    // Append the losing score to the statistics file
-    FILE* file = fopen("losing_scores.txt", "a");
-    if (file) {
-        fprintf(file, "%d\n", score);
-        fclose(file);
-    } else {
-        printf("Error: Unable to write to losing_scores.txt\n");
+/* FUNCTION: Reveals the right activity's value and plays out a correct or incorrect answer (the overall Higher
+             Lower Game inspired logic).
+    Author: Reagan and Niko
+    Arguments:
+        choice - 'H' for higher or 'L' for lower.
+    Returns:
+        SCENE_LOSING if the answer was wrong, SCENE_STAY otherwise.                                                */
+int GameScene::answer(char choice) {
+    scrollingValue(index2);
+
+    // Determine if the user was correct
+    if ((choice == 'H' && Emissions.value(index2) > Emissions.value(index1)) ||
+        (choice == 'L' && Emissions.value(index2) < Emissions.value(index1))) {
+        // Correct guess
+        correct_animation();
+        score++;
+
+        int previousLeftIndex = index1;
+        int previousRightIndex = index2;
+        int currentIndex = index2;
+        int newIndex = nextIndex;      // Chosen (and prefetched) when the round started
+        index1 = currentIndex;
+        index2 = newIndex;
+
+        // Pick the prompt after this one now, so it loads during the slide and the next round
+        getDistinctIntForNextRound(Emissions.size(), index2, &nextIndex);
+        Prefetch.requestPrompt(nextIndex);
+
+        slidePrompts(previousLeftIndex, previousRightIndex, newIndex);
+        redraw();
+        return SCENE_STAY;
     }
 
+    // Incorrect guess, end the game
+    incorrect_animation();
+
+    // Log the losing score (the leaderboard and percentile ranks come from the store's running summary)
+    Scores.append(score);
+
     // Display losing screen with score and GIF
-    losingScreen(score);
+    losingScene.setScore(score);
+    return SCENE_LOSING;
 }
 
-/* FUNCTION: Allows for unbroken navigation of the main menu and its required screens.
+/* FUNCTION: Draws the main menu, which allows for unbroken navigation of the game's required screens.
     Author: Niko
     Arguments:
         NONE
     Returns:
         NONE                                                                          */
-void mainMenu() {
-    LCD.Clear(BLACK);
+void MenuScene::draw() {
+    Display.clear(BLACK);
 
     drawButtonWithText(70, 0, 250, 42, WHITE, "Play Game", WHITE);
     drawButtonWithText(70, 48, 250, 90, WHITE, "Instructions", WHITE);
@@ -993,31 +1461,46 @@ void mainMenu() {
     drawButtonWithText(70, 144, 250, 186, WHITE, "Leaderboard", WHITE);
 
     drawButtonWithText(120, 206, 200, 239, WHITE, "Quit", WHITE);
+}
 
-    LCD.Update();
-    
-    // Check for button presses and navigate accordingly
-    while (1) {
-        if (buttonPress(70, 0, 250, 42)) {
-            playGame();
-            break;
-        }
-        if (buttonPress(70, 48, 250, 90)) {
-            instructionsScreen();
-            break;
-        }
-        if (buttonPress(70, 96, 250, 138)) {
-            creditsScreen();
-            break;
-        }
-        if (buttonPress(70, 144, 250, 186)) {
-            leaderboardScreen();
-            break;
-        }
-        if (buttonPress(120, 206, 200, 239)) {
-            break;
-        }
+/* FUNCTION: Registers the main menu's buttons.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                     */
+void MenuScene::enter() {
+    playButton = Input.addButton(70, 0, 250, 42);
+    instructionsButton = Input.addButton(70, 48, 250, 90);
+    creditsButton = Input.addButton(70, 96, 250, 138);
+    leaderboardButton = Input.addButton(70, 144, 250, 186);
+    quitButton = Input.addButton(120, 206, 200, 239);
+}
 
-        Sleep(1);
+/* FUNCTION: Goes to the screen whose button was pressed.
+    Author: Niko
+    Arguments:
+        event - The touch event.
+    Returns:
+        The scene to go to, or SCENE_STAY.                 */
+int MenuScene::touch(const TouchEvent& event) {
+    if (event.type != TOUCH_PRESS) {
+        return SCENE_STAY;
+    }
+    if (event.button == playButton) {
+        return SCENE_BRIEFING;
+    }
+    if (event.button == instructionsButton) {
+        return SCENE_INSTRUCTIONS;
+    }
+    if (event.button == creditsButton) {
+        return SCENE_CREDITS;
+    }
+    if (event.button == leaderboardButton) {
+        return SCENE_LEADERBOARD;
+    }
+    if (event.button == quitButton) {
+        return SCENE_QUIT;
     }
+    return SCENE_STAY;
 }
\ No newline at end of file
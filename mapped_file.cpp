@@ -0,0 +1,103 @@
+#include "mapped_file.h"
+#include "image.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : bytes(NULL), length(0) {
+#ifdef _WIN32
+    fileHandle = NULL;
+    mappingHandle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+/* FUNCTION: Maps a file into memory read-only.
+    Author: Niko
+    Arguments:
+        path - Asset path of the file ('\\' separators are fine on every platform).
+    Returns:
+        true if the file is now mapped.                                            */
+bool MappedFile::open(const char* path) {
+    close();
+
+    char nativePath[512];
+    toNativePath(path, nativePath, sizeof(nativePath));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(nativePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = (const unsigned char*)view;
+    length = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(nativePath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);    // The mapping keeps its own reference to the file
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    bytes = (const unsigned char*)view;
+    length = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+/* FUNCTION: Unmaps the file, if one is mapped.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                     */
+void MappedFile::close() {
+    if (!bytes) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    fileHandle = NULL;
+    mappingHandle = NULL;
+#else
+    munmap((void*)bytes, length);
+#endif
+    bytes = NULL;
+    length = 0;
+}
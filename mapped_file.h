@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+/* CLASS: A read-only file mapped into memory (CreateFileMapping on Windows, mmap elsewhere).
+    Author: Niko
+    Members:
+        open(path) - Maps the whole file; returns false if it can't be opened or is empty.
+        close() - Unmaps the file (also done by the destructor).
+        data(), size() - The mapped bytes.
+    Notes:
+        Pages are only read from disk when they are first touched, so mapping a large file is cheap. */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char* path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != NULL; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const unsigned char* bytes;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
+
+#endif
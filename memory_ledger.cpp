@@ -0,0 +1,183 @@
+#include "memory_ledger.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+MemoryLedger Memory;
+
+thread_local int memoryTag = MEM_OTHER;
+
+static const char* const TAG_NAMES[MEM_TAGS] = {
+    "other", "images", "gif_frames", "animations", "cards", "layers", "dataset", "text", "scores"
+};
+
+/* CLASS: What comes before every block handed out by the ledger (16 bytes, so blocks stay aligned for any type).
+    Author: Niko                                                                                                   */
+struct alignas(16) BlockHeader {
+    size_t size;
+    int tag;
+};
+
+/* FUNCTION: Raises an atomic maximum.
+    Author: Niko
+    Arguments:
+        peak - The maximum.
+        value - A new value.
+    Returns:
+        NONE                                 */
+static void raisePeak(std::atomic<int64_t>* peak, int64_t value) {
+    int64_t seen = peak->load(std::memory_order_relaxed);
+    while (value > seen && !peak->compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+/* FUNCTION: Allocates a block and counts it under the calling thread's tag, warning if that takes the tag over budget.
+    Author: Niko
+    Arguments:
+        size - Bytes wanted.
+    Returns:
+        The block, or NULL if there is no memory left.                                                                  */
+void* MemoryLedger::allocate(size_t size) {
+    BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+    if (!header) {
+        return NULL;
+    }
+    int tag = memoryTag >= 0 && memoryTag < MEM_TAGS ? memoryTag : MEM_OTHER;
+    header->size = size;
+    header->tag = tag;
+
+    allocations[tag].fetch_add(1, std::memory_order_relaxed);
+    liveBlocks[tag].fetch_add(1, std::memory_order_relaxed);
+    int64_t live = liveBytes[tag].fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+    raisePeak(&peakBytes[tag], live);
+    raisePeak(&totalPeak, totalLive.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size);
+
+    // Only the allocation that crosses the budget warns (printf allocates with malloc, so this doesn't come back here)
+    int64_t budget = budgetBytes[tag].load(std::memory_order_relaxed);
+    if (budget > 0 && live > budget && live - (int64_t)size <= budget) {
+        printf("Warning: %s memory went over its budget: %.1f of %.1f MB\n", TAG_NAMES[tag], live / 1048576.0,
+               budget / 1048576.0);
+    }
+    return header + 1;
+}
+
+/* FUNCTION: Frees a block from allocate and takes it off the tag it was counted under.
+    Author: Niko
+    Arguments:
+        block - The block (NULL does nothing).
+    Returns:
+        NONE                                                                                */
+void MemoryLedger::release(void* block) {
+    if (!block) {
+        return;
+    }
+    BlockHeader* header = (BlockHeader*)block - 1;
+    liveBytes[header->tag].fetch_sub((int64_t)header->size, std::memory_order_relaxed);
+    liveBlocks[header->tag].fetch_sub(1, std::memory_order_relaxed);
+    totalLive.fetch_sub((int64_t)header->size, std::memory_order_relaxed);
+    free(header);
+}
+
+/* FUNCTION: Sets a tag's budget.
+    Author: Niko
+    Arguments:
+        tag - MEM_* tag.
+        bytes - The budget, or 0 for none.
+    Returns:
+        NONE                                */
+void MemoryLedger::setBudget(int tag, size_t bytes) {
+    if (tag >= 0 && tag < MEM_TAGS) {
+        budgetBytes[tag].store((int64_t)bytes, std::memory_order_relaxed);
+    }
+}
+
+/* FUNCTION: Looks a tag up by the name the report uses.
+    Author: Niko
+    Arguments:
+        name - e.g. "images".
+    Returns:
+        The MEM_* tag, or -1 if there is no such tag.       */
+int MemoryLedger::tagByName(const char* name) {
+    for (int tag = 0; tag < MEM_TAGS; tag++) {
+        if (strcmp(name, TAG_NAMES[tag]) == 0) {
+            return tag;
+        }
+    }
+    return -1;
+}
+
+const char* MemoryLedger::name(int tag) {
+    return tag >= 0 && tag < MEM_TAGS ? TAG_NAMES[tag] : "?";
+}
+
+/* FUNCTION: Prints the totals, then live and peak bytes, live blocks and budget per tag.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                */
+void MemoryLedger::printStats() const {
+    printf("Memory: %.1f MB live, %.1f MB at peak\n", totalLive.load(std::memory_order_relaxed) / 1048576.0,
+           totalPeak.load(std::memory_order_relaxed) / 1048576.0);
+    for (int tag = 0; tag < MEM_TAGS; tag++) {
+        int64_t budget = budgetBytes[tag].load(std::memory_order_relaxed);
+        printf("  %-11s %9.1f KB live %9.1f KB peak %8lu of %8lu blocks live", TAG_NAMES[tag],
+               liveBytes[tag].load(std::memory_order_relaxed) / 1024.0,
+               peakBytes[tag].load(std::memory_order_relaxed) / 1024.0,
+               (unsigned long)liveBlocks[tag].load(std::memory_order_relaxed),
+               (unsigned long)allocations[tag].load(std::memory_order_relaxed));
+        if (budget > 0) {
+            printf(", budget %.1f MB%s", budget / 1048576.0,
+                   peakBytes[tag].load(std::memory_order_relaxed) > budget ? " (exceeded)" : "");
+        }
+        printf("\n");
+    }
+}
+
+// The game's allocations all go through the ledger. Over-aligned types keep the library's own operators.
+
+void* operator new(size_t size) {
+    void* block = Memory.allocate(size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return Memory.allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return Memory.allocate(size);
+}
+
+void operator delete(void* block) noexcept {
+    Memory.release(block);
+}
+
+void operator delete[](void* block) noexcept {
+    Memory.release(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    Memory.release(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    Memory.release(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+    Memory.release(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+    Memory.release(block);
+}
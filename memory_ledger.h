@@ -0,0 +1,78 @@
+#ifndef MEMORY_LEDGER_H
+#define MEMORY_LEDGER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Memory tags (what the bytes are for) */
+#define MEM_OTHER 0             // Anything allocated outside a tagged scope
+#define MEM_IMAGES 1            // Decoded images in the image cache (screens, prompts, overlays)
+#define MEM_GIF_FRAMES 2        // Losing-screen GIF frames: warmed in the image cache, and the player's ring
+#define MEM_ANIMATIONS 3        // Answer animations: source frames in the image cache, key frames and deltas
+#define MEM_CARDS 4             // Rendered prompt cards
+#define MEM_LAYERS 5            // Overlay span layers
+#define MEM_DATASET 6           // The emissions dataset's arrays (a mapped data file isn't counted)
+#define MEM_TEXT 7              // Text layouts and glyph sprites
+#define MEM_SCORES 8            // The score store
+#define MEM_TAGS 9
+
+/* CLASS: Live and peak heap bytes per tag, with an optional budget per tag.
+    Author: Niko
+    Members:
+        allocate(size), release(block) - What the game's operator new and delete use (see memory_ledger.cpp); each
+            block carries its size and tag in a small header, so it is taken off the right tag wherever it is freed.
+        setBudget(tag, bytes) - Logs a warning each time the tag's live bytes go over the budget (0 for none).
+        live(tag), peak(tag) - Bytes allocated under a tag and not freed yet, now and at most.
+        tagByName(name), name(tag) - Between tags and the names the report and --memory-budget use.
+        printStats() - Prints live and peak bytes, live blocks and budget per tag, and the totals.
+    Notes:
+        Every allocation through new (containers included) is counted under the tag of the MEMORY_TAG scope it was
+        made in, on its own thread; the innermost scope wins. Budgets only log: refusing an allocation would crash the
+        game, and the point is to find out what a unit needs. The counters are updated with relaxed atomics, so peaks
+        taken while several threads allocate at once can be a little off.                                             */
+class MemoryLedger {
+public:
+    void* allocate(size_t size);
+    void release(void* block);
+
+    void setBudget(int tag, size_t bytes);
+    size_t live(int tag) const { return (size_t)liveBytes[tag].load(std::memory_order_relaxed); }
+    size_t peak(int tag) const { return (size_t)peakBytes[tag].load(std::memory_order_relaxed); }
+
+    static int tagByName(const char* name);
+    static const char* name(int tag);
+    void printStats() const;
+
+private:
+    // No constructor: the ledger is zeroed before anything runs, as allocations can come during static initialization
+    std::atomic<int64_t> liveBytes[MEM_TAGS];
+    std::atomic<int64_t> peakBytes[MEM_TAGS];
+    std::atomic<int64_t> budgetBytes[MEM_TAGS];
+    std::atomic<uint64_t> allocations[MEM_TAGS];
+    std::atomic<uint64_t> liveBlocks[MEM_TAGS];
+    std::atomic<int64_t> totalLive;
+    std::atomic<int64_t> totalPeak;
+};
+
+extern MemoryLedger Memory;
+
+// The tag new allocations on this thread are counted under
+extern thread_local int memoryTag;
+
+/* CLASS: Counts the allocations made until the end of its scope under one tag.
+    Author: Niko                                                                */
+class MemoryTag {
+public:
+    explicit MemoryTag(int tag) : previous(memoryTag) { memoryTag = tag; }
+    ~MemoryTag() { memoryTag = previous; }
+
+private:
+    int previous;
+};
+
+#define MEMORY_JOIN2(a, b) a##b
+#define MEMORY_JOIN(a, b) MEMORY_JOIN2(a, b)
+#define MEMORY_TAG(tag) MemoryTag MEMORY_JOIN(memoryTag, __LINE__)(tag)
+
+#endif
@@ -0,0 +1,259 @@
+#include "prefetcher.h"
+#include "card_cache.h"
+#include "image_cache.h"
+#include "trace.h"
+
+#include <chrono>
+#include <stdio.h>
+
+Prefetcher Prefetch;
+
+Prefetcher::Prefetcher()
+    : loading(NULL), generation(0), stopping(false), promptsRequested(0), promptsLoaded(0), promptsDropped(0),
+      promptsCancelled(0), animationsLoaded(0), claimWaits(0), busySeconds(0.0) {
+}
+
+Prefetcher::~Prefetcher() {
+    stop();
+}
+
+/* FUNCTION: Starts the loader thread if it isn't running. The caller holds the lock.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                        */
+void Prefetcher::start() {
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = std::thread(&Prefetcher::loadLoop, this);
+    }
+}
+
+/* FUNCTION: Queues an activity to be loaded ahead of the round that shows it.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+    Returns:
+        NONE                                                                  */
+void Prefetcher::requestPrompt(int index) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (queue[i].index == index) {
+                return;
+            }
+        }
+
+        // Full: the oldest prompt is the one least likely to still be wanted
+        if (queue.size() >= MAX_PREFETCH_JOBS) {
+            for (size_t i = 0; i < queue.size(); i++) {
+                if (queue[i].index >= 0) {
+                    queue.erase(queue.begin() + i);
+                    promptsDropped++;
+                    break;
+                }
+            }
+            if (queue.size() >= MAX_PREFETCH_JOBS) {
+                return;
+            }
+        }
+
+        Job job;
+        job.index = index;
+        job.animation = NULL;
+        job.first = job.last = 0;
+        queue.push_back(job);
+        promptsRequested++;
+        start();
+    }
+    wake.notify_one();
+}
+
+/* FUNCTION: Queues an answer animation to be built on the loader thread. Nothing happens if it is already queued or
+             being built; the loader skips it if it turns out to be loaded already.
+    Author: Niko
+    Arguments:
+        animation - The animation (hands it to the loader until claim()).
+        folder, first, last - What to build it from (see DeltaAnimation::load).
+    Returns:
+        NONE                                                                                                          */
+void Prefetcher::requestAnimation(DeltaAnimation* animation, const char* folder, int first, int last) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (loading == animation) {
+            return;
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (queue[i].animation == animation) {
+                return;
+            }
+        }
+        if (queue.size() >= MAX_PREFETCH_JOBS) {
+            return;
+        }
+
+        Job job;
+        job.index = -1;
+        job.animation = animation;
+        job.folder = folder;
+        job.first = first;
+        job.last = last;
+        queue.push_back(job);
+        start();
+    }
+    wake.notify_one();
+}
+
+/* FUNCTION: Takes an animation back from the loader: withdraws it if it hasn't been started, or waits until it is
+             built. Either way the caller may use it afterwards (and load it itself if it still isn't loaded).
+    Author: Niko
+    Arguments:
+        animation - The animation.
+    Returns:
+        NONE                                                                                                         */
+void Prefetcher::claim(DeltaAnimation* animation) {
+    std::unique_lock<std::mutex> guard(lock);
+    for (size_t i = 0; i < queue.size(); i++) {
+        if (queue[i].animation == animation) {
+            queue.erase(queue.begin() + i);
+            break;
+        }
+    }
+    if (loading == animation) {
+        claimWaits++;
+        done.wait(guard, [&] { return loading != animation; });
+    }
+}
+
+/* FUNCTION: Drops every queued prompt and abandons the one being loaded at its next step (queued animations stay).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                                      */
+void Prefetcher::cancel() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < queue.size();) {
+        if (queue[i].index >= 0) {
+            queue.erase(queue.begin() + i);
+            promptsCancelled++;
+        } else {
+            i++;
+        }
+    }
+    generation++;
+}
+
+/* FUNCTION: Cancels every job and joins the loader thread.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                */
+void Prefetcher::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+        queue.clear();
+        generation++;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+/* FUNCTION: Loader thread body: runs queued jobs in order until stopped.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                              */
+void Prefetcher::loadLoop() {
+    Trace.nameThread("loader");
+    while (true) {
+        Job job;
+        unsigned long started;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = queue.front();
+            queue.pop_front();
+            started = generation;
+            loading = job.animation;
+        }
+
+        auto began = std::chrono::steady_clock::now();
+        bool built = false;
+        if (job.animation) {
+            // Already built if the startup warm-up got to it (see warmup.h)
+            if (!job.animation->isLoaded()) {
+                built = job.animation->load(job.folder.c_str(), job.first, job.last);
+            }
+        } else {
+            loadPrompt(job.index, started);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            busySeconds += seconds;
+            if (job.animation) {
+                animationsLoaded += built ? 1 : 0;
+                loading = NULL;
+            }
+        }
+        done.notify_all();
+    }
+}
+
+/* FUNCTION: Loads an activity's image, then renders the cards it is drawn as next: sliding in on the right, revealed
+             on the right, and revealed on the left once the round after moves it over. Checks for cancellation between
+             steps, since each can take a few milliseconds.
+    Author: Niko
+    Arguments:
+        index - Index of the activity.
+        started - The generation the job was started under.
+    Returns:
+        NONE                                                                                                            */
+void Prefetcher::loadPrompt(int index, unsigned long started) {
+    static const int layouts[3] = {CARD_RIGHT, CARD_RIGHT | CARD_VALUE, CARD_LEFT | CARD_VALUE};
+
+    char filename[30];
+    sprintf(filename, "emissions_images\\%d.png", index);
+    bool ok = (bool)Images.get(filename);
+
+    for (int i = 0; ok && i <= 3; i++) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (generation != started) {
+                promptsCancelled++;
+                return;
+            }
+            if (i == 3) {
+                promptsLoaded++;
+                return;
+            }
+        }
+        ok = Cards.prefetch(index, layouts[i]);
+    }
+}
+
+/* FUNCTION: Prints job counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                        */
+void Prefetcher::printStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    printf("Prefetch: %lu prompts requested, %lu loaded, %lu cancelled, %lu dropped, %lu animations built "
+           "(%lu waited for), %.1f ms of loading off the main thread\n",
+           promptsRequested, promptsLoaded, promptsCancelled, promptsDropped, animationsLoaded, claimWaits,
+           busySeconds * 1000.0);
+}
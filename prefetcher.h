@@ -0,0 +1,74 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include "delta_animation.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define MAX_PREFETCH_JOBS 8     // Jobs waiting for the loader thread; the oldest prompt is dropped to make room
+
+/* CLASS: Loader thread that gets upcoming assets ready while the player is still looking at the current round: a
+          prompt's image and the cards it will be drawn as (see card_cache.h), or an answer animation's frames.
+    Author: Niko
+    Members:
+        requestPrompt(index) - Queues an activity's image and its right, revealed and left cards.
+        requestAnimation(animation, folder, first, last) - Queues building an answer animation (see delta_animation.h),
+            unless it is already queued or being built.
+        claim(animation) - Takes an animation back before playing it: withdraws it if it is still queued, or waits
+            for the loader to finish it.
+        cancel() - Drops every queued prompt and abandons the one being loaded between steps.
+        stop() - Cancels everything and joins the thread (also done on destruction).
+        printStats() - Prints job counters.
+    Notes:
+        The thread starts on the first request. Prompts only go through the (locked) image and card caches, so the game
+        never has to wait for one: whatever isn't ready yet is simply loaded when it is drawn, as before. An animation
+        belongs to the loader from requestAnimation until claim returns, so it must not be touched in between.         */
+class Prefetcher {
+public:
+    Prefetcher();
+    ~Prefetcher();
+
+    void requestPrompt(int index);
+    void requestAnimation(DeltaAnimation* animation, const char* folder, int first, int last);
+    void claim(DeltaAnimation* animation);
+    void cancel();
+    void stop();
+    void printStats() const;
+
+private:
+    struct Job {
+        int index;                      // Activity to load, or -1 for an animation
+        DeltaAnimation* animation;
+        std::string folder;
+        int first, last;
+    };
+
+    void start();
+    void loadLoop();
+    void loadPrompt(int index, unsigned long generation);
+
+    std::thread worker;
+    mutable std::mutex lock;
+    std::condition_variable wake;       // Signals new jobs (and stopping) to the loader
+    std::condition_variable done;       // Signals a finished job to claim()
+    std::deque<Job> queue;
+    DeltaAnimation* loading;            // Animation the loader is building, or NULL
+    unsigned long generation;           // Bumped by cancel(); a prompt started under an older one is abandoned
+    bool stopping;
+
+    unsigned long promptsRequested;
+    unsigned long promptsLoaded;
+    unsigned long promptsDropped;       // Pushed out of a full queue
+    unsigned long promptsCancelled;
+    unsigned long animationsLoaded;
+    unsigned long claimWaits;           // Times an animation was still being built when it was needed
+    double busySeconds;
+};
+
+extern Prefetcher Prefetch;
+
+#endif
@@ -0,0 +1,363 @@
+#include "replay.h"
+#include "scene.h"
+#include "timeline.h"
+
+#include <algorithm>
+
+TouchRecorder Recorder;
+TouchReplayer Replayer;
+
+TouchRecorder::TouchRecorder()
+    : inner(NULL), file(NULL), startTime(0.0), lastDown(false), lastX(0.0f), lastY(0.0f), touches(0), entries(0) {
+}
+
+TouchRecorder::~TouchRecorder() {
+    stop();
+}
+
+/* FUNCTION: Creates a recording and starts recording into it.
+    Author: Niko
+    Arguments:
+        path - Native path of the recording.
+        inner - The backend to record on (everything goes through to it).
+    Returns:
+        false if the file can't be created.                                                  */
+bool TouchRecorder::start(const char* path, Backend* inner) {
+    stop();
+    file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    this->inner = inner;
+    unsigned int seed = (unsigned int)inner->randInt();
+    random.seed(seed);
+    startTime = inner->now();
+    lastDown = false;
+    lastX = lastY = 0.0f;
+    touches = 0;
+    entries = 0;
+
+    fprintf(file, "# Touch recording (play back with --replay)\n");
+    fprintf(file, "seed %u\n", seed);
+    fflush(file);
+    return true;
+}
+
+/* FUNCTION: Closes the recording.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                          */
+void TouchRecorder::stop() {
+    if (file) {
+        fclose(file);
+        file = NULL;
+        printf("Recorded %lu touch changes and %lu entries in all over %.1f s\n", touches, entries,
+               inner->now() - startTime);
+    }
+}
+
+/* FUNCTION: Samples the inner backend's touchscreen and writes the sample down (in full only if it changed).
+    Author: Niko
+    Arguments:
+        x, y - Receive the touch position.
+    Returns:
+        Whether the screen is pressed.                                                                      */
+bool TouchRecorder::touch(float* x, float* y) {
+    bool down = inner->touch(x, y);
+    if (!file) {
+        return down;
+    }
+
+    if (down != lastDown || (down && (*x != lastX || *y != lastY))) {
+        if (down) {
+            lastX = *x;
+            lastY = *y;
+        }
+        lastDown = down;
+        fprintf(file, "t %d %.9g %.9g\n", down ? 1 : 0, lastX, lastY);
+        fflush(file);
+        touches++;
+    } else {
+        fprintf(file, "t\n");
+    }
+    entries++;
+    return down;
+}
+
+/* FUNCTION: Reads the inner backend's clock and writes the reading down.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        The time in seconds.                                 */
+double TouchRecorder::now() {
+    double time = inner->now();
+    if (file) {
+        fprintf(file, "c %.17g\n", time);
+        entries++;
+    }
+    return time;
+}
+
+int TouchRecorder::randInt() {
+    return (int)(random() & 0x7FFFFFFF);
+}
+
+/* FUNCTION: Adds a frame's time under its screen and animation.
+    Author: Niko
+    Arguments:
+        screen, animation - Names (NULL for none).
+        seconds - The frame's time.
+    Returns:
+        NONE                                                    */
+void FrameTimes::add(const char* screen, const char* animation, double seconds) {
+    if (screen) {
+        screens[screen].push_back(seconds);
+    }
+    if (animation) {
+        animations[animation].push_back(seconds);
+    }
+}
+
+/* FUNCTION: Writes a string as a JSON string literal.
+    Author: Niko
+    Arguments:
+        file - Where to write.
+        text - The string.
+    Returns:
+        NONE                                                */
+static void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+/* FUNCTION: Writes one group of frame times as a JSON object: per name, the frame count and the total, mean,
+             median, 95th and 99th percentile and worst frame time in ms.
+    Author: Niko
+    Arguments:
+        file - Where to write.
+        group - Frame times by name.
+    Returns:
+        NONE                                                                                                   */
+void FrameTimes::writeGroup(FILE* file, const std::map<std::string, std::vector<double>>& group) {
+    fprintf(file, "{");
+    for (auto it = group.begin(); it != group.end(); ++it) {
+        std::vector<double> times = it->second;
+        std::sort(times.begin(), times.end());
+        double total = 0.0;
+        for (size_t i = 0; i < times.size(); i++) {
+            total += times[i];
+        }
+        size_t n = times.size();
+
+        fprintf(file, "%s\n    ", it == group.begin() ? "" : ",");
+        writeJsonString(file, it->first.c_str());
+        fprintf(file, ": {\"frames\": %zu, \"total_ms\": %.3f, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, "
+                      "\"p99_ms\": %.3f, \"max_ms\": %.3f}",
+                n, total * 1000.0, total * 1000.0 / n, times[n / 2] * 1000.0, times[n * 95 / 100] * 1000.0,
+                times[n * 99 / 100] * 1000.0, times[n - 1] * 1000.0);
+    }
+    fprintf(file, "%s}", group.empty() ? "" : "\n  ");
+}
+
+/* FUNCTION: Writes the screens and animations groups (the caller writes the enclosing object).
+    Author: Niko
+    Arguments:
+        file - Where to write.
+    Returns:
+        NONE                                                                                     */
+void FrameTimes::writeJson(FILE* file) const {
+    fprintf(file, "  \"screens\": ");
+    writeGroup(file, screens);
+    fprintf(file, ",\n  \"animations\": ");
+    writeGroup(file, animations);
+    fprintf(file, "\n");
+}
+
+TouchReplayer::TouchReplayer()
+    : inner(NULL), fast(false), seed(0), next(0), firstTime(0.0), lastTime(0.0), sleptSinceRead(0.0), touchSamples(0),
+      extraReads(0), skippedReads(0), lastFrameReal(0.0), waitedSinceFrame(0.0), frames(0) {
+}
+
+/* FUNCTION: Loads a recording and starts playing it back.
+    Author: Niko
+    Arguments:
+        path - Native path of the recording.
+        inner - The backend to draw on.
+        fast - Whether to run as fast as possible instead of in real time.
+    Returns:
+        false if the recording can't be read or has no seed.               */
+bool TouchReplayer::start(const char* path, Backend* inner, bool fast) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    bool seeded = false;
+    bool clocked = false;
+    ReplayEntry entry = {false, 0.0, false, 0.0f, 0.0f};
+    entries.clear();
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        int down;
+        if (sscanf(line, "seed %u", &seed) == 1) {
+            seeded = true;
+        } else if (sscanf(line, "c %lf", &entry.time) == 1) {
+            entry.touch = false;
+            entries.push_back(entry);
+            if (!clocked) {
+                firstTime = entry.time;
+                clocked = true;
+            }
+        } else if (line[0] == 't') {
+            // A bare "t" repeats the sample before
+            if (sscanf(line, "t %d %f %f", &down, &entry.x, &entry.y) == 3) {
+                entry.down = down != 0;
+            }
+            entry.touch = true;
+            entries.push_back(entry);
+        }
+    }
+    fclose(file);
+    if (!seeded) {
+        return false;
+    }
+
+    this->inner = inner;
+    this->path = path;
+    this->fast = fast;
+    random.seed(seed);
+    next = 0;
+    lastTime = firstTime;
+    sleptSinceRead = 0.0;
+    touchSamples = 0;
+    extraReads = 0;
+    skippedReads = 0;
+    realStart = std::chrono::steady_clock::now();
+    lastFrameReal = 0.0;
+    waitedSinceFrame = 0.0;
+    frames = 0;
+    return true;
+}
+
+double TouchReplayer::realNow() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+}
+
+/* FUNCTION: Hands out the next recorded clock read. In real-time mode, first waits until as long has passed since
+             the start of the replay as had since the start of the recording.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        The time in seconds.                                                                                        */
+double TouchReplayer::now() {
+    if (next < entries.size() && !entries[next].touch) {
+        lastTime = entries[next++].time;
+    } else {
+        // The recording has a touch sample (or nothing) next, so the game is reading the clock more often than it did
+        lastTime += sleptSinceRead;
+        extraReads++;
+    }
+    sleptSinceRead = 0.0;
+
+    if (!fast) {
+        double before = realNow();
+        double wait = (lastTime - firstTime) - before;
+        if (wait > 0) {
+            inner->sleep(wait);
+            waitedSinceFrame += realNow() - before;
+        }
+    }
+    return lastTime;
+}
+
+/* FUNCTION: Notes a sleep without waiting (the time a sleep took is in the recorded clock reads).
+    Author: Niko
+    Arguments:
+        seconds - How long.
+    Returns:
+        NONE                                                                                       */
+void TouchReplayer::sleep(double seconds) {
+    sleptSinceRead += seconds > 0 ? seconds : 0.0;
+}
+
+/* FUNCTION: Shows the frame on the inner backend and notes how long the game spent on it.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                                                */
+void TouchReplayer::present() {
+    inner->present();
+    double real = realNow();
+    frameTimes.add(Scenes.currentName(), Animations.playing(), real - lastFrameReal - waitedSinceFrame);
+    lastFrameReal = real;
+    waitedSinceFrame = 0.0;
+    frames++;
+}
+
+/* FUNCTION: Hands out the next recorded touch sample, skipping any clock reads the game didn't make before it.
+    Author: Niko
+    Arguments:
+        x, y - Receive the touch position.
+    Returns:
+        Whether the screen was pressed (false once the recording has run out).                               */
+bool TouchReplayer::touch(float* x, float* y) {
+    while (next < entries.size() && !entries[next].touch) {
+        next++;
+        skippedReads++;
+    }
+    if (next >= entries.size()) {
+        return false;
+    }
+    const ReplayEntry& entry = entries[next++];
+    *x = entry.x;
+    *y = entry.y;
+    touchSamples++;
+    return entry.down;
+}
+
+int TouchReplayer::randInt() {
+    return (int)(random() & 0x7FFFFFFF);
+}
+
+bool TouchReplayer::finished() {
+    return next >= entries.size();
+}
+
+/* FUNCTION: Writes the replay's JSON report.
+    Author: Niko
+    Arguments:
+        path - Native path of the report.
+    Returns:
+        false if the file can't be written.     */
+bool TouchReplayer::writeReport(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"recording\": ");
+    writeJsonString(file, this->path.c_str());
+    fprintf(file, ",\n  \"mode\": \"%s\",\n  \"backend\": ", fast ? "fast" : "realtime");
+    writeJsonString(file, inner ? inner->name() : "");
+    fprintf(file, ",\n  \"seed\": %u,\n  \"touch_samples\": %lu,\n  \"extra_clock_reads\": %lu,\n"
+                  "  \"skipped_clock_reads\": %lu,\n  \"frames\": %lu,\n  \"session_seconds\": %.3f,\n"
+                  "  \"real_seconds\": %.3f,\n",
+            seed, touchSamples, extraReads, skippedReads, frames, lastTime - firstTime, realNow());
+    frameTimes.writeJson(file);
+    fprintf(file, "}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,152 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "backend.h"
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define REPLAY_REPORT_FILE "replay_report.json"  // Default --report path
+
+/* Recording file format (text), in the order the game asked:
+       # comments
+       seed <n>                 Seed of the game's random numbers
+       c <t>                    A clock read, in the backend's seconds (written exactly, with 17 digits)
+       t <down> <x> <y>         A touch sample that differed from the one before: 1 if pressed, and the position
+       t                        A touch sample the same as the one before
+   A touch sample's time is the clock read that follows it. */
+
+/* CLASS: One entry of a recording: a clock read or a touch sample.
+    Author: Niko
+    Members:
+        touch - Whether this is a touch sample (otherwise a clock read).
+        time - The clock read.
+        down, x, y - The touch sample.                                      */
+struct ReplayEntry {
+    bool touch;
+    double time;
+    bool down;
+    float x, y;
+};
+
+/* CLASS: Backend wrapper that records a session: every touch sample and clock read the game takes, in order, plus the
+          seed of the random numbers, which it hands out itself so the session can be played again exactly.
+    Author: Niko
+    Members:
+        start(path, inner) - Creates the recording; everything else is passed on to inner.
+        stop() - Closes the recording.
+    Notes:
+        Install it (Device = &Recorder) right before the title screen, so a recording covers everything from there on.
+        Touch times alone aren't enough: the game reads the clock to pace animations and poll for input, and those
+        reads come out differently every run (drawing and sleeping never take quite the same time), so touches would
+        land a little earlier or later each time. The recording is flushed on every touch change, so a session cut
+        short still replays up to that point.                                                                      */
+class TouchRecorder : public Backend {
+public:
+    TouchRecorder();
+    ~TouchRecorder();
+
+    bool start(const char* path, Backend* inner);
+    void stop();
+
+    const char* name() const { return inner->name(); }
+    void drawRun(int y, int x1, int x2, uint32_t color) { inner->drawRun(y, x1, x2, color); }
+    void present() { inner->present(); }
+    bool touch(float* x, float* y);
+    double now();
+    void sleep(double seconds) { inner->sleep(seconds); }
+    int randInt();
+
+private:
+    Backend* inner;
+    FILE* file;
+    std::mt19937 random;
+    double startTime;
+    bool lastDown;
+    float lastX, lastY;
+    unsigned long touches;      // Touch samples written out in full (the changes)
+    unsigned long entries;
+};
+
+/* CLASS: Frame times of a run, put down to the screen and the animation they were drawn for.
+    Author: Niko
+    Members:
+        add(screen, animation, seconds) - Adds a frame (either name may be NULL).
+        writeJson(file) - Writes "screens" and "animations" objects with per-name frame counts and times.
+    Notes:
+        A frame's time is the wall-clock time the game spent on it: from the previous frame to this one, minus any
+        time spent waiting. That makes it comparable between real-time and as-fast-as-possible replays.          */
+class FrameTimes {
+public:
+    void add(const char* screen, const char* animation, double seconds);
+    void writeJson(FILE* file) const;
+
+private:
+    static void writeGroup(FILE* file, const std::map<std::string, std::vector<double>>& group);
+
+    std::map<std::string, std::vector<double>> screens;
+    std::map<std::string, std::vector<double>> animations;
+};
+
+/* CLASS: Backend wrapper that plays a recording back: touches and random numbers come from the recording, drawing
+          goes to the inner backend (usually the headless one), and frame times are collected for a report.
+    Author: Niko
+    Members:
+        start(path, inner, fast) - Loads a recording and starts playing it, in real time or as fast as possible.
+        writeReport(path) - Writes the JSON report: run summary plus per-screen and per-animation frame times.
+        finished() - True once the recording has run out.
+    Notes:
+        Install it (Device = &Replayer) at the same point the recording was started. The game gets the recorded touch
+        samples, clock reads and random numbers back in order, so every replay plays the same game, animation frame
+        skips included. Real-time mode waits for each clock read's moment to come round; fast mode doesn't wait at
+        all. If the game reads the clock more or less often than it did (a GIF frame that was or wasn't decoded in
+        time), the replay catches up at the next touch sample: extra reads only add up the sleeps since the last one. */
+class TouchReplayer : public Backend {
+public:
+    TouchReplayer();
+
+    bool start(const char* path, Backend* inner, bool fast);
+    bool writeReport(const char* path) const;
+
+    const char* name() const { return inner->name(); }
+    void drawRun(int y, int x1, int x2, uint32_t color) { inner->drawRun(y, x1, x2, color); }
+    void present();
+    bool touch(float* x, float* y);
+    double now();
+    void sleep(double seconds);
+    int randInt();
+    bool finished();
+    bool realTime() const { return !fast; }
+
+private:
+    double realNow() const;
+
+    Backend* inner;
+    std::string path;
+    bool fast;
+    unsigned int seed;
+    std::mt19937 random;
+    std::vector<ReplayEntry> entries;
+    size_t next;                        // First entry not yet handed out
+    double firstTime;                   // The recording's first clock read
+    double lastTime;                    // The clock read handed out last
+    double sleptSinceRead;              // Seconds the game slept since then
+    unsigned long touchSamples;
+    unsigned long extraReads;           // Clock reads the recording didn't have
+    unsigned long skippedReads;         // Recorded clock reads the game didn't make
+
+    std::chrono::steady_clock::time_point realStart;
+    double lastFrameReal;               // Real seconds since the start at the end of the last frame
+    double waitedSinceFrame;            // Real seconds spent waiting since then (sleeping or pacing)
+    FrameTimes frameTimes;
+    unsigned long frames;
+};
+
+extern TouchRecorder Recorder;
+extern TouchReplayer Replayer;
+
+#endif
@@ -0,0 +1,40 @@
+#include "rounds.h"
+#include "backend.h"
+
+/* FUNCTION: Generates TWO distinct random integers between 0 and max (inclusive), ensuring the two integers are not equal.
+    Author: Niko
+    Arguments:
+        max - The maximum value for the random integers, inclusive.
+        index1 - A reference to an integer that will store the first distinct random index.
+        index2 - A reference to an integer that will store the second distinct random index, ensuring it's different from index1.
+    Returns:
+        NONE                                                                                                                            */
+void getDistinctInts(int max, int* index1, int* index2) {
+    *index1 = Device->randInt() % (max);
+    do {
+        *index2 = Device->randInt() % (max);
+    } while (*index2 == *index1);
+}
+
+/* FUNCTION: Generates ONE random integer between 0 and max (inclusive), ensuring it is different from the previously selected index.
+    Author: Niko
+    Arguments:
+        max - The maximum value for the random integer, exclusive. The function will generate a random integer in the range [0, max].
+        currentIndex - The index of the "winning" value (the current value to compare against).
+        newIndex - A reference to an integer that will store the new distinct random index, ensuring it's different from currentIndex.
+    Returns:
+        NONE                                                                                                                            */
+void getDistinctIntForNextRound(int max, int currentIndex, int* newIndex) {
+    int attempts = 0;
+    const int MAX_ATTEMPTS = 10;  // Max attempts to generate a distinct value randomly
+
+    do {
+        *newIndex = Device->randInt() % max;
+        attempts++;
+    } while (*newIndex == currentIndex && attempts < MAX_ATTEMPTS);
+
+    // If after multiple attempts we still get currentIndex, adjust manually
+    if (*newIndex == currentIndex) {
+        *newIndex = (currentIndex + 1) % max;
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef ROUNDS_H
+#define ROUNDS_H
+
+/* Picking the prompts for each round of the game. The random numbers come from Device (see backend.h), so replays
+   and benchmarks pick the same prompts every time. */
+
+void getDistinctInts(int max, int* index1, int* index2);
+void getDistinctIntForNextRound(int max, int currentIndex, int* newIndex);
+
+#endif
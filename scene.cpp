@@ -0,0 +1,101 @@
+#include "scene.h"
+#include "display.h"
+#include "trace.h"
+
+#include "backend.h"
+
+#include <stdio.h>
+
+SceneManager Scenes;
+
+SceneManager::SceneManager() : current(-1), transitions(0), iterations(0) {
+    for (int i = 0; i < MAX_SCENES; i++) {
+        scenes[i] = NULL;
+        names[i] = NULL;
+    }
+}
+
+/* FUNCTION: Registers a scene under an id.
+    Author: Niko
+    Arguments:
+        id - Id other scenes use to transition to this one (0 to MAX_SCENES - 1).
+        scene - The scene (must outlive the main loop).
+        name - Short name for reports (e.g. "title").
+    Returns:
+        NONE                                                                       */
+void SceneManager::add(int id, Scene* scene, const char* name) {
+    if (id >= 0 && id < MAX_SCENES) {
+        scenes[id] = scene;
+        names[id] = name;
+    }
+}
+
+/* FUNCTION: Runs the main loop: draw the current scene if it asked to be redrawn, sleep until there is input or
+             the scene wants a tick, hand it the input and the tick, then follow whatever transition it returns.
+    Author: Niko
+    Arguments:
+        first - Id of the scene to start with.
+    Returns:
+        NONE (returns when a scene returns SCENE_QUIT or an unknown id, or when the backend has finished)        */
+void SceneManager::run(int first) {
+    if (first < 0 || first >= MAX_SCENES || !scenes[first]) {
+        return;
+    }
+
+    Scene* scene = scenes[first];
+    current = first;
+    Input.clearButtons();
+    scene->redraw();
+    scene->enter();
+
+    while (true) {
+        iterations++;
+
+        if (scene->needsRedraw()) {
+            scene->drawn();
+            {
+                TRACE_SCOPE("draw");
+                scene->draw();
+            }
+            Display.update();
+        }
+
+        int next = SCENE_STAY;
+        TouchEvent event;
+        if (Input.waitEvent(&event, scene->wakeTime(Device->now()))) {
+            next = scene->touch(event);
+        }
+        if (next == SCENE_STAY) {
+            next = scene->tick(Device->now());
+        }
+        if (next == SCENE_STAY && Device->finished()) {
+            next = SCENE_QUIT;
+        }
+        if (next == SCENE_STAY) {
+            continue;
+        }
+
+        scene->exit();
+        if (next < 0 || next >= MAX_SCENES || !scenes[next]) {
+            current = -1;
+            return;
+        }
+
+        transitions++;
+        current = next;
+        scene = scenes[next];
+        Input.clearButtons();
+        scene->redraw();
+        scene->enter();
+    }
+}
+
+/* FUNCTION: Prints main loop counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                         */
+void SceneManager::printStats() const {
+    printf("Scenes: %lu transitions, %lu loop iterations\n", transitions, iterations);
+}
@@ -0,0 +1,74 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "input.h"
+
+#include <stddef.h>
+
+#define MAX_SCENES 16           // Scene ids run from 0 to MAX_SCENES - 1
+
+/* Special transitions a scene can return instead of another scene's id */
+#define SCENE_STAY -1           // Keep running the current scene
+#define SCENE_QUIT -2           // Leave the main loop
+
+/* CLASS: One screen of the game, driven by the scene manager's main loop.
+    Author: Niko
+    Members:
+        enter() - Called each time the scene becomes current (register buttons and reset state here).
+        exit() - Called when the scene is left.
+        touch(event) - Handles one touch event; returns a transition.
+        tick(now) - Called every time round the loop; returns a transition.
+        wakeTime(now) - Seconds until the scene next needs a tick with no input, or < 0 to wait for input only.
+        draw() - Draws the whole scene to the display layer. Only called after redraw().
+        redraw() - Asks for draw() to be called before the loop next waits.
+    Notes:
+        A transition is another scene's id, SCENE_STAY or SCENE_QUIT. Scenes never call each other, so the stack
+        is the same depth however many screens have been visited.                                                */
+class Scene {
+public:
+    Scene() : dirty(true) {}
+    virtual ~Scene() {}
+
+    virtual void enter() {}
+    virtual void exit() {}
+    virtual int touch(const TouchEvent& event) { return SCENE_STAY; }
+    virtual int tick(double now) { return SCENE_STAY; }
+    virtual double wakeTime(double now) { return -1.0; }
+    virtual void draw() = 0;
+
+    void redraw() { dirty = true; }
+    bool needsRedraw() const { return dirty; }
+    void drawn() { dirty = false; }
+
+private:
+    bool dirty;
+};
+
+/* CLASS: Owns the flat main loop that runs the current scene and switches between scenes.
+    Author: Niko
+    Members:
+        add(id, scene, name) - Registers a scene under an id, with a name for reports.
+        run(first) - Runs scenes, starting with first, until one returns SCENE_QUIT (or the backend has finished, see
+            backend.h).
+        currentName() - Name of the scene being run, or NULL outside the main loop.
+        printStats() - Prints loop counters.                                                  */
+class SceneManager {
+public:
+    SceneManager();
+
+    void add(int id, Scene* scene, const char* name);
+    void run(int first);
+    const char* currentName() const { return current >= 0 ? names[current] : NULL; }
+    void printStats() const;
+
+private:
+    Scene* scenes[MAX_SCENES];
+    const char* names[MAX_SCENES];
+    int current;            // Id of the scene being run, or -1
+    unsigned long transitions;
+    unsigned long iterations;
+};
+
+extern SceneManager Scenes;
+
+#endif
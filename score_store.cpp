@@ -0,0 +1,379 @@
+#include "score_store.h"
+#include "memory_ledger.h"
+
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+ScoreStore Scores;
+
+ScoreStore::ScoreStore() : pending(0), compactions(0) {
+    memset(&summary, 0, sizeof(summary));
+    logPath[0] = '\0';
+    summaryPath[0] = '\0';
+}
+
+/* FUNCTION: Checks whether a file exists.
+    Author: Reagan
+    Arguments:
+        path - The file.
+    Returns:
+        true if it can be opened for reading. */
+static bool fileExists(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+/* FUNCTION: Moves a file over another in one step, so there is never a moment when neither exists.
+    Author: Reagan
+    Arguments:
+        from - The file to move.
+        to - Where it goes (replaced if it exists).
+    Returns:
+        true on success.                                                                              */
+static bool replaceFile(const char* from, const char* to) {
+#ifdef _WIN32
+    // rename() won't replace an existing file on Windows, and removing it first would leave a gap
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+/* FUNCTION: Loads the summary and replays the games logged since it was written. The first time the store is
+             opened on a device, the old losing_scores.txt is imported so no scores are lost, and a summary left under
+             its temporary name by a compaction that was cut short is picked up from there.
+    Author: Reagan
+    Arguments:
+        logPath - Path of the append log.
+        summaryPath - Path of the compacted summary.
+    Returns:
+        true if the store is ready to append to.                                                                   */
+bool ScoreStore::open(const char* logPath, const char* summaryPath) {
+    MEMORY_TAG(MEM_SCORES);
+    snprintf(this->logPath, sizeof(this->logPath), "%s", logPath);
+    snprintf(this->summaryPath, sizeof(this->summaryPath), "%s", summaryPath);
+
+    memset(&summary, 0, sizeof(summary));
+    memcpy(summary.magic, SCORE_SUMMARY_MAGIC, 4);
+    summary.version = SCORE_STORE_VERSION;
+    pending = 0;
+
+    char tempPath[270];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", summaryPath);
+    bool haveSummary = readSummary(summaryPath);
+    if (!haveSummary && !fileExists(summaryPath) && readSummary(tempPath)) {
+        // A compaction was cut short before its summary was moved into place; the log it replaced is now stale
+        printf("Recovered %s from %s\n", summaryPath, tempPath);
+        haveSummary = true;
+        replaceFile(tempPath, summaryPath);
+    }
+    int replayed = replayLog();
+
+    if (replayed == -1 && !haveSummary) {
+        // First run with the store: bring over the old text file's scores
+        int imported = importLegacy(SCORE_LEGACY_FILE);
+        if (imported > 0) {
+            printf("Imported %d scores from %s\n", imported, SCORE_LEGACY_FILE);
+        }
+        return compact();
+    }
+    if (replayed == -3) {
+        // The log ends in a half-written record; fold in what was read and start a clean log
+        return compact();
+    }
+    if (replayed < 0) {
+        return resetLog();
+    }
+    return true;
+}
+
+/* FUNCTION: Starts a new store (replacing any at these paths) with a number of made-up games in it, scored the way
+             real ones tend to be: each answer is right 70% of the time, so most games end in single figures.
+    Author: Reagan
+    Arguments:
+        logPath - Path of the append log.
+        summaryPath - Path of the compacted summary.
+        games - How many games to log.
+        seed - Seed for the made-up scores.
+    Returns:
+        true if the store was written.                                                                             */
+bool ScoreStore::create(const char* logPath, const char* summaryPath, unsigned long games, unsigned int seed) {
+    MEMORY_TAG(MEM_SCORES);
+    snprintf(this->logPath, sizeof(this->logPath), "%s", logPath);
+    snprintf(this->summaryPath, sizeof(this->summaryPath), "%s", summaryPath);
+
+    memset(&summary, 0, sizeof(summary));
+    memcpy(summary.magic, SCORE_SUMMARY_MAGIC, 4);
+    summary.version = SCORE_STORE_VERSION;
+    pending = 0;
+
+    std::mt19937 random(seed);
+    for (unsigned long i = 0; i < games; i++) {
+        int score = 0;
+        while (random() % 10 < 7) {
+            score++;
+        }
+        add(score);
+    }
+    return compact();
+}
+
+/* FUNCTION: Reads a summary file.
+    Author: Reagan
+    Arguments:
+        path - The summary, or a compaction's temporary copy of it.
+    Returns:
+        true if a valid summary was read (otherwise the in-memory summary is left empty). */
+bool ScoreStore::readSummary(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    ScoreSummary loaded;
+    bool valid = fread(&loaded, sizeof(loaded), 1, file) == 1 &&
+                 memcmp(loaded.magic, SCORE_SUMMARY_MAGIC, 4) == 0 &&
+                 loaded.version == SCORE_STORE_VERSION &&
+                 loaded.topCount <= SCORE_TOP_K;
+    fclose(file);
+
+    if (!valid) {
+        printf("Error: %s is damaged, starting a new summary\n", path);
+        return false;
+    }
+    summary = loaded;
+    return true;
+}
+
+/* FUNCTION: Replays the log's records into the summary, if the log belongs to the summary's generation.
+             A log from an older generation was already folded in by a compaction that finished writing the
+             summary but not the new log, so it is skipped.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        Records replayed, -1 if there is no log, -2 if it is stale or damaged, -3 if it ends mid-record. */
+int ScoreStore::replayLog() {
+    FILE* file = fopen(logPath, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    ScoreLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, SCORE_LOG_MAGIC, 4) != 0 ||
+        header.version != SCORE_STORE_VERSION) {
+        fclose(file);
+        return -2;
+    }
+    if (header.generation != summary.generation) {
+        // A log newer than the summary means the summary was lost; the log alone is still worth keeping
+        if (header.generation < summary.generation || summary.count != 0) {
+            fclose(file);
+            return -2;
+        }
+        summary.generation = header.generation;
+    }
+
+    int replayed = 0;
+    int32_t records[256];
+    size_t read;
+    while ((read = fread(records, sizeof(int32_t), 256, file)) > 0) {
+        for (size_t i = 0; i < read; i++) {
+            add(records[i]);
+        }
+        replayed += (int)read;
+    }
+    long end = ftell(file);
+    fclose(file);
+
+    pending = replayed;
+    if (end != (long)(sizeof(header) + replayed * sizeof(int32_t))) {
+        return -3;
+    }
+    return replayed;
+}
+
+/* FUNCTION: Starts a new, empty log for the summary's current generation.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        true on success.                                                    */
+bool ScoreStore::resetLog() {
+    FILE* file = fopen(logPath, "wb");
+    if (!file) {
+        printf("Error: Unable to write to %s\n", logPath);
+        return false;
+    }
+
+    ScoreLogHeader header;
+    memcpy(header.magic, SCORE_LOG_MAGIC, 4);
+    header.version = SCORE_STORE_VERSION;
+    header.generation = summary.generation;
+    header.reserved = 0;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+
+    pending = 0;
+    return written;
+}
+
+/* FUNCTION: Adds every score in an old one-score-per-line text file.
+    Author: Reagan
+    Arguments:
+        path - The text file.
+    Returns:
+        Scores imported.                                                */
+int ScoreStore::importLegacy(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+
+    int imported = 0;
+    int score;
+    while (fscanf(file, "%i", &score) == 1) {
+        add(score);
+        imported++;
+    }
+    fclose(file);
+    return imported;
+}
+
+/* FUNCTION: Folds one score into the summary: count, histogram bin and (if it makes the cut) the top-K list.
+    Author: Reagan
+    Arguments:
+        score - The score (negative scores count as 0).
+    Returns:
+        NONE                                                                                                   */
+void ScoreStore::add(int score) {
+    if (score < 0) {
+        score = 0;
+    }
+
+    summary.count++;
+    summary.histogram[score < SCORE_HISTOGRAM_BINS ? score : SCORE_HISTOGRAM_BINS - 1]++;
+
+    // Find where the score goes in the descending list; equal scores keep their order of arrival
+    int position = summary.topCount;
+    while (position > 0 && summary.top[position - 1] < score) {
+        position--;
+    }
+    if (position >= SCORE_TOP_K) {
+        return;
+    }
+
+    int last = summary.topCount < SCORE_TOP_K ? summary.topCount : SCORE_TOP_K - 1;
+    for (int i = last; i > position; i--) {
+        summary.top[i] = summary.top[i - 1];
+    }
+    summary.top[position] = score;
+    if (summary.topCount < SCORE_TOP_K) {
+        summary.topCount++;
+    }
+}
+
+/* FUNCTION: Logs one game's score and updates the summary in memory.
+    Author: Reagan
+    Arguments:
+        score - The score the game ended with.
+    Returns:
+        true if the score was written to disk.  */
+bool ScoreStore::append(int score) {
+    MEMORY_TAG(MEM_SCORES);
+    add(score);
+
+    FILE* file = fopen(logPath, "ab");
+    if (!file) {
+        printf("Error: Unable to write to %s\n", logPath);
+        return false;
+    }
+    int32_t record = score < 0 ? 0 : score;
+    bool written = fwrite(&record, sizeof(record), 1, file) == 1;
+    fclose(file);
+
+    pending++;
+    if (pending >= SCORE_COMPACT_INTERVAL) {
+        return compact();
+    }
+    return written;
+}
+
+/* FUNCTION: Writes the summary (to a temporary file that then replaces the old one) and starts a new log.
+             If the game stops part way, the next open() either replays the old log against the old summary
+             or skips it against the new one, so no score is counted twice or lost.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        true on success.                                                                                     */
+bool ScoreStore::compact() {
+    char tempPath[270];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", summaryPath);
+
+    summary.generation++;
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        printf("Error: Unable to write to %s\n", tempPath);
+        summary.generation--;
+        return false;
+    }
+    bool written = fwrite(&summary, sizeof(summary), 1, file) == 1;
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        remove(tempPath);
+        summary.generation--;
+        return false;
+    }
+
+    if (!replaceFile(tempPath, summaryPath)) {
+        printf("Error: Unable to replace %s\n", summaryPath);
+        summary.generation--;
+        return false;
+    }
+
+    compactions++;
+    return resetLog();
+}
+
+/* FUNCTION: Works out how a score ranks against every game logged.
+    Author: Reagan
+    Arguments:
+        score - The score to rank.
+    Returns:
+        Percentage (0-100) of logged games that scored lower.        */
+double ScoreStore::percentile(int score) const {
+    if (summary.count == 0) {
+        return 0.0;
+    }
+    if (score >= SCORE_HISTOGRAM_BINS) {
+        score = SCORE_HISTOGRAM_BINS - 1;
+    }
+
+    uint64_t lower = 0;
+    for (int bin = 0; bin < score; bin++) {
+        lower += summary.histogram[bin];
+    }
+    return 100.0 * lower / summary.count;
+}
+
+/* FUNCTION: Prints store counters.
+    Author: Reagan
+    Arguments:
+        NONE
+    Returns:
+        NONE                      */
+void ScoreStore::printStats() const {
+    printf("Scores: %lu games logged, best %d, %lu in the log since the last compaction, %lu compactions\n",
+           count(), summary.topCount ? summary.top[0] : 0, pending, compactions);
+}
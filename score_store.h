@@ -0,0 +1,86 @@
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+#include <stdint.h>
+
+/* Score store files:
+       scores.log      ScoreLogHeader, then one int32_t per game appended since the last compaction
+       scores.summary  ScoreSummary covering every game folded in by the last compaction
+   A log whose generation doesn't match the summary's was already folded in and is started over.  */
+
+#define SCORE_LOG_FILE "scores.log"
+#define SCORE_SUMMARY_FILE "scores.summary"
+#define SCORE_LEGACY_FILE "losing_scores.txt"   // Old one-line-per-game text file, imported once
+#define SCORE_LOG_MAGIC "MGSL"
+#define SCORE_SUMMARY_MAGIC "MGSS"
+#define SCORE_STORE_VERSION 1
+
+#define SCORE_TOP_K 10                  // Best scores kept in the summary (the leaderboard shows 5)
+#define SCORE_HISTOGRAM_BINS 1024       // Scores 0 to 1022 get their own bin; the last bin holds everything higher
+#define SCORE_COMPACT_INTERVAL 256      // Appends between compactions (bounds the log replayed at startup)
+
+struct ScoreLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t generation;
+    uint32_t reserved;
+};
+
+struct ScoreSummary {
+    char magic[4];
+    uint32_t version;
+    uint32_t generation;
+    uint32_t topCount;
+    uint64_t count;
+    int32_t top[SCORE_TOP_K];                       // Descending
+    uint32_t histogram[SCORE_HISTOGRAM_BINS];
+};
+
+static_assert(sizeof(ScoreLogHeader) == 16, "ScoreLogHeader must match the on-disk layout");
+
+/* CLASS: Every score ever logged on this device, kept as a binary append log plus a compacted summary
+          (top-K list, score histogram and total count) that is updated incrementally on every append.
+    Author: Reagan
+    Members:
+        open(logPath, summaryPath) - Loads the summary and replays the log written since it was compacted.
+        create(logPath, summaryPath, games, seed) - Starts a new store holding games made-up scores (for benchmarks).
+        append(score) - Logs one game's score; compacts every SCORE_COMPACT_INTERVAL appends.
+        compact() - Writes the summary and starts a new, empty log.
+        topCount(), top(rank) - The best scores, highest first (rank 0 is the best).
+        count() - Games logged.
+        percentile(score) - Percentage of logged games that scored lower than score.
+        printStats() - Prints store counters.
+    Notes:
+        Reading the leaderboard costs O(K) however many games have been logged; nothing is re-read from disk. */
+class ScoreStore {
+public:
+    ScoreStore();
+
+    bool open(const char* logPath, const char* summaryPath);
+    bool create(const char* logPath, const char* summaryPath, unsigned long games, unsigned int seed);
+    bool append(int score);
+    bool compact();
+
+    int topCount() const { return summary.topCount; }
+    int top(int rank) const { return summary.top[rank]; }
+    unsigned long count() const { return (unsigned long)summary.count; }
+    double percentile(int score) const;
+    void printStats() const;
+
+private:
+    void add(int score);
+    bool readSummary(const char* path);
+    int replayLog();
+    bool resetLog();
+    int importLegacy(const char* path);
+
+    ScoreSummary summary;
+    char logPath[260];
+    char summaryPath[260];
+    unsigned long pending;      // Appends in the log that aren't in the written summary yet
+    unsigned long compactions;
+};
+
+extern ScoreStore Scores;
+
+#endif
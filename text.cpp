@@ -0,0 +1,205 @@
+#include "text.h"
+#include "display.h"
+#include "font.h"
+#include "memory_ledger.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const TextFont LCD_FONT = {FONT_CHAR_WIDTH, FONT_CHAR_HEIGHT};
+
+TextLayoutCache TextLayouts;
+
+/* FUNCTION: Word-wraps a string to fit a box and centers the lines both horizontally and vertically within it.
+             Lines break at the last space that fits; a word longer than a whole line is split where the line ends.
+    Author: Niko
+    Arguments:
+        text - The string (doesn't need to be '\0'-terminated).
+        x1, y1 - Coordinates for the top-left corner of the box.
+        x2, y2 - Coordinates for the bottom-right corner of the box.
+        font - Metrics of the font the text will be drawn in.
+        layout - Receives the lines.
+    Returns:
+        NONE                                                                                                       */
+void layoutText(std::string_view text, int x1, int y1, int x2, int y2, const TextFont& font, TextLayout* layout) {
+    TRACE_SCOPE("text_layout");
+    layout->lines.clear();
+    layout->font = font;
+
+    int textLength = (int)text.size();
+    int lineLength = (x2 - x1) / font.charWidth;   // How many characters fit per line of text w/in the box
+    if (lineLength < 1) {
+        lineLength = 1;
+    }
+
+    int lineStart = 0;
+    while (lineStart < textLength) {
+        int lineEnd = lineStart + lineLength;
+        if (lineEnd < textLength) {
+            // Avoid splitting words in the middle
+            while (lineEnd > lineStart && text[lineEnd] != ' ') {
+                lineEnd--;
+            }
+            // If no space is found, use the full line length
+            if (lineEnd == lineStart) {
+                lineEnd = lineStart + lineLength;
+            }
+        } else {
+            lineEnd = textLength;
+        }
+
+        TextLine line;
+        line.start = lineStart;
+        line.length = lineEnd - lineStart;
+        line.x = x1 + (x2 - x1 - (int)line.length * font.charWidth) / 2;
+        line.y = 0;
+        layout->lines.push_back(line);
+
+        // The space a line broke at isn't drawn at the start of the next one
+        lineStart = lineEnd;
+        if (lineStart < textLength && text[lineStart] == ' ') {
+            lineStart++;
+        }
+    }
+
+    // Center vertically on the lines the wrap actually produced
+    int textHeight = (int)layout->lines.size() * font.lineHeight;
+    int y = y1 + ((y2 - y1) - textHeight) / 2;
+    for (size_t i = 0; i < layout->lines.size(); i++) {
+        layout->lines[i].y = y;
+        y += font.lineHeight;
+    }
+}
+
+/* FUNCTION: Draws a laid out string, one glyph run per line.
+    Author: Niko
+    Arguments:
+        layout - The layout (from TextLayouts.get or layoutText).
+        text - The same string it was laid out from.
+        textColor - The color of the text.
+        target - Off-screen image to draw into instead (coordinates are then the image's), or NULL for the screen.
+    Returns:
+        NONE                                                                                                       */
+void drawTextLayout(const TextLayout& layout, std::string_view text, unsigned int textColor, Image* target) {
+    for (size_t i = 0; i < layout.lines.size(); i++) {
+        const TextLine& line = layout.lines[i];
+        if (target) {
+            drawGlyphRun(target->pixels.data(), target->width, target->width, target->height, text.data() + line.start,
+                         line.length, line.x, line.y, layout.font.charWidth, 0xFF000000u | textColor);
+        } else {
+            Display.writeAt(text.data() + line.start, line.length, line.x, line.y, textColor);
+        }
+    }
+}
+
+/* FUNCTION: Displays a any text string both horizontally and vertically centered within a defined "text box" on the LCD.
+             The layout is memoized, so drawing the same string in the same box again only draws glyphs.
+    Author: Niko
+    Arguments:
+        note - The note text to display (doesn't need to be '\0'-terminated).
+        textColor - The color of the text.
+        x1, y1 - Coordinates for the top-left corner of the box.
+        x2, y2 - Coordinates for the bottom-right corner of the box.
+        target - Off-screen image to draw into instead (coordinates are then the image's), or NULL for the screen.
+    Returns:
+        NONE                                                                                                             */
+void printTextWithinBox(std::string_view note, unsigned int textColor, int x1, int y1, int x2, int y2, Image* target) {
+    std::shared_ptr<const TextLayout> layout = TextLayouts.get(note, x1, y1, x2, y2);
+    drawTextLayout(*layout, note, textColor, target);
+}
+
+TextLayoutCache::TextLayoutCache() : hitCount(0), missCount(0) {
+}
+
+/* FUNCTION: Looks up the layout of a string within a box, laying it out on a miss.
+    Author: Niko
+    Arguments:
+        text - The string (its content is hashed, so a copy at another address hits the same entry).
+        x1, y1, x2, y2 - The box.
+        font - Metrics of the font.
+    Returns:
+        The layout.                                                                                   */
+std::shared_ptr<const TextLayout> TextLayoutCache::get(std::string_view text, int x1, int y1, int x2, int y2, const TextFont& font) {
+    MEMORY_TAG(MEM_TEXT);
+    // FNV-1a over the characters, then the box and font folded in the same way
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < text.size(); i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 1099511628211ull;
+    }
+    const int extra[6] = {x1, y1, x2, y2, font.charWidth, font.lineHeight};
+    for (int i = 0; i < 6; i++) {
+        hash = (hash ^ (uint32_t)extra[i]) * 1099511628211ull;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto range = layouts.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Entry& entry = it->second;
+        if (entry.text == text && entry.x1 == x1 && entry.y1 == y1 && entry.x2 == x2 && entry.y2 == y2 &&
+            entry.font.charWidth == font.charWidth && entry.font.lineHeight == font.lineHeight) {
+            hitCount++;
+            return entry.layout;
+        }
+    }
+
+    missCount++;
+    if (layouts.size() >= MAX_TEXT_LAYOUTS) {
+        layouts.clear();
+    }
+    std::shared_ptr<TextLayout> layout = std::make_shared<TextLayout>();
+    layoutText(text, x1, y1, x2, y2, font, layout.get());
+
+    Entry entry;
+    entry.text = std::string(text);
+    entry.x1 = x1;
+    entry.y1 = y1;
+    entry.x2 = x2;
+    entry.y2 = y2;
+    entry.font = font;
+    entry.layout = layout;
+    layouts.emplace(hash, entry);
+    return layout;
+}
+
+/* FUNCTION: Drops every layout (counters are kept).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                           */
+void TextLayoutCache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    layouts.clear();
+}
+
+/* FUNCTION: Prints hit and miss counters.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                 */
+void TextLayoutCache::printStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    unsigned long lookups = hitCount + missCount;
+    printf("Text layouts: %lu hits, %lu laid out (%.1f%% hit rate), %lu held\n", hitCount, missCount,
+           lookups ? 100.0 * hitCount / lookups : 0.0, (unsigned long)layouts.size());
+}
+
+/* FUNCTION: Formats an emissions value the way the game shows it: whole numbers without decimals, then one decimal
+             place if that is exact, otherwise two.
+    Author: Niko
+    Arguments:
+        value - Emissions value in kg CO2eq.
+        text, size - Receives the formatted value.
+    Returns:
+        NONE                                                                                                            */
+void formatEmissionsValue(double value, char* text, size_t size) {
+    if (value == (int)value) {
+        snprintf(text, size, "%d", (int)value);
+    } else if (value == (int)(value * 10) / 10.0) {
+        snprintf(text, size, "%.1f", value);
+    } else {
+        snprintf(text, size, "%.2f", value);
+    }
+}
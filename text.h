@@ -0,0 +1,91 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "font.h"
+#include "image.h"
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define MAX_TEXT_LAYOUTS 256    // Layouts memoized before the cache starts over (every string the game shows fits many times over)
+
+/* CLASS: Metrics of a fixed-width font.
+    Author: Niko
+    Members:
+        charWidth - Horizontal advance of every character in px.
+        lineHeight - Distance between baselines in px.           */
+struct TextFont {
+    int charWidth;
+    int lineHeight;
+};
+
+extern const TextFont LCD_FONT;    // The FEH LCD's 12x17 character cell (see font.h)
+
+/* CLASS: One line of laid out text.
+    Author: Niko
+    Members:
+        start, length - The characters on the line, as offsets into the laid out string.
+        x, y - Top-left corner of the line's first character cell.                      */
+struct TextLine {
+    uint32_t start;
+    uint32_t length;
+    int x, y;
+};
+
+/* CLASS: A string word-wrapped and centered within a box; only depends on the string, the box and the font, so it
+          can be drawn any number of times (see drawTextLayout).
+    Author: Niko
+    Members:
+        lines - The lines, top to bottom.
+        font - The font it was laid out for.                                                                        */
+struct TextLayout {
+    std::vector<TextLine> lines;
+    TextFont font;
+};
+
+/* CLASS: Memoizes text layouts by the content of the string, the box and the font.
+    Author: Niko
+    Members:
+        get(text, x1, y1, x2, y2, font) - The layout of a string within a box, computed only on a miss.
+        clear() - Drops every layout.
+        printStats() - Prints hit and miss counters.
+    Notes:
+        Entries are keyed by a hash of the string's content (not its address), so a string rebuilt every frame (e.g.
+        by sprintf) still hits. The cache starts over once MAX_TEXT_LAYOUTS are held; handed out layouts stay valid.
+        Lookups are locked, as cards are also laid out on the prefetch thread.                                       */
+class TextLayoutCache {
+public:
+    TextLayoutCache();
+
+    std::shared_ptr<const TextLayout> get(std::string_view text, int x1, int y1, int x2, int y2, const TextFont& font = LCD_FONT);
+    void clear();
+    void printStats() const;
+
+private:
+    struct Entry {
+        std::string text;
+        int x1, y1, x2, y2;
+        TextFont font;
+        std::shared_ptr<const TextLayout> layout;
+    };
+
+    mutable std::mutex lock;
+    std::unordered_multimap<uint64_t, Entry> layouts;
+    unsigned long hitCount;
+    unsigned long missCount;
+};
+
+extern TextLayoutCache TextLayouts;
+
+void layoutText(std::string_view text, int x1, int y1, int x2, int y2, const TextFont& font, TextLayout* layout);
+void drawTextLayout(const TextLayout& layout, std::string_view text, unsigned int textColor, Image* target = NULL);
+void printTextWithinBox(std::string_view note, unsigned int textColor, int x1, int y1, int x2, int y2, Image* target = NULL);
+void formatEmissionsValue(double value, char* text, size_t size);
+
+#endif
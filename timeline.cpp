@@ -0,0 +1,134 @@
+#include "timeline.h"
+
+#include "backend.h"
+
+#include <math.h>
+#include <stdio.h>
+
+AnimationStats Animations;
+
+/* FUNCTION: Applies an easing curve.
+    Author: Niko
+    Arguments:
+        easing - One of the EASE_* curves.
+        t - Linear progress from 0 to 1.
+    Returns:
+        Eased progress from 0 to 1.          */
+double ease(int easing, double t) {
+    if (t <= 0.0) {
+        return 0.0;
+    }
+    if (t >= 1.0) {
+        return 1.0;
+    }
+    switch (easing) {
+    case EASE_OUT_QUINT:
+        return 1.0 - pow(1.0 - t, 5);
+    case EASE_IN_OUT_CUBIC:
+        return t < 0.5 ? 4.0 * t * t * t : 1.0 - pow(-2.0 * t + 2.0, 3) / 2.0;
+    default:
+        return t;
+    }
+}
+
+Timeline::Timeline(const char* name, double duration, double frameInterval)
+    : name(name), duration(duration), frameInterval(frameInterval), startTime(-1.0), shown(0), skipped(0), nextSlot(0),
+      finished(false) {
+    // Slot 0 is progress 0 and the last slot is progress 1, so a run has one more frame than it has intervals
+    planned = (int)ceil(duration / frameInterval - 1e-9) + 1;
+}
+
+Timeline::~Timeline() {
+    finish();
+}
+
+/* FUNCTION: Hands out the next frame, sleeping until its slot comes up or skipping the slots drawing fell behind on.
+    Author: Niko
+    Arguments:
+        progress - Receives the frame's linear progress from 0 to 1 (apply ease() as needed).
+    Returns:
+        true if there is a frame to draw, false once the animation has finished.                                      */
+bool Timeline::nextFrame(double* progress) {
+    if (finished) {
+        return false;
+    }
+    int lastSlot = planned - 1;
+    if (nextSlot > lastSlot) {
+        finish();
+        return false;
+    }
+
+    double now = Device->now();
+    if (startTime < 0.0) {
+        startTime = now;
+        Animations.setPlaying(name);
+    } else {
+        double due = startTime + nextSlot * frameInterval;
+        if (now < due) {
+            // Yield the CPU until the slot instead of spinning on the clock
+            Device->sleep(ceil((due - now) * 1000.0) / 1000.0);
+        } else {
+            // Behind: jump to the latest slot that has already come up (the last one is always shown)
+            int latest = (int)((now - startTime) / frameInterval);
+            if (latest > lastSlot) {
+                latest = lastSlot;
+            }
+            if (latest > nextSlot) {
+                skipped += latest - nextSlot;
+                nextSlot = latest;
+            }
+        }
+    }
+
+    double elapsed = nextSlot * frameInterval;
+    *progress = (nextSlot == lastSlot || elapsed >= duration) ? 1.0 : elapsed / duration;
+    nextSlot++;
+    shown++;
+    return true;
+}
+
+/* FUNCTION: Records the run in Animations (once).
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                    */
+void Timeline::finish() {
+    if (finished || startTime < 0.0) {
+        return;
+    }
+    finished = true;
+    Animations.setPlaying(NULL);
+    Animations.record(name, planned, shown, skipped, Device->now() - startTime);
+}
+
+/* FUNCTION: Adds one run of an animation to its totals.
+    Author: Niko
+    Arguments:
+        name - The animation.
+        planned, shown, skipped - Frame counts of the run.
+        seconds - How long the run took.
+    Returns:
+        NONE                                                   */
+void AnimationStats::record(const char* name, int planned, int shown, int skipped, double seconds) {
+    Totals& totals = animations[name];
+    totals.runs++;
+    totals.planned += planned;
+    totals.shown += shown;
+    totals.skipped += skipped;
+    totals.seconds += seconds;
+}
+
+/* FUNCTION: Prints planned and actual frame counts per animation.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                                                         */
+void AnimationStats::printStats() const {
+    for (auto it = animations.begin(); it != animations.end(); ++it) {
+        const Totals& totals = it->second;
+        printf("Animation %s: %lu runs, %lu of %lu planned frames shown, %lu skipped, %.3f s per run\n", it->first.c_str(),
+               totals.runs, totals.shown, totals.planned, totals.skipped, totals.runs ? totals.seconds / totals.runs : 0.0);
+    }
+}
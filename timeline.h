@@ -0,0 +1,83 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <map>
+#include <string>
+
+#define ANIMATION_FRAME_INTERVAL 0.02   // Default time between animation frames in seconds (50 fps at most)
+
+/* Easing curves for ease() */
+#define EASE_LINEAR 0
+#define EASE_OUT_QUINT 1        // Fast start, long gentle stop (the prompt slide)
+#define EASE_IN_OUT_CUBIC 2
+
+double ease(int easing, double t);
+
+/* CLASS: Clock for one run of an animation: hands out one frame at a time, each with the animation's progress
+          according to the wall clock, so the animation takes the same time however long drawing takes.
+    Author: Niko
+    Members:
+        nextFrame(progress) - Waits (sleeping, not spinning) for the next frame's slot and gives its progress from 0
+            to 1; returns false once the frame at progress 1 has been handed out. If drawing fell behind, the slots
+            that already passed are skipped instead of shown late.
+        framesPlanned(), framesShown(), framesSkipped() - Frame counters for this run.
+    Notes:
+        The first frame (progress 0) is handed out immediately and starts the clock. Each run's counters are added to
+        Animations under the timeline's name when it finishes (or is destroyed).                                    */
+class Timeline {
+public:
+    Timeline(const char* name, double duration, double frameInterval = ANIMATION_FRAME_INTERVAL);
+    ~Timeline();
+
+    bool nextFrame(double* progress);
+
+    int framesPlanned() const { return planned; }
+    int framesShown() const { return shown; }
+    int framesSkipped() const { return skipped; }
+
+private:
+    void finish();
+
+    const char* name;
+    double duration;
+    double frameInterval;
+    double startTime;       // Negative until the first frame
+    int planned;
+    int shown;
+    int skipped;
+    int nextSlot;           // Frame slot nextFrame hands out next
+    bool finished;
+};
+
+/* CLASS: Planned and actual frame counts of every animation, by name.
+    Author: Niko
+    Members:
+        record(name, planned, shown, skipped, seconds) - Adds one run of an animation.
+        setPlaying(name), playing() - The animation whose frames are being drawn (NULL if none), kept up to date by
+            Timeline so frame times can be put down to it.
+        printStats() - Prints one line per animation.                                                               */
+class AnimationStats {
+public:
+    AnimationStats() : playingName(NULL) {}
+
+    void record(const char* name, int planned, int shown, int skipped, double seconds);
+    void setPlaying(const char* name) { playingName = name; }
+    const char* playing() const { return playingName; }
+    void printStats() const;
+
+private:
+    struct Totals {
+        unsigned long runs;
+        unsigned long planned;
+        unsigned long shown;
+        unsigned long skipped;
+        double seconds;
+    };
+
+    std::map<std::string, Totals> animations;
+    const char* playingName;
+};
+
+extern AnimationStats Animations;
+
+#endif
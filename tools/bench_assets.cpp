@@ -0,0 +1,126 @@
+/* TOOL: bench_assets
+    Author: Niko
+    Times loading every image in an asset bundle against decoding its loose PNG the old way, and compares their sizes.
+    Usage:
+        bench_assets [assets.bundle]
+    Run it from the game folder (the loose PNGs are read from their asset paths). Results are grouped by the
+    encoding pack_assets chose for each image. Exits non-zero if the bundle misses any of the limits below.          */
+
+#include "../asset_bundle.h"
+
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+
+#define MAX_SIZE_RATIO 1.5      // Largest the bundle file may be next to the loose PNGs it packs
+#define MIN_SPEEDUP 2.0         // Least the bundle has to cut the average load time by, against decoding the PNGs
+#define MIN_CHEAP_SHARE 0.9     // Least share of assets that must load as views or without an inflate (not ASSET_PNG)
+
+struct EncodingTotals {
+    size_t images;
+    uint64_t bundleBytes;
+    uint64_t pngBytes;
+    double bundleSeconds;
+    double pngSeconds;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+static void printTotals(const char* name, const EncodingTotals& totals) {
+    printf("%-16s %5zu images %8.1f MB %8.1f MB %9.3f ms %9.3f ms %7.1fx\n", name, totals.images,
+           totals.bundleBytes / 1048576.0, totals.pngBytes / 1048576.0, totals.bundleSeconds * 1000.0 / totals.images,
+           totals.pngSeconds * 1000.0 / totals.images, totals.bundleSeconds > 0 ? totals.pngSeconds / totals.bundleSeconds : 0.0);
+}
+
+int main(int argc, char** argv) {
+    const char* bundlePath = argc > 1 ? argv[1] : BUNDLE_FILE;
+    if (!Bundle.open(bundlePath)) {
+        printf("Error: unable to open %s (build it with make assets)\n", bundlePath);
+        return 1;
+    }
+
+    const char* encodingNames[4] = {"raw", "PNG", "transparent-run", "palettized"};
+    EncodingTotals totals[4] = {};
+    EncodingTotals all = {};
+    Image bundleImage, pngImage;
+
+    for (int i = 0; i < Bundle.entryCount(); i++) {
+        AssetView asset;
+        const char* path = Bundle.entry(i, &asset);
+        if (!path || asset.encoding < 0 || asset.encoding > 3) {
+            continue;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        bool bundleOk = decodeAsset(asset, &bundleImage);
+        double bundleSeconds = secondsSince(started);
+
+        started = std::chrono::steady_clock::now();
+        bool pngOk = decodePNG(path, &pngImage);
+        double pngSeconds = secondsSince(started);
+
+        if (!bundleOk || !pngOk) {
+            printf("Warning: skipping %s (%s failed to load)\n", path, bundleOk ? "PNG" : "bundle entry");
+            continue;
+        }
+        // Both paths must produce the same pixels (the color of a fully transparent pixel doesn't matter)
+        bool same = bundleImage.width == pngImage.width && bundleImage.height == pngImage.height;
+        for (size_t p = 0; same && p < (size_t)pngImage.width * pngImage.height; p++) {
+            uint32_t a = bundleImage.data()[p], b = pngImage.data()[p];
+            same = a == b || ((a >> 24) == 0 && (b >> 24) == 0);
+        }
+        if (!same) {
+            printf("Error: %s decodes differently from its PNG\n", path);
+            return 1;
+        }
+
+        std::error_code error;
+        uint64_t pngBytes = std::filesystem::file_size(path, error);
+        EncodingTotals* groups[2] = {&totals[asset.encoding], &all};
+        for (int g = 0; g < 2; g++) {
+            groups[g]->images++;
+            groups[g]->bundleBytes += asset.size;
+            groups[g]->pngBytes += error ? 0 : pngBytes;
+            groups[g]->bundleSeconds += bundleSeconds;
+            groups[g]->pngSeconds += pngSeconds;
+        }
+    }
+
+    printf("%-16s %12s %11s %11s %12s %12s %8s\n", "encoding", "", "bundle", "PNG", "bundle load", "PNG decode", "speedup");
+    for (int e = 0; e < 4; e++) {
+        if (totals[e].images > 0) {
+            printTotals(encodingNames[e], totals[e]);
+        }
+    }
+    if (all.images > 0) {
+        printTotals("all", all);
+    }
+
+    // The whole file counts here (index, paths and padding too), against every loose PNG it stands in for
+    std::error_code error;
+    uint64_t bundleBytes = std::filesystem::file_size(bundlePath, error);
+    double sizeRatio = all.pngBytes > 0 ? (double)bundleBytes / all.pngBytes : 0.0;
+    double speedup = all.bundleSeconds > 0 ? all.pngSeconds / all.bundleSeconds : 0.0;
+    double cheapShare = all.images > 0 ? (double)(all.images - totals[ASSET_PNG].images) / all.images : 0.0;
+    printf("bundle file %.2f MB, loose PNGs %.2f MB (%.2fx, at most %.2fx)\n", bundleBytes / 1048576.0,
+           all.pngBytes / 1048576.0, sizeRatio, MAX_SIZE_RATIO);
+    printf("load %.1fx faster than the PNGs (at least %.1fx), %.0f%% of assets without an inflate (at least %.0f%%)\n",
+           speedup, MIN_SPEEDUP, cheapShare * 100.0, MIN_CHEAP_SHARE * 100.0);
+
+    bool ok = true;
+    if (error || sizeRatio > MAX_SIZE_RATIO) {
+        printf("Error: %s takes too much room next to the PNGs it packs\n", bundlePath);
+        ok = false;
+    }
+    if (speedup < MIN_SPEEDUP) {
+        printf("Error: %s doesn't load enough faster than the PNGs\n", bundlePath);
+        ok = false;
+    }
+    if (cheapShare < MIN_CHEAP_SHARE) {
+        printf("Error: too many assets in %s still need a PNG decode\n", bundlePath);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
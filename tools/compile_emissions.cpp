@@ -0,0 +1,118 @@
+/* TOOL: compile_emissions
+    Author: Niko
+    Compiles an @-separated emissions data file into the binary dataset format (see emissions.h) that the game maps
+    and uses in place instead of parsing the text at startup.
+    Usage:
+        compile_emissions [-o emissions_data.bin] [emissions_data.csv]
+    The output defaults to the source path with ".bin" in place of ".csv". The game only uses the compiled file while
+    the text file's size and modification time still match the ones recorded here, so edit the text, then recompile. */
+
+#include "../emissions.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+static void writePadding(FILE* out, uint64_t* offset, uint64_t alignment) {
+    static const unsigned char zeros[EMISSIONS_NOTES_ALIGNMENT] = {0};
+    uint64_t pad = (alignment - (*offset % alignment)) % alignment;
+    fwrite(zeros, 1, pad, out);
+    *offset += pad;
+}
+
+static void writeBytes(FILE* out, uint64_t* offset, const void* data, size_t size) {
+    fwrite(data, 1, size, out);
+    *offset += size;
+}
+
+int main(int argc, char** argv) {
+    const char* sourcePath = EMISSIONS_FILE;
+    const char* outputPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Usage: %s [-o output.bin] [source.csv]\n", argv[0]);
+            return 1;
+        } else {
+            sourcePath = argv[i];
+        }
+    }
+
+    char defaultOutput[260];
+    if (!outputPath) {
+        compiledDatasetPath(sourcePath, defaultOutput, sizeof(defaultOutput));
+        outputPath = defaultOutput;
+    }
+
+    struct stat source;
+    EmissionsDataset dataset;
+    if (stat(sourcePath, &source) != 0 || dataset.load(sourcePath) == 0) {
+        printf("Error: unable to load %s\n", sourcePath);
+        return 1;
+    }
+    int count = dataset.size();
+
+    // Gather the tables and both string sections, with offsets relative to their own section
+    std::vector<double> values(count);
+    std::vector<uint32_t> tables(4 * (size_t)count);
+    std::string descriptions, notes;
+    for (int i = 0; i < count; i++) {
+        values[i] = dataset.value(i);
+        tables[i] = (uint32_t)descriptions.size();
+        tables[count + i] = (uint32_t)dataset.description(i).size();
+        tables[2 * count + i] = (uint32_t)notes.size();
+        tables[3 * count + i] = (uint32_t)dataset.note(i).size();
+        descriptions.append(dataset.description(i));
+        notes.append(dataset.note(i));
+    }
+
+    FILE* out = fopen(outputPath, "wb");
+    if (!out) {
+        printf("Error: unable to create %s\n", outputPath);
+        return 1;
+    }
+
+    // Header first as a placeholder; it is rewritten once the offsets are known
+    EmissionsBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EMISSIONS_BINARY_MAGIC, 4);
+    header.version = EMISSIONS_BINARY_VERSION;
+    header.count = count;
+    header.sourceSize = source.st_size;
+    header.sourceTime = source.st_mtime;
+
+    uint64_t offset = 0;
+    writeBytes(out, &offset, &header, sizeof(header));
+
+    writePadding(out, &offset, EMISSIONS_TABLE_ALIGNMENT);
+    header.valuesOffset = offset;
+    writeBytes(out, &offset, values.data(), values.size() * sizeof(double));
+
+    writePadding(out, &offset, EMISSIONS_TABLE_ALIGNMENT);
+    header.tablesOffset = offset;
+    writeBytes(out, &offset, tables.data(), tables.size() * sizeof(uint32_t));
+
+    header.descriptionsOffset = offset;
+    header.descriptionsSize = descriptions.size();
+    writeBytes(out, &offset, descriptions.data(), descriptions.size());
+
+    writePadding(out, &offset, EMISSIONS_NOTES_ALIGNMENT);
+    header.notesOffset = offset;
+    header.notesSize = notes.size();
+    writeBytes(out, &offset, notes.data(), notes.size());
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    if (ferror(out) || fclose(out) != 0) {
+        printf("Error: failed writing %s\n", outputPath);
+        return 1;
+    }
+
+    printf("Compiled %d activities into %s: %llu bytes before the notes, %llu bytes of notes\n", count, outputPath,
+           (unsigned long long)header.notesOffset, (unsigned long long)header.notesSize);
+    return 0;
+}
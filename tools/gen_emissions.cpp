@@ -0,0 +1,102 @@
+/* TOOL: gen_emissions
+    Author: Niko
+    Writes a synthetic emissions data file in the same "description@value@note" format as emissions_data.csv, for
+    testing the loader and content packs at sizes the real data won't reach for a long time.
+    Usage:
+        gen_emissions [-n rows] [-o file] [--seed N] [--check]
+    --check loads the file back with the game's loader and prints how long it took, e.g.
+        gen_emissions -n 1000000 -o synthetic_emissions.csv --check
+    The game itself can then be pointed at the file with --data.                                                    */
+
+#include "../emissions.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* UNITS[] = {"1 kg of", "1 litre of", "1 hour of", "1 km of", "100 g of", "a year of"};
+static const char* THINGS[] = {"synthetic beans", "test cheese", "imaginary flights", "placeholder laundry",
+                               "generated cement", "sample streaming", "mock rice", "dummy cotton"};
+static const char* NOTES[] = {"", "Synthetic row; the value is made up.",
+                              "Generated for load testing, so the note is longer than most real ones and wraps over "
+                              "several lines of the note screen to exercise the text layout as well as the parser."};
+
+/* FUNCTION: xorshift step (the data only has to be repeatable, not good).
+    Author: Niko
+    Arguments:
+        state - Generator state, updated in place.
+    Returns:
+        The next pseudo-random number.                                     */
+static uint32_t nextRandom(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int main(int argc, char** argv) {
+    long rows = 1000000;
+    const char* outputPath = "synthetic_emissions.csv";
+    uint32_t seed = 2024;
+    bool check = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rows = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)atol(argv[++i]) | 1;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else {
+            printf("Usage: %s [-n rows] [-o file] [--seed N] [--check]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* out = fopen(outputPath, "wb");
+    if (!out) {
+        printf("Error: unable to create %s\n", outputPath);
+        return 1;
+    }
+
+    uint32_t state = seed;
+    for (long row = 0; row < rows; row++) {
+        const char* unit = UNITS[nextRandom(&state) % (sizeof(UNITS) / sizeof(UNITS[0]))];
+        const char* thing = THINGS[nextRandom(&state) % (sizeof(THINGS) / sizeof(THINGS[0]))];
+        const char* note = NOTES[nextRandom(&state) % (sizeof(NOTES) / sizeof(NOTES[0]))];
+
+        // Values spread over several orders of magnitude, like the real data
+        uint32_t magnitude = nextRandom(&state) % 5;
+        double value = (nextRandom(&state) % 10000) / 100.0;
+        for (uint32_t m = 0; m < magnitude; m++) {
+            value *= 10;
+        }
+
+        if (note[0]) {
+            fprintf(out, "Generating %s %s #%ld@%.2f@%s\n", unit, thing, row, value, note);
+        } else {
+            fprintf(out, "Generating %s %s #%ld@%.2f\n", unit, thing, row, value);
+        }
+    }
+    if (fclose(out) != 0) {
+        printf("Error: failed writing %s\n", outputPath);
+        return 1;
+    }
+    printf("Wrote %ld rows to %s\n", rows, outputPath);
+
+    if (check) {
+        EmissionsDataset dataset;
+        int loaded = dataset.load(outputPath);
+        dataset.printStats();
+        if (loaded != rows || !dataset.errors().empty()) {
+            printf("Error: expected %ld rows back\n", rows);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+/* TOOL: microbench
+    Author: Niko
+    Times the small functions on the startup and per-frame paths one by one: parsing the data file at 100 to 1M rows,
+    laying out and drawing text boxes, formatting values, picking prompts and reading the leaderboard.
+    Usage:
+        microbench [--filter text] [--samples n] [--csv file]
+    Each benchmark is warmed up, then timed in MICRO_SAMPLES samples (fewer for slow ones, see MICRO_MAX_SECONDS),
+    each running it enough times to last MICRO_SAMPLE_SECONDS. It reports the mean time per call with a 95%
+    confidence interval, the median and the fastest sample; --csv also writes the results as CSV. Inputs are
+    generated from fixed seeds, so runs compare like with like. Run it from the game folder; it writes its data
+    files to the system's temporary folder.                                                                      */
+
+#include "../backend.h"
+#include "../emissions.h"
+#include "../image.h"
+#include "../rounds.h"
+#include "../score_store.h"
+#include "../text.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+#define MICRO_WARMUP_SECONDS 0.05   // Run before timing, to settle caches, page in data and calibrate
+#define MICRO_SAMPLE_SECONDS 0.01   // Each sample repeats the function until it has run about this long
+#define MICRO_SAMPLES 30
+#define MICRO_MIN_SAMPLES 5
+#define MICRO_MAX_SECONDS 3.0       // Slow benchmarks take fewer samples to stay within this (but MICRO_MIN_SAMPLES)
+#define MICRO_SEED 2024
+
+struct MicroResult {
+    std::string name;
+    long iterations;        // Calls per sample
+    int samples;
+    double mean;            // Seconds per call
+    double ci95;            // Half-width of the 95% confidence interval of the mean
+    double median;
+    double min;
+};
+
+// Results are added in here so the compiler can't drop the calls being timed
+static volatile uint64_t sink;
+
+/* Backend for the prompt pickers: they only need random numbers */
+class MicroBackend : public Backend {
+public:
+    MicroBackend() : random(MICRO_SEED) {}
+
+    const char* name() const { return "microbench"; }
+    void drawRun(int y, int x1, int x2, uint32_t color) {}
+    void present() {}
+    bool touch(float* x, float* y) { return false; }
+    double now() { return 0.0; }
+    void sleep(double seconds) {}
+    int randInt() { return (int)(random() & 0x7FFFFFFF); }
+
+private:
+    std::mt19937 random;
+};
+
+static MicroBackend microBackend;
+
+static double secondsSince(std::chrono::steady_clock::time_point started) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+/* FUNCTION: Two-sided 95% Student's t value, for the confidence interval of a mean over few samples.
+    Author: Niko
+    Arguments:
+        degrees - Degrees of freedom (samples - 1).
+    Returns:
+        The t value.                                                                                     */
+static double studentT95(int degrees) {
+    static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                     2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                     2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees < 1) {
+        return 0.0;
+    }
+    return degrees <= 30 ? table[degrees - 1] : 1.96;
+}
+
+/* FUNCTION: Times one benchmark: warm-up and calibration, then the samples.
+    Author: Niko
+    Arguments:
+        name - Benchmark name.
+        samples - Samples wanted.
+        call - The function to time (called many times).
+    Returns:
+        The result.                                                            */
+static MicroResult measure(const char* name, int samples, const std::function<void()>& call) {
+    // Warm up, doubling the batch until it lasts a sample, which also gives the calls per sample
+    long iterations = 1;
+    double warmed = 0.0;
+    double batchSeconds = 0.0;
+    while (true) {
+        auto started = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++) {
+            call();
+        }
+        batchSeconds = secondsSince(started);
+        warmed += batchSeconds;
+        if (batchSeconds >= MICRO_SAMPLE_SECONDS && warmed >= MICRO_WARMUP_SECONDS) {
+            break;
+        }
+        if (batchSeconds < MICRO_SAMPLE_SECONDS) {
+            iterations *= 2;
+        }
+    }
+    double perSample = batchSeconds;
+    if (perSample * samples > MICRO_MAX_SECONDS) {
+        samples = std::max(MICRO_MIN_SAMPLES, (int)(MICRO_MAX_SECONDS / perSample));
+    }
+
+    std::vector<double> times;
+    for (int s = 0; s < samples; s++) {
+        auto started = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++) {
+            call();
+        }
+        times.push_back(secondsSince(started) / iterations);
+    }
+
+    MicroResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.samples = samples;
+    double total = 0.0;
+    for (size_t i = 0; i < times.size(); i++) {
+        total += times[i];
+    }
+    result.mean = total / samples;
+    double squares = 0.0;
+    for (size_t i = 0; i < times.size(); i++) {
+        squares += (times[i] - result.mean) * (times[i] - result.mean);
+    }
+    double deviation = samples > 1 ? sqrt(squares / (samples - 1)) : 0.0;
+    result.ci95 = studentT95(samples - 1) * deviation / sqrt((double)samples);
+    std::sort(times.begin(), times.end());
+    result.median = samples % 2 ? times[samples / 2] : (times[samples / 2 - 1] + times[samples / 2]) / 2.0;
+    result.min = times[0];
+    return result;
+}
+
+/* FUNCTION: Prints a time with a unit that suits it.
+    Author: Niko
+    Arguments:
+        seconds - The time.
+        text, size - Receives the formatted time.
+    Returns:
+        NONE                                            */
+static void formatTime(double seconds, char* text, size_t size) {
+    if (seconds < 1e-6) {
+        snprintf(text, size, "%.1f ns", seconds * 1e9);
+    } else if (seconds < 1e-3) {
+        snprintf(text, size, "%.2f us", seconds * 1e6);
+    } else {
+        snprintf(text, size, "%.3f ms", seconds * 1e3);
+    }
+}
+
+static void printResult(const MicroResult& result) {
+    char mean[20], median[20], min[20];
+    formatTime(result.mean, mean, sizeof(mean));
+    formatTime(result.median, median, sizeof(median));
+    formatTime(result.min, min, sizeof(min));
+    printf("%-40s %12s +-%5.1f%% %12s %12s %10ld x %d\n", result.name.c_str(), mean,
+           result.mean > 0 ? 100.0 * result.ci95 / result.mean : 0.0, median, min, result.iterations, result.samples);
+}
+
+/* FUNCTION: Writes a synthetic data file in the game's "description@value@note" format (see tools/gen_emissions).
+    Author: Niko
+    Arguments:
+        path - Where to write it.
+        rows - Activities to write.
+    Returns:
+        false if the file couldn't be written.                                                                   */
+static bool writeDataFile(const std::string& path, long rows) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::mt19937 random(MICRO_SEED);
+    for (long i = 0; i < rows; i++) {
+        double value = (random() % 1000000) / 100.0;
+        fprintf(file, "Generating 1 kg of synthetic item %ld@%g@%s\n", i, value,
+                i % 3 ? "" : "Synthetic row; the value is made up for benchmarking the loader.");
+    }
+    return fclose(file) == 0;
+}
+
+int main(int argc, char** argv) {
+    const char* filter = NULL;
+    const char* csvPath = NULL;
+    int samples = MICRO_SAMPLES;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = std::max(2, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else {
+            printf("Usage: %s [--filter text] [--samples n] [--csv file]\n", argv[0]);
+            return 1;
+        }
+    }
+    Device = &microBackend;
+
+    std::vector<MicroResult> results;
+    printf("%-40s %12s %7s %12s %12s %10s\n", "Benchmark", "mean", "95% CI", "median", "min", "calls");
+    auto run = [&](const std::string& name, const std::function<void()>& call) {
+        if (filter && name.find(filter) == std::string::npos) {
+            return;
+        }
+        results.push_back(measure(name.c_str(), samples, call));
+        printResult(results.back());
+        fflush(stdout);
+    };
+
+    std::error_code error;
+    std::filesystem::path folder = std::filesystem::temp_directory_path(error);
+    if (error) {
+        folder = ".";
+    }
+
+    // Parsing the data file at startup (what EmissionsDataset::load does, without its message)
+    const long rowCounts[] = {100, 1000, 10000, 100000, 1000000};
+    for (long rows : rowCounts) {
+        std::string name = "emissions_load/" + std::to_string(rows);
+        if (filter && name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::string path = (folder / ("microbench_" + std::to_string(rows) + ".csv")).string();
+        if (!writeDataFile(path, rows)) {
+            printf("Error: unable to write %s\n", path.c_str());
+            return 1;
+        }
+        run(name, [&] {
+            MappedFile file;
+            EmissionsDataset dataset;
+            if (file.open(path.c_str())) {
+                sink += dataset.parse((const char*)file.data(), file.size());
+            }
+        });
+        remove(path.c_str());
+    }
+
+    // Text boxes: a description-sized string and a note at the 511-character limit
+    std::string shortText = "Generating 1 kg of coffee";
+    std::string longText;
+    const char* words[] = {"Producing", "concrete", "releases", "carbon", "dioxide", "from", "both", "the", "fuel",
+                           "burned", "and", "the", "limestone", "itself,"};
+    for (int i = 0; (int)longText.size() < 511; i++) {
+        longText += words[i % 14];
+        longText += ' ';
+    }
+    longText.resize(511);
+    const std::string* texts[] = {&shortText, &longText};
+    const char* textNames[] = {"short", "511"};
+    Image target;
+    target.width = 320;
+    target.height = 240;
+    target.pixels.assign(320 * 240, 0);
+    for (int t = 0; t < 2; t++) {
+        const std::string& text = *texts[t];
+        TextLayout layout;
+        run(std::string("layout_text/") + textNames[t], [&] {
+            layoutText(text, 0, 0, 320, 240, LCD_FONT, &layout);
+            sink += layout.lines.size();
+        });
+        run(std::string("print_text_within_box/") + textNames[t], [&] {
+            printTextWithinBox(text, WHITE, 0, 0, 320, 240, &target);
+        });
+    }
+
+    // Each branch of the value formatting
+    const double values[] = {42.0, 0.5, 2.37};
+    const char* valueNames[] = {"whole", "one_decimal", "two_decimals"};
+    for (int v = 0; v < 3; v++) {
+        double value = values[v];
+        run(std::string("format_value/") + valueNames[v], [&] {
+            char text[20];
+            formatEmissionsValue(value, text, sizeof(text));
+            sink += text[0];
+        });
+    }
+
+    // Picking prompts, from the smallest possible dataset up
+    const int datasetSizes[] = {2, 10, 100, 10000, 1000000};
+    for (int size : datasetSizes) {
+        run("get_distinct_ints/" + std::to_string(size), [&] {
+            int index1, index2;
+            getDistinctInts(size, &index1, &index2);
+            sink += index1 + index2;
+        });
+        int current = 0;
+        run("get_distinct_int_for_next_round/" + std::to_string(size), [&] {
+            getDistinctIntForNextRound(size, current, &current);
+            sink += current;
+        });
+    }
+
+    // The leaderboard's top 5, read from stores of different sizes (see LeaderboardScene::enter)
+    std::string logPath = (folder / "microbench_scores.log").string();
+    std::string summaryPath = (folder / "microbench_scores.summary").string();
+    const unsigned long gameCounts[] = {1000, 100000, 10000000};
+    const char* gameNames[] = {"1k", "100k", "10m"};
+    for (int g = 0; g < 3; g++) {
+        std::string name = std::string("leaderboard_top5/") + gameNames[g];
+        if (filter && name.find(filter) == std::string::npos) {
+            continue;
+        }
+        Scores.create(logPath.c_str(), summaryPath.c_str(), gameCounts[g], MICRO_SEED);
+        run(name, [&] {
+            int topScores[5];
+            for (int i = 0; i < 5; i++) {
+                topScores[i] = i < Scores.topCount() ? Scores.top(i) : 0;
+            }
+            sink += topScores[0] + topScores[4];
+        });
+    }
+    remove(logPath.c_str());
+    remove(summaryPath.c_str());
+
+    if (csvPath) {
+        FILE* csv = fopen(csvPath, "w");
+        if (!csv) {
+            printf("Error: unable to write %s\n", csvPath);
+            return 1;
+        }
+        fprintf(csv, "benchmark,mean_ns,ci95_ns,median_ns,min_ns,calls_per_sample,samples\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const MicroResult& r = results[i];
+            fprintf(csv, "%s,%.2f,%.2f,%.2f,%.2f,%ld,%d\n", r.name.c_str(), r.mean * 1e9, r.ci95 * 1e9,
+                    r.median * 1e9, r.min * 1e9, r.iterations, r.samples);
+        }
+        fclose(csv);
+        printf("Wrote %zu results to %s\n", results.size(), csvPath);
+    }
+    return 0;
+}
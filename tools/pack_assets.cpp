@@ -0,0 +1,367 @@
+/* TOOL: pack_assets
+    Author: Niko
+    Compiles the game's loose PNGs into a single asset bundle (see asset_bundle.h) that the game memory-maps at startup.
+    Usage:
+        pack_assets [-o assets.bundle] [--png-prefix PREFIX]... [--raw-all] [folder...]
+    Folders default to the game's asset folders. Each image is stored in the smallest of the encodings that load
+    without inflating or converting colors:
+        - raw 0xAARRGGBB pixels (ASSET_RGBA), drawn straight out of the mapping,
+        - runs of visible pixels (ASSET_RLE), for mostly transparent images like the overlays and answer animations,
+        - a palette plus LZ-packed indices (ASSET_INDEXED), for images with up to 256 colors like the GIF frames.
+    Only if that comes out more than PNG_FALLBACK_RATIO times the size of the PNG is the PNG kept instead, less its
+    metadata chunks (ASSET_PNG). Paths under a --png-prefix always keep their PNG, and --raw-all stores every image
+    raw.                                                                                                            */
+
+#include "../asset_bundle.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define PNG_FALLBACK_RATIO 3.0  // How many times the PNG's size a payload that loads without a decode may take
+
+struct PackedAsset {
+    std::string path;
+    BundleEntry entry;
+    std::vector<unsigned char> payload;
+};
+
+static bool readWholeFile(const std::string& path, std::vector<unsigned char>* data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data->resize(size > 0 ? size : 0);
+    bool ok = size > 0 && fread(data->data(), 1, size, file) == (size_t)size;
+    fclose(file);
+    return ok;
+}
+
+/* Copies a PNG with only the chunks decodePNGMemory reads (IHDR, PLTE, tRNS, IDAT, IEND), dropping text, timestamps
+   and the other metadata the game never looks at. */
+static void stripPNG(const std::vector<unsigned char>& png, std::vector<unsigned char>* out) {
+    const char* kept[] = {"IHDR", "PLTE", "tRNS", "IDAT", "IEND"};
+    out->assign(png.begin(), png.begin() + 8);
+    size_t pos = 8;
+    while (pos + 12 <= png.size()) {
+        const unsigned char* chunk = png.data() + pos;
+        size_t length = ((size_t)chunk[0] << 24) | (chunk[1] << 16) | (chunk[2] << 8) | chunk[3];
+        if (length > png.size() - pos - 12) {
+            break;
+        }
+        for (int k = 0; k < 5; k++) {
+            if (memcmp(chunk + 4, kept[k], 4) == 0) {
+                out->insert(out->end(), chunk, chunk + 12 + length);
+            }
+        }
+        pos += 12 + length;
+    }
+}
+
+/* Writes a sequence length past what fits in its token nibble: 255s, then the remainder. */
+static void writeLength(size_t length, std::vector<unsigned char>* out) {
+    while (length >= 255) {
+        out->push_back(255);
+        length -= 255;
+    }
+    out->push_back((unsigned char)length);
+}
+
+/* Writes one sequence: the literals, then (unless it is the last one) a match to copy. */
+static void writeSequence(const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength,
+                          std::vector<unsigned char>* out) {
+    size_t matchCode = matchLength ? matchLength - INDEXED_MIN_MATCH : 0;
+    out->push_back((unsigned char)((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (literalCount >= 15) {
+        writeLength(literalCount - 15, out);
+    }
+    out->insert(out->end(), literals, literals + literalCount);
+    if (matchLength) {
+        out->push_back((unsigned char)(offset & 0xFF));
+        out->push_back((unsigned char)(offset >> 8));
+        if (matchCode >= 15) {
+            writeLength(matchCode - 15, out);
+        }
+    }
+}
+
+/* Packs palette indices as LZ sequences (see unpackIndices in asset_bundle.cpp), greedily taking the longest match
+   a hash chain of earlier positions turns up. */
+static void packIndices(const std::vector<unsigned char>& indices, std::vector<unsigned char>* out) {
+    const int hashBits = 16;
+    const int maxAttempts = 64;
+    size_t total = indices.size();
+    std::vector<int32_t> head(1 << hashBits, -1);
+    std::vector<int32_t> previous(total, -1);
+    auto hashAt = [&](size_t i) {
+        uint32_t word;
+        memcpy(&word, indices.data() + i, sizeof(word));
+        return (word * 2654435761u) >> (32 - hashBits);
+    };
+    auto insert = [&](size_t i) {
+        if (i + INDEXED_MIN_MATCH <= total) {
+            uint32_t hash = hashAt(i);
+            previous[i] = head[hash];
+            head[hash] = (int32_t)i;
+        }
+    };
+
+    size_t literalStart = 0, i = 0;
+    while (i + INDEXED_MIN_MATCH <= total) {
+        size_t bestLength = 0, bestOffset = 0;
+        int attempts = 0;
+        for (int32_t candidate = head[hashAt(i)]; candidate >= 0 && attempts < maxAttempts;
+             candidate = previous[candidate], attempts++) {
+            if (i - candidate > INDEXED_MAX_OFFSET) {
+                break;
+            }
+            size_t length = 0;
+            while (i + length < total && indices[candidate + length] == indices[i + length]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestOffset = i - candidate;
+            }
+        }
+
+        if (bestLength < INDEXED_MIN_MATCH) {
+            insert(i);
+            i++;
+            continue;
+        }
+        writeSequence(indices.data() + literalStart, i - literalStart, bestOffset, bestLength, out);
+        for (size_t j = 0; j < bestLength; j++) {
+            insert(i + j);
+        }
+        i += bestLength;
+        literalStart = i;
+    }
+    writeSequence(indices.data() + literalStart, total - literalStart, 0, 0, out);
+}
+
+/* Palettizes an image; fails if it has more than 256 colors. */
+static bool encodeIndexed(const Image& image, std::vector<unsigned char>* payload) {
+    std::vector<uint32_t> palette;
+    std::unordered_map<uint32_t, unsigned char> lookup;
+    std::vector<unsigned char> indices(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        auto found = lookup.find(image.pixels[i]);
+        if (found == lookup.end()) {
+            if (palette.size() == 256) {
+                return false;
+            }
+            found = lookup.emplace(image.pixels[i], (unsigned char)palette.size()).first;
+            palette.push_back(image.pixels[i]);
+        }
+        indices[i] = found->second;
+    }
+
+    uint32_t colors = (uint32_t)palette.size();
+    payload->resize(sizeof(colors) + colors * sizeof(uint32_t));
+    memcpy(payload->data(), &colors, sizeof(colors));
+    memcpy(payload->data() + sizeof(colors), palette.data(), colors * sizeof(uint32_t));
+    packIndices(indices, payload);
+    return true;
+}
+
+/* Stores only the visible pixels of an image, as runs that skip over the fully transparent ones. */
+static void encodeRLE(const Image& image, std::vector<unsigned char>* payload) {
+    size_t i = 0, total = image.pixels.size();
+    while (i < total) {
+        RleRun run = {0, 0};
+        while (i < total && (image.pixels[i] >> 24) == 0 && run.skip < 0xFFFF) {
+            run.skip++;
+            i++;
+        }
+        size_t visibleStart = i;
+        while (i < total && (image.pixels[i] >> 24) != 0 && run.count < 0xFFFF) {
+            run.count++;
+            i++;
+        }
+        if (run.count == 0 && i == total) {
+            break;  // Trailing transparency needs no run
+        }
+        size_t at = payload->size();
+        payload->resize(at + sizeof(run) + run.count * sizeof(uint32_t));
+        memcpy(payload->data() + at, &run, sizeof(run));
+        memcpy(payload->data() + at + sizeof(run), image.pixels.data() + visibleStart, run.count * sizeof(uint32_t));
+    }
+}
+
+static void writePadding(FILE* out, uint64_t* offset) {
+    static const unsigned char zeros[BUNDLE_ALIGNMENT] = {0};
+    uint64_t pad = (BUNDLE_ALIGNMENT - (*offset % BUNDLE_ALIGNMENT)) % BUNDLE_ALIGNMENT;
+    fwrite(zeros, 1, pad, out);
+    *offset += pad;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = BUNDLE_FILE;
+    std::vector<std::string> folders;
+    std::vector<std::string> pngPrefixes;
+    bool rawAll = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--png-prefix") == 0 && i + 1 < argc) {
+            pngPrefixes.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--raw-all") == 0) {
+            rawAll = true;
+        } else if (argv[i][0] == '-') {
+            printf("Usage: %s [-o bundle] [--png-prefix PREFIX]... [--raw-all] [folder...]\n", argv[0]);
+            return 1;
+        } else {
+            folders.push_back(argv[i]);
+        }
+    }
+    if (folders.empty()) {
+        const char* defaults[] = {"emissions_images", "images", "correct_animation", "incorrect_animation", "GIFs"};
+        folders.assign(defaults, defaults + 5);
+    }
+
+    // Collect every PNG under the requested folders
+    std::vector<std::string> files;
+    for (size_t f = 0; f < folders.size(); f++) {
+        std::error_code error;
+        for (std::filesystem::recursive_directory_iterator it(folders[f], error), end; !error && it != end; it.increment(error)) {
+            if (it->is_regular_file() && it->path().extension() == ".png") {
+                files.push_back(it->path().generic_string());
+            }
+        }
+        if (error) {
+            printf("Warning: could not read folder %s\n", folders[f].c_str());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<PackedAsset> assets(files.size());
+    uint64_t sourceBytes = 0, packedBytes = 0;
+    const char* encodingNames[4] = {"raw", "PNG", "transparent-run", "palettized"};
+    size_t encodingCounts[4] = {0, 0, 0, 0};
+    uint64_t encodingBytes[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < files.size(); i++) {
+        PackedAsset& asset = assets[i];
+        char normalized[512];
+        normalizeAssetPath(files[i].c_str(), normalized, sizeof(normalized));
+        asset.path = normalized;
+        memset(&asset.entry, 0, sizeof(asset.entry));
+        asset.entry.pathHash = hashAssetPath(normalized);
+
+        std::vector<unsigned char> png;
+        Image image;
+        if (!readWholeFile(files[i], &png) || !decodePNGMemory(png.data(), png.size(), &image)) {
+            printf("Error: unable to decode %s\n", files[i].c_str());
+            return 1;
+        }
+        sourceBytes += png.size();
+        asset.entry.width = (uint16_t)image.width;
+        asset.entry.height = (uint16_t)image.height;
+
+        bool keepPNG = false;
+        for (size_t p = 0; p < pngPrefixes.size(); p++) {
+            keepPNG = keepPNG || asset.path.compare(0, pngPrefixes[p].size(), pngPrefixes[p]) == 0;
+        }
+
+        std::vector<unsigned char> stripped;
+        stripPNG(png, &stripped);
+        png.swap(stripped);
+
+        // Raw, transparent-run and palettized payloads all load without an inflate, so the smallest of them is kept.
+        // On a tie raw wins, since it is drawn in place.
+        std::vector<unsigned char> raw(image.byteSize());
+        memcpy(raw.data(), image.pixels.data(), image.byteSize());
+        asset.entry.encoding = ASSET_RGBA;
+        asset.payload.swap(raw);
+        if (keepPNG && !rawAll) {
+            asset.entry.encoding = ASSET_PNG;
+            asset.payload.swap(png);
+        } else if (!rawAll) {
+            std::vector<unsigned char> rle, indexed;
+            encodeRLE(image, &rle);
+            if (rle.size() < asset.payload.size()) {
+                asset.entry.encoding = ASSET_RLE;
+                asset.payload.swap(rle);
+            }
+            if (encodeIndexed(image, &indexed) && indexed.size() < asset.payload.size()) {
+                asset.entry.encoding = ASSET_INDEXED;
+                asset.payload.swap(indexed);
+            }
+            if (asset.payload.size() > PNG_FALLBACK_RATIO * png.size()) {
+                asset.entry.encoding = ASSET_PNG;
+                asset.payload.swap(png);
+            }
+        }
+        asset.entry.size = (uint32_t)asset.payload.size();
+        packedBytes += asset.payload.size();
+        encodingCounts[asset.entry.encoding]++;
+        encodingBytes[asset.entry.encoding] += asset.payload.size();
+    }
+
+    // Index is sorted by hash so the game can binary search it
+    std::sort(assets.begin(), assets.end(),
+              [](const PackedAsset& a, const PackedAsset& b) { return a.entry.pathHash < b.entry.pathHash; });
+
+    FILE* out = fopen(outputPath, "wb");
+    if (!out) {
+        printf("Error: unable to create %s\n", outputPath);
+        return 1;
+    }
+
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BUNDLE_MAGIC, 4);
+    header.version = BUNDLE_VERSION;
+    header.entryCount = (uint32_t)assets.size();
+    fwrite(&header, sizeof(header), 1, out);
+    uint64_t offset = sizeof(header);
+
+    for (size_t i = 0; i < assets.size(); i++) {
+        writePadding(out, &offset);
+        assets[i].entry.offset = offset;
+        fwrite(assets[i].payload.data(), 1, assets[i].payload.size(), out);
+        offset += assets[i].payload.size();
+    }
+
+    std::string pathTable;
+    for (size_t i = 0; i < assets.size(); i++) {
+        assets[i].entry.pathOffset = (uint32_t)pathTable.size();
+        pathTable += assets[i].path;
+        pathTable += '\0';
+    }
+
+    writePadding(out, &offset);
+    header.indexOffset = offset;
+    for (size_t i = 0; i < assets.size(); i++) {
+        fwrite(&assets[i].entry, sizeof(BundleEntry), 1, out);
+    }
+    offset += assets.size() * sizeof(BundleEntry);
+    header.pathsOffset = offset;
+    fwrite(pathTable.data(), 1, pathTable.size(), out);
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    bool ok = ferror(out) == 0;
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        printf("Error: failed writing %s\n", outputPath);
+        return 1;
+    }
+
+    printf("Packed %zu assets into %s (%.1f MB of payloads from %.1f MB of source PNGs)\n",
+           assets.size(), outputPath, packedBytes / 1048576.0, sourceBytes / 1048576.0);
+    for (int e = 0; e < 4; e++) {
+        if (encodingCounts[e] > 0) {
+            printf("    %zu %s images, %.1f MB\n", encodingCounts[e], encodingNames[e], encodingBytes[e] / 1048576.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+#include "trace.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+Tracer Trace;
+
+// Taken during static initialization, as close to launch as the game can get
+static const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+/* CLASS: The calling thread's ring and name. Giving the ring up when the thread ends lets another thread have it.
+    Author: Niko                                                                                                   */
+struct TraceThread {
+    TraceRing* ring;
+    const char* name;
+
+    TraceThread() : ring(NULL), name(NULL) {}
+    ~TraceThread() {
+        if (ring) {
+            ring->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local TraceThread traceThread;
+
+/* CLASS: An event copied out of a ring for writing or summing up.
+    Author: Niko                                                      */
+struct TraceCopy {
+    const char* name;
+    int64_t start, duration;
+};
+
+Tracer::Tracer() : recording(true), showOverlay(false), dumpPath(TRACE_FILE) {
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        rings[i].store(NULL);
+    }
+}
+
+Tracer::~Tracer() {
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        delete rings[i].load();
+    }
+}
+
+int64_t Tracer::clock() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+/* FUNCTION: Names the calling thread in the trace.
+    Author: Niko
+    Arguments:
+        name - The name (a string literal, e.g. "main" or "loader").
+    Returns:
+        NONE                                                        */
+void Tracer::nameThread(const char* name) {
+    traceThread.name = name;
+    if (traceThread.ring) {
+        traceThread.ring->threadName.store(name, std::memory_order_relaxed);
+    }
+}
+
+/* FUNCTION: Gets the calling thread's ring, taking a free one (or making one) the first time.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        The ring, or NULL if TRACE_MAX_THREADS threads already have one.                       */
+TraceRing* Tracer::ring() const {
+    if (traceThread.ring) {
+        return traceThread.ring;
+    }
+
+    TraceRing* mine = NULL;
+    for (int i = 0; i < TRACE_MAX_THREADS && !mine; i++) {
+        TraceRing* ring = rings[i].load(std::memory_order_acquire);
+        if (!ring) {
+            TraceRing* fresh = new TraceRing();
+            fresh->claimed.store(0);
+            fresh->written.store(0);
+            fresh->owned.store(true);
+            fresh->threadName.store(NULL);
+            TraceRing* expected = NULL;
+            if (rings[i].compare_exchange_strong(expected, fresh)) {
+                mine = fresh;
+                break;
+            }
+            // Another thread filled the slot first: try for its ring like any other
+            delete fresh;
+            ring = expected;
+        }
+        if (!ring->owned.exchange(true, std::memory_order_acq_rel)) {
+            mine = ring;
+        }
+    }
+    if (mine) {
+        mine->threadName.store(traceThread.name ? traceThread.name : "thread", std::memory_order_relaxed);
+        traceThread.ring = mine;
+    }
+    return mine;
+}
+
+/* FUNCTION: Adds a finished phase to the calling thread's ring.
+    Author: Niko
+    Arguments:
+        name - Phase name (a string literal).
+        start, end - From clock().
+    Returns:
+        NONE                                                      */
+void Tracer::record(const char* name, int64_t start, int64_t end) {
+    TraceRing* ring = this->ring();
+    if (!ring) {
+        return;
+    }
+
+    uint64_t index = ring->claimed.load(std::memory_order_relaxed);
+    ring->claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    TraceEvent& event = ring->events[index % TRACE_RING_EVENTS];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.duration.store(end - start, std::memory_order_relaxed);
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+/* FUNCTION: Copies a ring's events out, oldest first, leaving out any its owner was overwriting meanwhile.
+    Author: Niko
+    Arguments:
+        ring - The ring (its owner may go on recording).
+        events - Receives the events.
+    Returns:
+        NONE                                                                                                 */
+static void copyRing(const TraceRing& ring, std::vector<TraceCopy>* events) {
+    uint64_t end = ring.written.load(std::memory_order_acquire);
+    uint64_t begin = end > TRACE_RING_EVENTS ? end - TRACE_RING_EVENTS : 0;
+
+    events->clear();
+    for (uint64_t i = begin; i < end; i++) {
+        const TraceEvent& event = ring.events[i % TRACE_RING_EVENTS];
+        TraceCopy copy;
+        copy.name = event.name.load(std::memory_order_relaxed);
+        copy.start = event.start.load(std::memory_order_relaxed);
+        copy.duration = event.duration.load(std::memory_order_relaxed);
+        events->push_back(copy);
+    }
+
+    // Events the owner has claimed since were written over the oldest ones while they were being copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t claimed = ring.claimed.load(std::memory_order_relaxed);
+    uint64_t firstIntact = claimed > TRACE_RING_EVENTS ? claimed - TRACE_RING_EVENTS : 0;
+    if (firstIntact > begin) {
+        size_t torn = firstIntact - begin < events->size() ? (size_t)(firstIntact - begin) : events->size();
+        events->erase(events->begin(), events->begin() + torn);
+    }
+}
+
+/* FUNCTION: Writes a string as a JSON string literal.
+    Author: Niko
+    Arguments:
+        file - Where to write.
+        text - The string.
+    Returns:
+        NONE                                                */
+static void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+/* FUNCTION: Writes every ring out as a Chrome/Perfetto trace (see the format at the top of trace.h).
+    Author: Niko
+    Arguments:
+        path - Native path of the trace.
+    Returns:
+        false if the file can't be written.                                                            */
+bool Tracer::write(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"game\"}}");
+    std::vector<TraceCopy> events;
+    unsigned long written = 0;
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        const TraceRing* ring = rings[i].load(std::memory_order_acquire);
+        if (!ring) {
+            continue;
+        }
+        int tid = i + 1;
+        const char* threadName = ring->threadName.load(std::memory_order_relaxed);
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ", tid);
+        writeJsonString(file, threadName ? threadName : "thread");
+        fprintf(file, "}}");
+
+        copyRing(*ring, &events);
+        for (size_t j = 0; j < events.size(); j++) {
+            fprintf(file, ",\n{\"name\": ");
+            writeJsonString(file, events[j].name);
+            fprintf(file, ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                    events[j].start / 1000.0, events[j].duration / 1000.0, tid);
+        }
+        written += events.size();
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0 || !ok) {
+        return false;
+    }
+    printf("Wrote %lu trace events to %s\n", written, path);
+    return true;
+}
+
+/* FUNCTION: Sums up the calling thread's last TRACE_WINDOW_SECONDS: frames shown and the busiest phase. A phase's
+             own time leaves out the phases nested in it, so the draw that called a text layout isn't charged for it.
+    Author: Niko
+    Arguments:
+        frames - Receives the frames shown (TRACE_FRAME_PHASE events that ended in the window).
+        busiest - Receives the phase with the most time of its own, not counting sleep (NULL if there was none).
+        share - Receives the fraction of the window that phase took.
+    Returns:
+        NONE                                                                                                       */
+void Tracer::summarize(int* frames, const char** busiest, double* share) const {
+    *frames = 0;
+    *busiest = NULL;
+    *share = 0.0;
+    TraceRing* ring = this->ring();
+    if (!ring) {
+        return;
+    }
+
+    int64_t now = clock();
+    int64_t window = (int64_t)(TRACE_WINDOW_SECONDS * 1e9);
+    int64_t windowStart = now > window ? now - window : 0;
+    std::vector<TraceCopy> events;
+    copyRing(*ring, &events);
+
+    // Events go into the ring as they end, so a phase comes after every phase nested in it
+    struct Total {
+        const char* name;
+        int64_t self;
+    };
+    std::vector<Total> totals;
+    std::vector<TraceCopy> open;
+    for (size_t i = 0; i < events.size(); i++) {
+        const TraceCopy& event = events[i];
+        if (event.start + event.duration < windowStart) {
+            continue;
+        }
+        int64_t self = event.duration;
+        while (!open.empty() && open.back().start >= event.start) {
+            self -= open.back().duration;
+            open.pop_back();
+        }
+        open.push_back(event);
+
+        if (strcmp(event.name, TRACE_FRAME_PHASE) == 0) {
+            (*frames)++;
+        }
+        if (strcmp(event.name, TRACE_SLEEP_PHASE) == 0) {
+            continue;
+        }
+        size_t j = 0;
+        while (j < totals.size() && strcmp(totals[j].name, event.name) != 0) {
+            j++;
+        }
+        if (j == totals.size()) {
+            Total total = {event.name, 0};
+            totals.push_back(total);
+        }
+        totals[j].self += self;
+    }
+
+    int64_t most = 0;
+    for (size_t j = 0; j < totals.size(); j++) {
+        if (!*busiest || totals[j].self > most) {
+            *busiest = totals[j].name;
+            most = totals[j].self;
+        }
+    }
+    *share = now > windowStart ? (double)most / (now - windowStart) : 0.0;
+}
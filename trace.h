@@ -0,0 +1,114 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#define TRACE_FILE "trace.json"         // Default trace path (--trace, and the dump gesture)
+#define TRACE_RING_EVENTS 16384         // Events kept per thread (the oldest are overwritten first)
+#define TRACE_MAX_THREADS 16            // Threads traced at once; any more go untraced
+#define TRACE_WINDOW_SECONDS 1.0        // Span the overlay's FPS and busiest phase cover
+#define TRACE_HOLD_SECONDS 3.0          // How long a corner has to be held for a trace gesture
+#define TRACE_CORNER_SIZE 40            // Size in pixels of the corners the gestures use
+#define TRACE_FRAME_PHASE "LCD.Update"  // Phase that ends every frame (counted for the overlay's FPS)
+#define TRACE_SLEEP_PHASE "sleep"       // Phase that is never the busiest one
+
+/* Trace file format: Chrome's JSON trace event format, which chrome://tracing and ui.perfetto.dev open as is. Each
+   phase is a complete ("X") event with its start and duration in microseconds since launch; tid is the trace ring,
+   named by a thread_name metadata event. */
+
+/* CLASS: One finished phase in a trace ring. The fields are atomic so a dump can read a ring while its thread writes.
+    Author: Niko
+    Members:
+        name - Phase name (a string literal).
+        start, duration - In nanoseconds (start since launch).                                                     */
+struct TraceEvent {
+    std::atomic<const char*> name;
+    std::atomic<int64_t> start;
+    std::atomic<int64_t> duration;
+};
+
+/* CLASS: A thread's trace ring: TRACE_RING_EVENTS events, written by the thread that owns it and nobody else.
+    Author: Niko
+    Members:
+        claimed - Events the owner has started to write.
+        written - Events the owner has finished writing.
+        owned - Whether a thread owns the ring (rings of finished threads are handed to new ones).
+        threadName - Name of the thread that owns it, or owned it last.                                       */
+struct TraceRing {
+    std::atomic<uint64_t> claimed;
+    std::atomic<uint64_t> written;
+    std::atomic<bool> owned;
+    std::atomic<const char*> threadName;
+    TraceEvent events[TRACE_RING_EVENTS];
+};
+
+/* CLASS: Records how long each phase of the game takes (input poll, image decode, draw, overlay blend, text layout,
+          LCD.Update, sleep, and the animations), on every thread, and writes it out as a trace.
+    Author: Niko
+    Members:
+        setEnabled(on) - Turns recording on or off (on from launch; off costs one relaxed load per phase).
+        nameThread(name) - Names the calling thread in the trace (a string literal).
+        clock() - Nanoseconds since launch, on the steady clock (so virtual clocks, see bench.h, don't bend it).
+        record(name, start, end) - Adds a phase to the calling thread's ring (use TRACE_SCOPE instead).
+        write(path) - Writes every ring out as a trace file; false if the file can't be written.
+        summarize(frames, busiest, share) - Over the last TRACE_WINDOW_SECONDS on the calling thread: frames shown,
+            and the phase that took the most time of its own (nested phases taken out, sleep left out) and its share.
+        setOverlay(on), overlay() - Whether the display shows the FPS and busiest phase (see DisplayLayer::update).
+        setPath(path), path() - Where the trace is written on exit and by the dump gesture (see InputLayer::poll).
+    Notes:
+        Recording never locks: each thread gets its own ring the first time it records, and the reader tells torn events
+        apart from the ring's counters (the owner bumps claimed before it writes an event and written after). A ring
+        is kept when its thread ends and handed to the next thread that records, so a tid in the trace is a ring, which
+        may have served several short-lived threads in turn (e.g. one GIF decoder per losing screen).                   */
+class Tracer {
+public:
+    Tracer();
+    ~Tracer();
+
+    void setEnabled(bool on) { recording.store(on, std::memory_order_relaxed); }
+    bool enabled() const { return recording.load(std::memory_order_relaxed); }
+    void nameThread(const char* name);
+
+    int64_t clock() const;
+    void record(const char* name, int64_t start, int64_t end);
+    bool write(const char* path) const;
+    void summarize(int* frames, const char** busiest, double* share) const;
+
+    void setOverlay(bool on) { showOverlay = on; }
+    bool overlay() const { return showOverlay; }
+    void setPath(const char* path) { dumpPath = path; }
+    const char* path() const { return dumpPath; }
+
+private:
+    TraceRing* ring() const;
+
+    std::atomic<bool> recording;
+    mutable std::atomic<TraceRing*> rings[TRACE_MAX_THREADS];   // Made on first use, by whichever thread needs one
+    bool showOverlay;
+    const char* dumpPath;
+};
+
+extern Tracer Trace;
+
+/* CLASS: Records the time from its construction to the end of its scope as one phase.
+    Author: Niko                                                                          */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(name), start(Trace.enabled() ? Trace.clock() : -1) {}
+    ~TraceScope() {
+        if (start >= 0) {
+            Trace.record(name, start, Trace.clock());
+        }
+    }
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_JOIN(traceScope, __LINE__)(name)
+
+#endif
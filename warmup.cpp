@@ -0,0 +1,155 @@
+#include "warmup.h"
+#include "image_cache.h"
+#include "trace.h"
+
+#include "backend.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+AssetWarmer Warmup;
+
+// Taken during static initialization, as close to launch as the game can get
+static const std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+
+static double secondsSinceLaunch() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - launchTime).count();
+}
+
+/* FUNCTION: Parses a warm set name as given on the command line.
+    Author: Niko
+    Arguments:
+        name - "none", "hot" or "all".
+    Returns:
+        The WARM_* set, or -1 if the name isn't one.    */
+int parseWarmSet(const char* name) {
+    if (strcmp(name, "none") == 0) {
+        return WARM_NONE;
+    }
+    if (strcmp(name, "hot") == 0) {
+        return WARM_HOT;
+    }
+    if (strcmp(name, "all") == 0) {
+        return WARM_ALL;
+    }
+    return -1;
+}
+
+AssetWarmer::AssetWarmer()
+    : warmSet(WARM_NONE), threadCount(0), warmed(0), firstFrameSeconds(0.0), warmSeconds(0.0) {
+}
+
+/* FUNCTION: Adds an image to the manifest.
+    Author: Niko
+    Arguments:
+        path - Asset path of the image.
+        set - Smallest WARM_* set that loads it.
+    Returns:
+        NONE                                    */
+void AssetWarmer::addImage(const char* path, int set) {
+    Entry entry;
+    entry.path = path;
+    entry.animation = NULL;
+    entry.first = entry.last = 0;
+    entry.set = set;
+    manifest.push_back(entry);
+}
+
+/* FUNCTION: Adds an answer animation to the manifest.
+    Author: Niko
+    Arguments:
+        animation - Where to build it.
+        folder, first, last - What to build it from (see DeltaAnimation::load).
+        set - Smallest WARM_* set that builds it.
+    Returns:
+        NONE                                                                     */
+void AssetWarmer::addAnimation(DeltaAnimation* animation, const char* folder, int first, int last, int set) {
+    Entry entry;
+    entry.path = folder;
+    entry.animation = animation;
+    entry.first = first;
+    entry.last = last;
+    entry.set = set;
+    manifest.push_back(entry);
+}
+
+/* FUNCTION: Warms every manifest entry in a set on a worker pool, reporting progress from the calling thread.
+    Author: Niko
+    Arguments:
+        set - The WARM_* set.
+        progress - Draws the progress screen (called at least once, and last with done == total, unless the set is
+            empty).
+    Returns:
+        How many entries were warmed.                                                                          */
+int AssetWarmer::run(int set, void (*progress)(int done, int total)) {
+    warmSet = set;
+    std::vector<const Entry*> work;
+    for (size_t i = 0; i < manifest.size(); i++) {
+        if (manifest[i].set <= set) {
+            work.push_back(&manifest[i]);
+        }
+    }
+    int total = (int)work.size();
+    if (total == 0) {
+        return 0;
+    }
+
+    // Workers take the next entry off a shared counter, so a slow animation doesn't hold up the images behind it
+    std::atomic<int> next(0);
+    std::atomic<int> done(0);
+    auto warmLoop = [&]() {
+        Trace.nameThread("warmup");
+        for (int i = next++; i < total; i = next++) {
+            const Entry& entry = *work[i];
+            if (entry.animation) {
+                if (!entry.animation->isLoaded()) {
+                    entry.animation->load(entry.path.c_str(), entry.first, entry.last);
+                }
+            } else {
+                Images.get(entry.path.c_str());
+            }
+            done++;
+        }
+    };
+
+    int cores = (int)std::thread::hardware_concurrency();
+    threadCount = cores < 1 ? 1 : (cores > WARMUP_MAX_THREADS ? WARMUP_MAX_THREADS : cores);
+    if (threadCount > total) {
+        threadCount = total;
+    }
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threadCount; i++) {
+        pool.push_back(std::thread(warmLoop));
+    }
+
+    progress(0, total);
+    firstFrameSeconds = secondsSinceLaunch();
+    while (done < total) {
+        Device->sleep(WARMUP_PROGRESS_INTERVAL);
+        progress(done, total);
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+
+    warmed = total;
+    warmSeconds = secondsSinceLaunch();
+    printf("Warm-up: first frame %.1f ms after launch, fully warm after %.1f ms (%d assets on %d threads)\n",
+           firstFrameSeconds * 1000.0, warmSeconds * 1000.0, warmed, threadCount);
+    return warmed;
+}
+
+/* FUNCTION: Prints the startup timings.
+    Author: Niko
+    Arguments:
+        NONE
+    Returns:
+        NONE                           */
+void AssetWarmer::printStats() const {
+    static const char* setNames[3] = {"none", "hot", "all"};
+    printf("Warm-up: set \"%s\", %d of %zu manifest entries on %d threads, first frame at %.1f ms, warm at %.1f ms\n",
+           setNames[warmSet], warmed, manifest.size(), threadCount, firstFrameSeconds * 1000.0, warmSeconds * 1000.0);
+}
@@ -0,0 +1,60 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include "delta_animation.h"
+
+#include <string>
+#include <vector>
+
+/* Warm sets, each including the ones before it */
+#define WARM_NONE 0             // Load everything lazily, as it is first drawn
+#define WARM_HOT 1              // Title art, round overlays and the answer animations (what the first game needs)
+#define WARM_ALL 2              // Also every prompt image, the other screens' art and the first frames of each GIF
+
+#define WARMUP_MAX_THREADS 8            // Worker pool size cap (decoding is the only work, so more cores stop paying off)
+#define WARMUP_PROGRESS_INTERVAL 0.02   // Seconds between progress screen redraws
+
+int parseWarmSet(const char* name);
+
+/* CLASS: Startup phase that loads a manifest of assets into the image cache (and builds the answer animations) on a
+          pool of worker threads, so no screen decodes anything on first entry.
+    Author: Niko
+    Members:
+        addImage(path, set) - Adds an image to the manifest, loaded for warm sets from set up.
+        addAnimation(animation, folder, first, last, set) - Adds an answer animation to build (see delta_animation.h).
+        run(set, progress) - Warms every entry in the set on one thread per core (up to WARMUP_MAX_THREADS), calling
+            progress(done, total) on the calling thread every WARMUP_PROGRESS_INTERVAL until all are done (not at all
+            for an empty set); returns how many were warmed.
+        printStats() - Prints the startup timings.
+    Notes:
+        Everything goes through the locked image cache, so entries can run in any order; each animation is one entry,
+        as its frames are diffed in sequence. Timings are measured from launch (static initialization): the first
+        frame is when progress() first returns, i.e. when the progress screen is up.                                  */
+class AssetWarmer {
+public:
+    AssetWarmer();
+
+    void addImage(const char* path, int set);
+    void addAnimation(DeltaAnimation* animation, const char* folder, int first, int last, int set);
+    int run(int set, void (*progress)(int done, int total));
+    void printStats() const;
+
+private:
+    struct Entry {
+        std::string path;               // Image, or the animation's folder
+        DeltaAnimation* animation;      // NULL for an image
+        int first, last;
+        int set;
+    };
+
+    std::vector<Entry> manifest;
+    int warmSet;
+    int threadCount;
+    int warmed;
+    double firstFrameSeconds;           // Since launch
+    double warmSeconds;                 // Since launch
+};
+
+extern AssetWarmer Warmup;
+
+#endif